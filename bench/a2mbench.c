@@ -0,0 +1,844 @@
+/***************************************************************************
+ * a2mbench.c
+ *
+ * Benchmark ascii2mseed conversion of input files, see a2mgen.c for
+ * generating synthetic input.
+ *
+ * For each input file the following stages are run in isolation,
+ * using the same modules and library routines as ascii2mseed:
+ *
+ *   parse  : read lines and parse sample values (readbuffer.c, parsenum.c)
+ *   time   : read lines and convert TSPAIR time stamps (timeparse.c)
+ *   encode : encode parsed samples into records (libmseed packdata.c)
+ *   header : pack a record header for each encoded record (libmseed)
+ *   write  : write the records to an output file (writebuffer.c)
+ *   full   : run the ascii2mseed program to convert the file
+ *
+ * Each stage is run a number of times and the fastest run is
+ * reported as a line of JSON including the counts of samples, records
+ * and bytes processed, their rates and the peak resident set size.
+ * The peak resident set size of stages run in this program is that
+ * of the program so far, for the full conversion it is that of the
+ * ascii2mseed process.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <libmseed.h>
+#include <packdata.h>
+
+#include "readbuffer.h"
+#include "parsenum.h"
+#include "timeparse.h"
+#include "writebuffer.h"
+#include "segindex.h"
+#include "stats.h"
+
+#define PACKAGE "a2mbench"
+
+/* Samples of a TIMESERIES segment parsed from an input file */
+typedef struct BenchSegment_s {
+  SegmentHeader hdr;            /* Parsed header values */
+  char      listtype;           /* Sample list type: 'S' (SLIST) or 'T' (TSPAIR) */
+  char      datatype;           /* Sample type: 'i', 'f' or 'd' */
+  int       encoding;           /* Encoding format for records */
+  int64_t   samplecnt;          /* Count of samples */
+  void     *datasamples;        /* Parsed samples */
+  struct BenchSegment_s *next;
+} BenchSegment;
+
+/* Result of a benchmark stage */
+typedef struct BenchResult_s {
+  int64_t   samples;            /* Count of samples processed */
+  int64_t   records;            /* Count of records processed */
+  int64_t   bytes;              /* Count of bytes processed */
+  int64_t   peakrss;            /* Peak resident set size in kilobytes */
+} BenchResult;
+
+static int   repeat      = 3;
+static int   encoding    = 11;
+static int   reclen      = 4096;
+static char *program     = "../ascii2mseed";
+static char *outputfile  = "a2mbench.mseed";
+static int   byteorder   = 1;
+
+static BenchSegment *segments = NULL;
+static int *recordsamples = NULL;   /* Sample count of each encoded record */
+static int64_t recordcount = 0;
+static int64_t recordsize = 0;
+static char *recordbuf = NULL;      /* Record buffer for all stages */
+
+static int benchfile (char *infile);
+static int runstage (char *infile, const char *stage,
+                     int (*stagefunc) (char *, BenchResult *));
+static int stageparse (char *infile, BenchResult *result);
+static int stagetime (char *infile, BenchResult *result);
+static int stageencode (char *infile, BenchResult *result);
+static int stageheader (char *infile, BenchResult *result);
+static int stagewrite (char *infile, BenchResult *result);
+static int stagefull (char *infile, BenchResult *result);
+static int encoderecord (BenchSegment *seg, int64_t offset, int32_t diff0,
+                         char *record, int datasize);
+static int addsegment (SegmentHeader *hdr, BenchSegment **seg);
+static void freesegments (void);
+static int64_t peakrss (void);
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+
+int
+main (int argc, char **argv)
+{
+  int optind;
+  int rv = 0;
+
+  if ( (optind = parameter_proc (argc, argv)) < 0 )
+    return 1;
+
+  for ( ; optind < argc; optind++ )
+    {
+      if ( benchfile (argv[optind]) )
+        rv = 1;
+    }
+
+  unlink (outputfile);
+
+  return rv;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * benchfile:
+ *
+ * Run all benchmark stages for an input file.  The parse stage must
+ * succeed as the parsed samples are used by later stages.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+benchfile (char *infile)
+{
+  int rv = 0;
+
+  if ( runstage (infile, "parse", stageparse) )
+    {
+      freesegments ();
+      return -1;
+    }
+
+  rv |= runstage (infile, "time", stagetime);
+  rv |= runstage (infile, "encode", stageencode);
+  rv |= runstage (infile, "header", stageheader);
+  rv |= runstage (infile, "write", stagewrite);
+  rv |= runstage (infile, "full", stagefull);
+
+  freesegments ();
+
+  return rv;
+}  /* End of benchfile() */
+
+
+/***************************************************************************
+ * runstage:
+ *
+ * Run a stage the specified number of times and print the result of
+ * the fastest run as a JSON object on a line.  A stage that does not
+ * apply to the input returns 1 and is not reported.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+runstage (char *infile, const char *stage,
+          int (*stagefunc) (char *, BenchResult *))
+{
+  BenchResult result;
+  double start;
+  double seconds;
+  double best = -1.0;
+  int iteration;
+  int rv;
+
+  for ( iteration = 0; iteration < repeat; iteration++ )
+    {
+      memset (&result, 0, sizeof (BenchResult));
+
+      start = st_now ();
+      rv = stagefunc (infile, &result);
+      seconds = st_now () - start;
+
+      if ( rv < 0 )
+        {
+          fprintf (stderr, "[%s] Benchmark stage %s failed\n", infile, stage);
+          return -1;
+        }
+
+      if ( rv > 0 )
+        return 0;
+
+      if ( best < 0.0 || seconds < best )
+        best = seconds;
+    }
+
+  if ( best <= 0.0 )
+    best = 1e-9;
+
+  if ( result.peakrss == 0 )
+    result.peakrss = peakrss ();
+
+  printf ("{\"input\": \"%s\", \"stage\": \"%s\", \"samples\": %lld, \"records\": %lld, "
+          "\"bytes\": %lld, \"seconds\": %.6f, \"samples_per_sec\": %.0f, "
+          "\"records_per_sec\": %.0f, \"bytes_per_sec\": %.0f, \"peak_rss_kb\": %lld}\n",
+          infile, stage, (long long int) result.samples, (long long int) result.records,
+          (long long int) result.bytes, best, result.samples / best,
+          result.records / best, result.bytes / best, (long long int) result.peakrss);
+  fflush (stdout);
+
+  return 0;
+}  /* End of runstage() */
+
+
+/***************************************************************************
+ * stageparse:
+ *
+ * Read the input file and parse the header and sample values of each
+ * segment, storing the samples for the encode stage.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+stageparse (char *infile, BenchResult *result)
+{
+  ReadBuffer *rb;
+  BenchSegment *seg = NULL;
+  SegmentHeader hdr;
+  char *line;
+  char *lineend;
+  char *cp;
+  int64_t count = 0;
+  int rv;
+
+  freesegments ();
+
+  if ( (rb = rb_open (infile, 0)) == NULL )
+    return -1;
+
+  while ( (rv = rb_getline (rb, &line, &lineend)) > 0 )
+    {
+      if ( lineend - line > 10 && ! memcmp (line, "TIMESERIES", 10) )
+        {
+          if ( si_parseheader (line, lineend, &hdr) < 6 || addsegment (&hdr, &seg) )
+            {
+              fprintf (stderr, "[%s] Cannot parse header at line %lld\n",
+                       infile, (long long int) rb->linenum);
+              rv = -1;
+              break;
+            }
+
+          count = 0;
+          continue;
+        }
+
+      if ( ! seg )
+        continue;
+
+      cp = line;
+
+      /* Skip the time stamp of TSPAIR samples */
+      if ( seg->listtype == 'T' )
+        {
+          while ( cp < lineend && ! PN_ISSPACE (*cp) )
+            cp++;
+        }
+
+      for (;;)
+        {
+          while ( cp < lineend && PN_ISSPACE (*cp) )
+            cp++;
+
+          if ( cp >= lineend )
+            break;
+
+          if ( count >= seg->samplecnt )
+            {
+              fprintf (stderr, "[%s] More samples than declared in header at line %lld\n",
+                       infile, (long long int) rb->linenum);
+              rb_close (&rb);
+              return -1;
+            }
+
+          if ( seg->datatype == 'i' )
+            rv = pn_int32 (&cp, lineend, (int32_t *) seg->datasamples + count);
+          else if ( seg->datatype == 'f' )
+            rv = pn_float (&cp, lineend, (float *) seg->datasamples + count);
+          else
+            rv = pn_double (&cp, lineend, (double *) seg->datasamples + count);
+
+          if ( rv )
+            {
+              fprintf (stderr, "[%s] Cannot parse sample value at line %lld\n",
+                       infile, (long long int) rb->linenum);
+              rb_close (&rb);
+              return -1;
+            }
+
+          count++;
+        }
+    }
+
+  result->bytes = ( rb->mapped ) ? (int64_t) rb->bufsize : rb->bufoffset + (rb->end - rb->buffer);
+  result->samples = 0;
+
+  for ( seg = segments; seg; seg = seg->next )
+    result->samples += seg->samplecnt;
+
+  rb_close (&rb);
+
+  return ( rv < 0 ) ? -1 : 0;
+}  /* End of stageparse() */
+
+
+/***************************************************************************
+ * stagetime:
+ *
+ * Read the input file and convert the time stamps of TSPAIR samples.
+ *
+ * Returns 0 on success, 1 if the input has no TSPAIR samples and -1
+ * on error.
+ ***************************************************************************/
+static int
+stagetime (char *infile, BenchResult *result)
+{
+  ReadBuffer *rb;
+  BenchSegment *seg;
+  SegmentHeader hdr;
+  TimeCache tc;
+  char *line;
+  char *lineend;
+  char *cp;
+  int tspair = 0;
+  int rv;
+
+  for ( seg = segments; seg; seg = seg->next )
+    if ( seg->listtype == 'T' )
+      tspair = 1;
+
+  if ( ! tspair )
+    return 1;
+
+  if ( (rb = rb_open (infile, 0)) == NULL )
+    return -1;
+
+  ts_init (&tc);
+  tspair = 0;
+
+  while ( (rv = rb_getline (rb, &line, &lineend)) > 0 )
+    {
+      if ( lineend - line > 10 && ! memcmp (line, "TIMESERIES", 10) )
+        {
+          tspair = ( si_parseheader (line, lineend, &hdr) >= 6 &&
+                     ! strcmp (hdr.listtype, "TSPAIR") );
+          continue;
+        }
+
+      if ( ! tspair || line == lineend )
+        continue;
+
+      for ( cp = line; cp < lineend && ! PN_ISSPACE (*cp); cp++ );
+
+      if ( ts_timestr2hptime (&tc, line, cp) == HPTERROR )
+        {
+          fprintf (stderr, "[%s] Cannot convert time stamp at line %lld\n",
+                   infile, (long long int) rb->linenum);
+          rb_close (&rb);
+          return -1;
+        }
+
+      result->samples++;
+    }
+
+  result->bytes = ( rb->mapped ) ? (int64_t) rb->bufsize : rb->bufoffset + (rb->end - rb->buffer);
+
+  rb_close (&rb);
+
+  return ( rv < 0 ) ? -1 : 0;
+}  /* End of stagetime() */
+
+
+/***************************************************************************
+ * stageencode:
+ *
+ * Encode the parsed samples of each segment into records, recording
+ * the sample count of each record for the header stage.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+stageencode (char *infile, BenchResult *result)
+{
+  BenchSegment *seg;
+  int64_t offset;
+  int32_t diff0;
+  int datasize = reclen - 64;
+  int *newsamples;
+  int count;
+
+  recordcount = 0;
+
+  for ( seg = segments; seg; seg = seg->next )
+    {
+      for ( offset = 0; offset < seg->samplecnt; offset += count )
+        {
+          diff0 = 0;
+          if ( seg->datatype == 'i' && offset > 0 )
+            diff0 = ((int32_t *) seg->datasamples)[offset] - ((int32_t *) seg->datasamples)[offset - 1];
+
+          if ( (count = encoderecord (seg, offset, diff0, recordbuf + 64, datasize)) <= 0 )
+            {
+              fprintf (stderr, "[%s] Cannot encode samples of %s\n", infile, seg->hdr.srcname);
+              return -1;
+            }
+
+          if ( recordcount == recordsize )
+            {
+              recordsize = ( recordsize ) ? recordsize * 2 : 1024;
+
+              if ( ! (newsamples = (int *) realloc (recordsamples, recordsize * sizeof (int))) )
+                {
+                  fprintf (stderr, "Cannot allocate memory\n");
+                  return -1;
+                }
+
+              recordsamples = newsamples;
+            }
+
+          recordsamples[recordcount++] = count;
+        }
+
+      result->samples += seg->samplecnt;
+    }
+
+  result->records = recordcount;
+  result->bytes = recordcount * reclen;
+
+  return 0;
+}  /* End of stageencode() */
+
+
+/***************************************************************************
+ * stageheader:
+ *
+ * Pack a record header for each record produced by the encode stage,
+ * advancing the start time and sequence number as done when packing
+ * a trace.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+stageheader (char *infile, BenchResult *result)
+{
+  struct blkt_1000_s blkt1000;
+  MSRecord *msr;
+  BenchSegment *seg;
+  int64_t recidx = 0;
+  int64_t offset;
+  int rv = 0;
+
+  if ( ! (msr = msr_init (NULL)) )
+    return -1;
+
+  msr->record = recordbuf;
+  msr->reclen = reclen;
+  msr->byteorder = byteorder;
+  msr->dataquality = 'D';
+
+  memset (&blkt1000, 0, sizeof (struct blkt_1000_s));
+
+  if ( ! msr_addblockette (msr, (char *) &blkt1000, sizeof (struct blkt_1000_s), 1000, 0) )
+    {
+      msr->record = NULL;
+      msr_free (&msr);
+      return -1;
+    }
+
+  for ( seg = segments; seg && rv >= 0; seg = seg->next )
+    {
+      ms_splitsrcname (seg->hdr.srcname, msr->network, msr->station,
+                       msr->location, msr->channel, NULL);
+
+      msr->starttime = ms_timestr2hptime (seg->hdr.timestr);
+      msr->samprate = seg->hdr.samplerate;
+      msr->encoding = seg->encoding;
+      msr->sequence_number = 1;
+
+      for ( offset = 0; offset < seg->samplecnt && recidx < recordcount; recidx++ )
+        {
+          msr->numsamples = recordsamples[recidx];
+          msr->samplecnt = msr->numsamples;
+
+          if ( (rv = msr_pack_header (msr, 1, 0)) < 0 )
+            {
+              fprintf (stderr, "[%s] Cannot pack header of %s\n", infile, seg->hdr.srcname);
+              break;
+            }
+
+          offset += msr->numsamples;
+          msr->starttime += (hptime_t) (msr->numsamples / msr->samprate * HPTMODULUS + 0.5);
+          msr->sequence_number = ( msr->sequence_number >= 999999 ) ? 1 : msr->sequence_number + 1;
+        }
+
+      result->samples += offset;
+    }
+
+  msr->record = NULL;
+  msr_free (&msr);
+
+  result->records = recidx;
+  result->bytes = recidx * reclen;
+
+  return ( rv < 0 ) ? -1 : 0;
+}  /* End of stageheader() */
+
+
+/***************************************************************************
+ * stagewrite:
+ *
+ * Write a record for each record produced by the encode stage to the
+ * output file.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+stagewrite (char *infile, BenchResult *result)
+{
+  WriteBuffer *wb;
+  int64_t recidx;
+  int rv = 0;
+
+  /* The records of the encode stage are written, not the input file */
+  (void) infile;
+
+  if ( (wb = wb_open (outputfile, 0, 0)) == NULL )
+    return -1;
+
+  for ( recidx = 0; recidx < recordcount; recidx++ )
+    {
+      if ( wb_write (wb, recordbuf, reclen) )
+        {
+          fprintf (stderr, "Error writing to %s\n", outputfile);
+          rv = -1;
+          break;
+        }
+
+      result->samples += recordsamples[recidx];
+    }
+
+  result->records = recidx;
+  result->bytes = wb->written + wb->length;
+
+  if ( wb_close (&wb) )
+    rv = -1;
+
+  return rv;
+}  /* End of stagewrite() */
+
+
+/***************************************************************************
+ * stagefull:
+ *
+ * Run the ascii2mseed program to convert the input file, the records
+ * are counted from the size of the output file.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+stagefull (char *infile, BenchResult *result)
+{
+  BenchSegment *seg;
+  struct rusage usage;
+  struct stat st;
+  char reclenstr[20];
+  char encodingstr[20];
+  char *args[12];
+  int status;
+  pid_t pid;
+
+  snprintf (reclenstr, sizeof (reclenstr), "%d", reclen);
+  snprintf (encodingstr, sizeof (encodingstr), "%d", encoding);
+
+  args[0] = program;
+  args[1] = "-r";
+  args[2] = reclenstr;
+  args[3] = "-e";
+  args[4] = encodingstr;
+  args[5] = "-o";
+  args[6] = outputfile;
+  args[7] = infile;
+  args[8] = NULL;
+
+  if ( (pid = fork ()) < 0 )
+    {
+      fprintf (stderr, "Cannot start %s: %s\n", program, strerror (errno));
+      return -1;
+    }
+
+  if ( pid == 0 )
+    {
+      /* Discard the summary printed by ascii2mseed */
+      if ( ! freopen ("/dev/null", "w", stderr) )
+        _exit (127);
+
+      execv (program, args);
+      _exit (127);
+    }
+
+  if ( wait4 (pid, &status, 0, &usage) < 0 || ! WIFEXITED (status) || WEXITSTATUS (status) != 0 )
+    {
+      fprintf (stderr, "[%s] Conversion with %s failed\n", infile, program);
+      return -1;
+    }
+
+  if ( stat (outputfile, &st) )
+    {
+      fprintf (stderr, "Cannot stat output file: %s\n", outputfile);
+      return -1;
+    }
+
+  for ( seg = segments; seg; seg = seg->next )
+    result->samples += seg->samplecnt;
+
+  result->records = st.st_size / reclen;
+  result->bytes = ( stat (infile, &st) == 0 ) ? (int64_t) st.st_size : 0;
+  result->peakrss = usage.ru_maxrss;
+
+  return 0;
+}  /* End of stagefull() */
+
+
+/***************************************************************************
+ * encoderecord:
+ *
+ * Encode samples of a segment starting at offset into the data
+ * section of a record, in the same manner as msr_pack().
+ *
+ * Returns the number of samples encoded or -1 on error.
+ ***************************************************************************/
+static int
+encoderecord (BenchSegment *seg, int64_t offset, int32_t diff0,
+              char *record, int datasize)
+{
+  int64_t remaining = seg->samplecnt - offset;
+  int samplecount = ( remaining > INT32_MAX ) ? INT32_MAX : (int) remaining;
+  int swapflag = ( byteorder != ms_bigendianhost () );
+  int32_t *isamples = (int32_t *) seg->datasamples + offset;
+
+  switch ( seg->encoding )
+    {
+    case DE_INT16:
+      return msr_encode_int16 (isamples, samplecount, (int16_t *) record, datasize, swapflag);
+    case DE_INT32:
+      return msr_encode_int32 (isamples, samplecount, (int32_t *) record, datasize, swapflag);
+    case DE_FLOAT32:
+      return msr_encode_float32 ((float *) seg->datasamples + offset, samplecount,
+                                 (float *) record, datasize, swapflag);
+    case DE_FLOAT64:
+      return msr_encode_float64 ((double *) seg->datasamples + offset, samplecount,
+                                 (double *) record, datasize, swapflag);
+    case DE_STEIM1:
+      return msr_encode_steim1 (isamples, samplecount, (int32_t *) record, datasize,
+                                diff0, swapflag);
+    case DE_STEIM2:
+      return msr_encode_steim2 (isamples, samplecount, (int32_t *) record, datasize,
+                                diff0, seg->hdr.srcname, swapflag);
+    default:
+      fprintf (stderr, "Unsupported encoding: %d\n", seg->encoding);
+      return -1;
+    }
+}  /* End of encoderecord() */
+
+
+/***************************************************************************
+ * addsegment:
+ *
+ * Add a segment for a parsed header to the end of the segment list.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+addsegment (SegmentHeader *hdr, BenchSegment **seg)
+{
+  BenchSegment *newseg;
+  BenchSegment **last;
+
+  if ( hdr->samplecnt <= 0 || hdr->samplerate <= 0.0 )
+    return -1;
+
+  if ( ! (newseg = (BenchSegment *) calloc (1, sizeof (BenchSegment))) )
+    return -1;
+
+  newseg->hdr = *hdr;
+  newseg->samplecnt = hdr->samplecnt;
+  newseg->listtype = ( ! strcmp (hdr->listtype, "TSPAIR") ) ? 'T' : 'S';
+
+  if ( ! strcmp (hdr->sampletype, "FLOAT") )
+    {
+      newseg->datatype = 'f';
+      newseg->encoding = DE_FLOAT32;
+    }
+  else if ( ! strcmp (hdr->sampletype, "FLOAT64") )
+    {
+      newseg->datatype = 'd';
+      newseg->encoding = DE_FLOAT64;
+    }
+  else
+    {
+      newseg->datatype = 'i';
+      newseg->encoding = encoding;
+    }
+
+  if ( ! (newseg->datasamples = malloc (newseg->samplecnt * ms_samplesize (newseg->datatype))) )
+    {
+      free (newseg);
+      return -1;
+    }
+
+  for ( last = &segments; *last; last = &(*last)->next );
+  *last = newseg;
+  *seg = newseg;
+
+  return 0;
+}  /* End of addsegment() */
+
+
+/***************************************************************************
+ * freesegments:
+ *
+ * Free all parsed segments.
+ ***************************************************************************/
+static void
+freesegments (void)
+{
+  BenchSegment *seg;
+
+  while ( (seg = segments) )
+    {
+      segments = seg->next;
+      free (seg->datasamples);
+      free (seg);
+    }
+
+  recordcount = 0;
+}  /* End of freesegments() */
+
+
+/***************************************************************************
+ * peakrss:
+ *
+ * Returns the peak resident set size of this process in kilobytes.
+ ***************************************************************************/
+static int64_t
+peakrss (void)
+{
+  struct rusage usage;
+
+  if ( getrusage (RUSAGE_SELF, &usage) )
+    return 0;
+
+  return usage.ru_maxrss;
+}  /* End of peakrss() */
+
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns the index of the first input file on success, and -1 on
+ * failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for ( optind = 1; optind < argcount && argvec[optind][0] == '-'; optind++ )
+    {
+      if ( strcmp (argvec[optind], "-h") == 0 )
+        {
+          usage ();
+          exit (0);
+        }
+      else if ( optind + 1 >= argcount )
+        {
+          fprintf (stderr, "Option %s requires a value\n", argvec[optind]);
+          return -1;
+        }
+      else if ( strcmp (argvec[optind], "-n") == 0 )
+        repeat = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-e") == 0 )
+        encoding = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-r") == 0 )
+        reclen = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-p") == 0 )
+        program = argvec[++optind];
+      else if ( strcmp (argvec[optind], "-o") == 0 )
+        outputfile = argvec[++optind];
+      else
+        {
+          fprintf (stderr, "Unknown option: %s\n", argvec[optind]);
+          return -1;
+        }
+    }
+
+  if ( optind >= argcount )
+    {
+      fprintf (stderr, "No input files specified\n\n");
+      usage ();
+      return -1;
+    }
+
+  if ( repeat < 1 || reclen < 256 || reclen > MAXRECLEN || (reclen & (reclen - 1)) ||
+       (encoding != DE_INT16 && encoding != DE_INT32 &&
+        encoding != DE_STEIM1 && encoding != DE_STEIM2) )
+    {
+      fprintf (stderr, "Invalid parameter value\n");
+      return -1;
+    }
+
+  if ( ! (recordbuf = (char *) calloc (1, reclen)) )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return -1;
+    }
+
+  return optind;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * usage:
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark ascii2mseed conversion stages\n\n", PACKAGE);
+  fprintf (stderr, "Usage: %s [options] input1 [input2 ...]\n\n", PACKAGE);
+  fprintf (stderr,
+           " -h             Show this usage message\n"
+           " -n count       Number of runs of each stage, fastest is reported, default: 3\n"
+           " -e encoding    Encoding for integer samples, default: 11 (Steim2)\n"
+           " -r bytes       Record length, default: 4096\n"
+           " -p program     Path to ascii2mseed, default: ../ascii2mseed\n"
+           " -o outfile     Output file for write and full stages, default: a2mbench.mseed\n"
+           "\n"
+           "Results are printed as a JSON object per line for each stage of each input.\n"
+           "\n");
+}  /* End of usage() */
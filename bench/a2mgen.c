@@ -0,0 +1,282 @@
+/***************************************************************************
+ * a2mgen.c
+ *
+ * Generate synthetic ASCII time series input for ascii2mseed
+ * benchmarks.  Each channel is written as a TIMESERIES segment in
+ * SLIST or TSPAIR format with INTEGER, FLOAT or FLOAT64 samples.
+ *
+ * Samples are a mix of sinusoids and noise, scaled to a specified
+ * amplitude, from a seeded generator so that the output is
+ * reproducible.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libmseed.h>
+
+#define PACKAGE "a2mgen"
+
+static int      channels   = 1;
+static int64_t  samples    = 100000;
+static double   samprate   = 100.0;
+static char     listtype   = 'S';
+static char     datatype   = 'i';
+static double   amplitude  = 100000.0;
+static double   noise      = 0.1;
+static uint64_t seed       = 1;
+static char    *outputfile = NULL;
+
+static uint64_t rngstate;
+
+static int generate (FILE *ofp, int channel);
+static double nextsample (int64_t idx, int channel);
+static double uniform (void);
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+
+int
+main (int argc, char **argv)
+{
+  FILE *ofp;
+  int channel;
+
+  if ( parameter_proc (argc, argv) < 0 )
+    return 1;
+
+  if ( (ofp = fopen (outputfile, "wb")) == NULL )
+    {
+      fprintf (stderr, "Cannot open output file: %s\n", outputfile);
+      return 1;
+    }
+
+  rngstate = seed;
+
+  for ( channel = 0; channel < channels; channel++ )
+    {
+      if ( generate (ofp, channel) )
+        {
+          fclose (ofp);
+          return 1;
+        }
+    }
+
+  if ( fclose (ofp) )
+    {
+      fprintf (stderr, "Error writing output file: %s\n", outputfile);
+      return 1;
+    }
+
+  return 0;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * generate:
+ *
+ * Write a TIMESERIES segment for a channel.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+generate (FILE *ofp, int channel)
+{
+  hptime_t starttime;
+  hptime_t sampletime;
+  char timestr[50];
+  double value;
+  int64_t idx;
+
+  starttime = ms_timestr2hptime ("2020-01-01T00:00:00.000000");
+
+  ms_hptime2isotimestr (starttime, timestr, 1);
+
+  fprintf (ofp, "TIMESERIES XX_BENCH_00_H%02d_D, %lld samples, %g sps, %s, %s, %s, Counts\n",
+           channel, (long long int) samples, samprate, timestr,
+           ( listtype == 'S' ) ? "SLIST" : "TSPAIR",
+           ( datatype == 'i' ) ? "INTEGER" : ( datatype == 'f' ) ? "FLOAT" : "FLOAT64");
+
+  for ( idx = 0; idx < samples; idx++ )
+    {
+      value = nextsample (idx, channel);
+
+      if ( listtype == 'T' )
+        {
+          sampletime = starttime + (hptime_t) (idx * (HPTMODULUS / samprate) + 0.5);
+          fprintf (ofp, "%s  ", ms_hptime2isotimestr (sampletime, timestr, 1));
+        }
+
+      if ( datatype == 'i' )
+        fprintf (ofp, "%10d", (int32_t) lrint (value));
+      else if ( datatype == 'f' )
+        fprintf (ofp, "%.8g", value);
+      else
+        fprintf (ofp, "%.17g", value);
+
+      if ( listtype == 'T' || idx % 6 == 5 || idx == samples - 1 )
+        fputc ('\n', ofp);
+      else
+        fputs ("  ", ofp);
+    }
+
+  return ( ferror (ofp) ) ? -1 : 0;
+}  /* End of generate() */
+
+
+/***************************************************************************
+ * nextsample:
+ *
+ * Returns the sample value at idx for a channel, a sum of sinusoids
+ * with channel dependent periods plus noise, within the amplitude.
+ ***************************************************************************/
+static double
+nextsample (int64_t idx, int channel)
+{
+  double t = idx / samprate;
+  double signal;
+
+  signal = 0.6 * sin (2 * M_PI * t / (20.0 + channel)) +
+           0.3 * sin (2 * M_PI * t / (1.0 + 0.1 * channel));
+
+  signal = (1.0 - noise) * signal + noise * (2.0 * uniform () - 1.0);
+
+  return amplitude * signal;
+}  /* End of nextsample() */
+
+
+/***************************************************************************
+ * uniform:
+ *
+ * Returns a pseudo-random value in [0,1) from a xorshift64* generator.
+ ***************************************************************************/
+static double
+uniform (void)
+{
+  rngstate ^= rngstate >> 12;
+  rngstate ^= rngstate << 25;
+  rngstate ^= rngstate >> 27;
+
+  return ((rngstate * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}  /* End of uniform() */
+
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  for ( optind = 1; optind < argcount; optind++ )
+    {
+      if ( strcmp (argvec[optind], "-h") == 0 )
+        {
+          usage ();
+          exit (0);
+        }
+      else if ( optind + 1 >= argcount && argvec[optind][0] == '-' )
+        {
+          fprintf (stderr, "Option %s requires a value\n", argvec[optind]);
+          return -1;
+        }
+      else if ( strcmp (argvec[optind], "-c") == 0 )
+        channels = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-n") == 0 )
+        samples = strtoll (argvec[++optind], NULL, 10);
+      else if ( strcmp (argvec[optind], "-r") == 0 )
+        samprate = strtod (argvec[++optind], NULL);
+      else if ( strcmp (argvec[optind], "-a") == 0 )
+        amplitude = strtod (argvec[++optind], NULL);
+      else if ( strcmp (argvec[optind], "-N") == 0 )
+        noise = strtod (argvec[++optind], NULL);
+      else if ( strcmp (argvec[optind], "-s") == 0 )
+        seed = strtoull (argvec[++optind], NULL, 10);
+      else if ( strcmp (argvec[optind], "-t") == 0 )
+        {
+          optind++;
+          if ( ! strcmp (argvec[optind], "SLIST") )
+            listtype = 'S';
+          else if ( ! strcmp (argvec[optind], "TSPAIR") )
+            listtype = 'T';
+          else
+            {
+              fprintf (stderr, "Unrecognized list type: %s\n", argvec[optind]);
+              return -1;
+            }
+        }
+      else if ( strcmp (argvec[optind], "-d") == 0 )
+        {
+          optind++;
+          if ( ! strcmp (argvec[optind], "INTEGER") )
+            datatype = 'i';
+          else if ( ! strcmp (argvec[optind], "FLOAT") )
+            datatype = 'f';
+          else if ( ! strcmp (argvec[optind], "FLOAT64") )
+            datatype = 'd';
+          else
+            {
+              fprintf (stderr, "Unrecognized sample type: %s\n", argvec[optind]);
+              return -1;
+            }
+        }
+      else if ( strncmp (argvec[optind], "-", 1) == 0 )
+        {
+          fprintf (stderr, "Unknown option: %s\n", argvec[optind]);
+          return -1;
+        }
+      else if ( ! outputfile )
+        outputfile = argvec[optind];
+      else
+        {
+          fprintf (stderr, "Unexpected argument: %s\n", argvec[optind]);
+          return -1;
+        }
+    }
+
+  if ( ! outputfile )
+    {
+      fprintf (stderr, "No output file specified\n\n");
+      usage ();
+      return -1;
+    }
+
+  if ( channels < 1 || channels > 100 || samples < 1 ||
+       samprate <= 0.0 || amplitude < 0.0 || amplitude > 2147483647.0 ||
+       noise < 0.0 || noise > 1.0 || seed == 0 )
+    {
+      fprintf (stderr, "Invalid parameter value\n");
+      return -1;
+    }
+
+  return 0;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * usage:
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Generate synthetic ASCII time series\n\n", PACKAGE);
+  fprintf (stderr, "Usage: %s [options] outputfile\n\n", PACKAGE);
+  fprintf (stderr,
+           " -h             Show this usage message\n"
+           " -c channels    Number of channels, each a segment, default: 1\n"
+           " -n samples     Number of samples per channel, default: 100000\n"
+           " -r rate        Sample rate, default: 100\n"
+           " -t listtype    SLIST or TSPAIR, default: SLIST\n"
+           " -d sampletype  INTEGER, FLOAT or FLOAT64, default: INTEGER\n"
+           " -a amplitude   Maximum sample magnitude, default: 100000\n"
+           " -N noise       Fraction of noise in signal, 0 to 1, default: 0.1\n"
+           " -s seed        Non-zero seed for noise generator, default: 1\n"
+           "\n");
+}  /* End of usage() */
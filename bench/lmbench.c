@@ -0,0 +1,525 @@
+/***************************************************************************
+ * lmbench.c
+ *
+ * Benchmark the libmseed data sample encoders (packdata.c) and
+ * decoders (unpackdata.c).
+ *
+ * Each encoding is benchmarked with several test signals, with and
+ * without byte swapping.  A signal is encoded into consecutive
+ * records as done by msr_pack() and the records are decoded again,
+ * the decoded samples are verified against the signal.  Each pass is
+ * run a number of times and the fastest is reported as a line of JSON
+ * including nanoseconds per sample and megabytes of samples per
+ * second.
+ *
+ * The SIMD level used by the Steim encoders and decoders can be
+ * limited to compare optimized kernels against the scalar code.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libmseed.h>
+#include <packdata.h>
+#include <unpackdata.h>
+
+#include "stats.h"
+
+#define PACKAGE "lmbench"
+
+/* Encodings to benchmark and the sample type of each */
+static const struct {
+  int encoding;
+  const char *name;
+  char sampletype;
+} codecs[] = {
+  { DE_INT16,   "int16",   'i' },
+  { DE_INT32,   "int32",   'i' },
+  { DE_FLOAT32, "float32", 'f' },
+  { DE_FLOAT64, "float64", 'd' },
+  { DE_STEIM1,  "steim1",  'i' },
+  { DE_STEIM2,  "steim2",  'i' },
+};
+
+/* Test signals, all within the 16-bit integer range */
+static const char *signals[] = { "seismic", "noise", "constant", "step" };
+
+#define CODECCOUNT (int)(sizeof (codecs) / sizeof (codecs[0]))
+#define SIGNALCOUNT (int)(sizeof (signals) / sizeof (signals[0]))
+
+static int   samplecount = 1000000;
+static int   repeat      = 5;
+static int   reclen      = 4096;
+static int   simdlevel   = -1;
+static int   encodingsel = -1;
+static char *signalsel   = NULL;
+
+/* Encoded records of a signal */
+static char *recorddata = NULL;     /* Data sections of records */
+static int  *recordsamples = NULL;  /* Sample count of each record */
+static int   recordcount = 0;
+static int   recordsize = 0;        /* Allocated number of records */
+
+static int benchcodec (int codec, int signal, int swapflag,
+                       void *samples, void *decoded);
+static int encode (int codec, void *samples, int swapflag);
+static int decode (int codec, void *decoded, int swapflag);
+static void makesignal (int signal, int32_t *isamples, float *fsamples, double *dsamples);
+static void report (int codec, int signal, int swapflag, const char *operation,
+                    double seconds);
+static int parameter_proc (int argcount, char **argvec);
+static void usage (void);
+
+
+int
+main (int argc, char **argv)
+{
+  int32_t *isamples;
+  float *fsamples;
+  double *dsamples;
+  void *decoded;
+  void *samples;
+  int codec;
+  int signal;
+  int swapflag;
+  int rv = 0;
+
+  if ( parameter_proc (argc, argv) < 0 )
+    return 1;
+
+  encodesimd = simdlevel;
+  decodesimd = simdlevel;
+
+  isamples = (int32_t *) malloc (samplecount * sizeof (int32_t));
+  fsamples = (float *) malloc (samplecount * sizeof (float));
+  dsamples = (double *) malloc (samplecount * sizeof (double));
+  decoded = malloc (samplecount * sizeof (double));
+
+  if ( ! isamples || ! fsamples || ! dsamples || ! decoded )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return 1;
+    }
+
+  for ( signal = 0; signal < SIGNALCOUNT; signal++ )
+    {
+      if ( signalsel && strcmp (signalsel, signals[signal]) )
+        continue;
+
+      makesignal (signal, isamples, fsamples, dsamples);
+
+      for ( codec = 0; codec < CODECCOUNT; codec++ )
+        {
+          if ( encodingsel >= 0 && encodingsel != codecs[codec].encoding )
+            continue;
+
+          samples = ( codecs[codec].sampletype == 'f' ) ? (void *) fsamples :
+                    ( codecs[codec].sampletype == 'd' ) ? (void *) dsamples : (void *) isamples;
+
+          for ( swapflag = 0; swapflag <= 1; swapflag++ )
+            {
+              if ( benchcodec (codec, signal, swapflag, samples, decoded) )
+                rv = 1;
+            }
+        }
+    }
+
+  free (isamples);
+  free (fsamples);
+  free (dsamples);
+  free (decoded);
+  free (recorddata);
+  free (recordsamples);
+
+  return rv;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * benchcodec:
+ *
+ * Benchmark encoding and decoding of a signal and verify the decoded
+ * samples.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+benchcodec (int codec, int signal, int swapflag, void *samples, void *decoded)
+{
+  double encodebest = -1.0;
+  double decodebest = -1.0;
+  double start;
+  double seconds;
+  int iteration;
+
+  for ( iteration = 0; iteration < repeat; iteration++ )
+    {
+      start = st_now ();
+      if ( encode (codec, samples, swapflag) )
+        return -1;
+      seconds = st_now () - start;
+
+      if ( encodebest < 0.0 || seconds < encodebest )
+        encodebest = seconds;
+
+      memset (decoded, 0, samplecount * ms_samplesize (codecs[codec].sampletype));
+
+      start = st_now ();
+      if ( decode (codec, decoded, swapflag) )
+        return -1;
+      seconds = st_now () - start;
+
+      if ( decodebest < 0.0 || seconds < decodebest )
+        decodebest = seconds;
+
+      if ( memcmp (samples, decoded, samplecount * ms_samplesize (codecs[codec].sampletype)) )
+        {
+          fprintf (stderr, "Decoded %s samples of %s signal do not match\n",
+                   codecs[codec].name, signals[signal]);
+          return -1;
+        }
+    }
+
+  report (codec, signal, swapflag, "encode", encodebest);
+  report (codec, signal, swapflag, "decode", decodebest);
+
+  return 0;
+}  /* End of benchcodec() */
+
+
+/***************************************************************************
+ * encode:
+ *
+ * Encode all samples into the data sections of consecutive records.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+encode (int codec, void *samples, int swapflag)
+{
+  int datasize = reclen - 64;
+  int32_t *isamples = (int32_t *) samples;
+  int32_t diff0;
+  char *output;
+  char *newdata;
+  int *newsamples;
+  int offset;
+  int remaining;
+  int count = 0;
+
+  recordcount = 0;
+
+  for ( offset = 0; offset < samplecount; offset += count )
+    {
+      if ( recordcount == recordsize )
+        {
+          recordsize = ( recordsize ) ? recordsize * 2 : 1024;
+
+          newdata = (char *) realloc (recorddata, (size_t) recordsize * datasize);
+          newsamples = (int *) realloc (recordsamples, recordsize * sizeof (int));
+
+          if ( newdata )
+            recorddata = newdata;
+          if ( newsamples )
+            recordsamples = newsamples;
+
+          if ( ! newdata || ! newsamples )
+            {
+              fprintf (stderr, "Cannot allocate memory\n");
+              return -1;
+            }
+        }
+
+      output = recorddata + (size_t) recordcount * datasize;
+      remaining = samplecount - offset;
+      diff0 = ( offset > 0 ) ? isamples[offset] - isamples[offset - 1] : 0;
+
+      switch ( codecs[codec].encoding )
+        {
+        case DE_INT16:
+          count = msr_encode_int16 (isamples + offset, remaining, (int16_t *) output,
+                                    datasize, swapflag);
+          break;
+        case DE_INT32:
+          count = msr_encode_int32 (isamples + offset, remaining, (int32_t *) output,
+                                    datasize, swapflag);
+          break;
+        case DE_FLOAT32:
+          count = msr_encode_float32 ((float *) samples + offset, remaining, (float *) output,
+                                      datasize, swapflag);
+          break;
+        case DE_FLOAT64:
+          count = msr_encode_float64 ((double *) samples + offset, remaining, (double *) output,
+                                      datasize, swapflag);
+          break;
+        case DE_STEIM1:
+          count = msr_encode_steim1 (isamples + offset, remaining, (int32_t *) output,
+                                     datasize, diff0, swapflag);
+          break;
+        case DE_STEIM2:
+          count = msr_encode_steim2 (isamples + offset, remaining, (int32_t *) output,
+                                     datasize, diff0, PACKAGE, swapflag);
+          break;
+        }
+
+      if ( count <= 0 )
+        {
+          fprintf (stderr, "Error encoding %s samples\n", codecs[codec].name);
+          return -1;
+        }
+
+      recordsamples[recordcount++] = count;
+    }
+
+  return 0;
+}  /* End of encode() */
+
+
+/***************************************************************************
+ * decode:
+ *
+ * Decode the samples of all encoded records.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+decode (int codec, void *decoded, int swapflag)
+{
+  int datasize = reclen - 64;
+  char *input;
+  int recidx;
+  int offset = 0;
+  int outputlength;
+  int count = 0;
+
+  for ( recidx = 0; recidx < recordcount; recidx++ )
+    {
+      input = recorddata + (size_t) recidx * datasize;
+      outputlength = (samplecount - offset) * ms_samplesize (codecs[codec].sampletype);
+
+      switch ( codecs[codec].encoding )
+        {
+        case DE_INT16:
+          count = msr_decode_int16 ((int16_t *) input, recordsamples[recidx],
+                                    (int32_t *) decoded + offset, outputlength, swapflag);
+          break;
+        case DE_INT32:
+          count = msr_decode_int32 ((int32_t *) input, recordsamples[recidx],
+                                    (int32_t *) decoded + offset, outputlength, swapflag);
+          break;
+        case DE_FLOAT32:
+          count = msr_decode_float32 ((float *) input, recordsamples[recidx],
+                                      (float *) decoded + offset, outputlength, swapflag);
+          break;
+        case DE_FLOAT64:
+          count = msr_decode_float64 ((double *) input, recordsamples[recidx],
+                                      (double *) decoded + offset, outputlength, swapflag);
+          break;
+        case DE_STEIM1:
+          count = msr_decode_steim1 ((int32_t *) input, datasize, recordsamples[recidx],
+                                     (int32_t *) decoded + offset, outputlength,
+                                     PACKAGE, swapflag);
+          break;
+        case DE_STEIM2:
+          count = msr_decode_steim2 ((int32_t *) input, datasize, recordsamples[recidx],
+                                     (int32_t *) decoded + offset, outputlength,
+                                     PACKAGE, swapflag);
+          break;
+        }
+
+      if ( count != recordsamples[recidx] )
+        {
+          fprintf (stderr, "Error decoding %s samples\n", codecs[codec].name);
+          return -1;
+        }
+
+      offset += count;
+    }
+
+  return 0;
+}  /* End of decode() */
+
+
+/***************************************************************************
+ * makesignal:
+ *
+ * Generate a test signal as 32-bit integer, float and double samples:
+ *
+ *   seismic  : sinusoids with increasing amplitude plus noise
+ *   noise    : uniform white noise over most of the 16-bit range
+ *   constant : a constant value
+ *   step     : steps between two levels every 1000 samples
+ ***************************************************************************/
+static void
+makesignal (int signal, int32_t *isamples, float *fsamples, double *dsamples)
+{
+  uint64_t state = 1;
+  double noise;
+  double value;
+  int idx;
+
+  for ( idx = 0; idx < samplecount; idx++ )
+    {
+      /* xorshift64* generator, uniform in [-1,1) */
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+      noise = ((state * 2685821657736338717ULL) >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+
+      switch ( signal )
+        {
+        case 0:
+          value = (0.2 + 0.7 * (idx % 20000) / 20000.0) *
+                  (25000.0 * sin (2 * M_PI * idx / 2000.0) + 5000.0 * sin (2 * M_PI * idx / 45.0)) +
+                  200.0 * noise;
+          break;
+        case 1:
+          value = 30000.0 * noise;
+          break;
+        case 2:
+          value = 1234.0;
+          break;
+        default:
+          value = ( (idx / 1000) % 2 ) ? 20000.0 : -500.0;
+          break;
+        }
+
+      isamples[idx] = (int32_t) lrint (value);
+      fsamples[idx] = (float) value;
+      dsamples[idx] = value;
+    }
+}  /* End of makesignal() */
+
+
+/***************************************************************************
+ * report:
+ *
+ * Print the result of a benchmark as a JSON object on a line.  The
+ * data rate is of the unencoded samples in megabytes (10^6 bytes) per
+ * second.
+ ***************************************************************************/
+static void
+report (int codec, int signal, int swapflag, const char *operation, double seconds)
+{
+  double bytes = (double) samplecount * ms_samplesize (codecs[codec].sampletype);
+  int simd = lmp_simdlevel ();
+
+  if ( simdlevel >= 0 && simdlevel < simd )
+    simd = simdlevel;
+
+  if ( seconds <= 0.0 )
+    seconds = 1e-9;
+
+  printf ("{\"encoding\": \"%s\", \"signal\": \"%s\", \"swap\": %d, \"operation\": \"%s\", "
+          "\"simd\": %d, \"samples\": %d, \"records\": %d, \"seconds\": %.6f, "
+          "\"ns_per_sample\": %.3f, \"mb_per_sec\": %.1f}\n",
+          codecs[codec].name, signals[signal], swapflag, operation, simd,
+          samplecount, recordcount, seconds, seconds * 1e9 / samplecount,
+          bytes / seconds / 1e6);
+  fflush (stdout);
+}  /* End of report() */
+
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+  int idx;
+
+  for ( optind = 1; optind < argcount; optind++ )
+    {
+      if ( strcmp (argvec[optind], "-h") == 0 )
+        {
+          usage ();
+          exit (0);
+        }
+      else if ( optind + 1 >= argcount )
+        {
+          fprintf (stderr, "Unknown option or missing value: %s\n", argvec[optind]);
+          return -1;
+        }
+      else if ( strcmp (argvec[optind], "-n") == 0 )
+        samplecount = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-r") == 0 )
+        repeat = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-R") == 0 )
+        reclen = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-s") == 0 )
+        simdlevel = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-e") == 0 )
+        encodingsel = atoi (argvec[++optind]);
+      else if ( strcmp (argvec[optind], "-g") == 0 )
+        signalsel = argvec[++optind];
+      else
+        {
+          fprintf (stderr, "Unknown option: %s\n", argvec[optind]);
+          return -1;
+        }
+    }
+
+  if ( samplecount < 1 || repeat < 1 || simdlevel < -1 ||
+       reclen < 128 || reclen > MAXRECLEN || (reclen & (reclen - 1)) )
+    {
+      fprintf (stderr, "Invalid parameter value\n");
+      return -1;
+    }
+
+  if ( encodingsel >= 0 )
+    {
+      for ( idx = 0; idx < CODECCOUNT; idx++ )
+        if ( codecs[idx].encoding == encodingsel )
+          break;
+
+      if ( idx == CODECCOUNT )
+        {
+          fprintf (stderr, "Unsupported encoding: %d\n", encodingsel);
+          return -1;
+        }
+    }
+
+  if ( signalsel )
+    {
+      for ( idx = 0; idx < SIGNALCOUNT; idx++ )
+        if ( ! strcmp (signals[idx], signalsel) )
+          break;
+
+      if ( idx == SIGNALCOUNT )
+        {
+          fprintf (stderr, "Unknown signal: %s\n", signalsel);
+          return -1;
+        }
+    }
+
+  return 0;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * usage:
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Benchmark libmseed encoders and decoders\n\n", PACKAGE);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr,
+           " -h             Show this usage message\n"
+           " -n samples     Number of samples in each signal, default: 1000000\n"
+           " -r count       Number of runs of each benchmark, fastest is reported, default: 5\n"
+           " -R bytes       Record length, default: 4096\n"
+           " -s level       Highest SIMD level for Steim codecs, 0 for scalar, default: -1 (all)\n"
+           " -e encoding    Only benchmark this encoding: 1, 3, 4, 5, 10 or 11\n"
+           " -g signal      Only benchmark this signal: seismic, noise, constant or step\n"
+           "\n"
+           "Results are printed as a JSON object per line for each benchmark.\n"
+           "\n");
+}  /* End of usage() */
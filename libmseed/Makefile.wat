@@ -21,7 +21,8 @@ DLL = libmseed.dll
 
 INCS = -I.
 
-OBJS=	fileutils.obj	&
+OBJS=	arena.obj	&
+	fileutils.obj	&
 	genutils.obj	&
 	gswap.obj	&
 	lmplatform.obj	&
@@ -46,6 +47,7 @@ dll:	$(OBJS) .SYMBOLIC
 	wlink $(lflags) name libmseed file {$(OBJS)}
 
 # Source dependencies:
+arena.obj:	arena.c libmseed.h
 fileutils.obj:	fileutils.c libmseed.h
 genutils.obj:	genutils.c libmseed.h
 gswap.obj:	gswap.c libmseed.h
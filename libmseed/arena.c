@@ -0,0 +1,218 @@
+/***************************************************************************
+ * arena.c:
+ *
+ * Arena allocation for structures that are freed together.
+ *
+ * Memory is allocated from blocks by advancing an offset, individual
+ * allocations are never freed.  All memory of an arena is released at
+ * once when the arena is reset or freed.  Each new block is twice the
+ * size of the previous one so an arena has few blocks.
+ *
+ * modified: 2026.289
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libmseed.h"
+
+/* Default size of the first block of an arena */
+#define ARENA_BLOCKSIZE 16384
+
+/* Alignment of allocations, sufficient for any structure */
+#define ARENA_ALIGN 16
+
+/* Block of memory in an arena */
+typedef struct MSArenaBlock_s
+{
+  struct MSArenaBlock_s *next; /* Previous block allocated */
+  size_t size;                 /* Usable size of block */
+} MSArenaBlock;
+
+/* Arena of blocks, the current block is first */
+struct MSArena_s
+{
+  MSArenaBlock *blocks;  /* Blocks, most recent first */
+  size_t blocksize;      /* Size of the first block */
+  size_t used;           /* Bytes used in the current block */
+};
+
+/* Offset of the usable memory of a block */
+#define ARENA_HEADER ((sizeof (MSArenaBlock) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+static MSArenaBlock *ms_arena_newblock (MSArena *arena, size_t size);
+
+/***************************************************************************
+ * ms_arena_init:
+ *
+ * Allocate and initialize an arena.  The size of the first block is
+ * blocksize bytes, or a default size if blocksize is 0.  No block is
+ * allocated until memory is requested.
+ *
+ * Returns a pointer to a MSArena on success or NULL on error.
+ ***************************************************************************/
+MSArena *
+ms_arena_init (size_t blocksize)
+{
+  MSArena *arena;
+
+  if (!(arena = (MSArena *)malloc (sizeof (MSArena))))
+  {
+    ms_log (2, "ms_arena_init(): Cannot allocate memory\n");
+    return NULL;
+  }
+
+  arena->blocks    = NULL;
+  arena->blocksize = (blocksize) ? blocksize : ARENA_BLOCKSIZE;
+  arena->used      = 0;
+
+  return arena;
+} /* End of ms_arena_init() */
+
+/***************************************************************************
+ * ms_arena_alloc:
+ *
+ * Allocate size bytes of zeroed memory from an arena.  The memory is
+ * suitably aligned for any structure and remains valid until the
+ * arena is reset or freed, it must not be passed to free().
+ *
+ * Returns a pointer to the memory on success or NULL on error.
+ ***************************************************************************/
+void *
+ms_arena_alloc (MSArena *arena, size_t size)
+{
+  MSArenaBlock *block;
+  void *ptr;
+
+  if (!arena)
+    return NULL;
+
+  size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+  block = arena->blocks;
+
+  if (!block || block->size - arena->used < size)
+  {
+    if (!(block = ms_arena_newblock (arena, size)))
+      return NULL;
+  }
+
+  ptr = (char *)block + ARENA_HEADER + arena->used;
+  arena->used += size;
+
+  memset (ptr, 0, size);
+
+  return ptr;
+} /* End of ms_arena_alloc() */
+
+/***************************************************************************
+ * ms_arena_contains:
+ *
+ * Determine if memory was allocated from an arena.
+ *
+ * Returns 1 if ptr is within a block of the arena, otherwise 0.
+ ***************************************************************************/
+int
+ms_arena_contains (MSArena *arena, const void *ptr)
+{
+  MSArenaBlock *block;
+  const char *start;
+
+  if (!arena || !ptr)
+    return 0;
+
+  for (block = arena->blocks; block; block = block->next)
+  {
+    start = (const char *)block + ARENA_HEADER;
+
+    if ((const char *)ptr >= start && (const char *)ptr < start + block->size)
+      return 1;
+  }
+
+  return 0;
+} /* End of ms_arena_contains() */
+
+/***************************************************************************
+ * ms_arena_reset:
+ *
+ * Release all memory allocated from an arena.  The largest block is
+ * kept for reuse, all other blocks are freed.
+ ***************************************************************************/
+void
+ms_arena_reset (MSArena *arena)
+{
+  MSArenaBlock *block;
+  MSArenaBlock *next;
+
+  if (!arena || !arena->blocks)
+    return;
+
+  /* The most recent block is the largest */
+  for (block = arena->blocks->next; block; block = next)
+  {
+    next = block->next;
+    free (block);
+  }
+
+  arena->blocks->next = NULL;
+  arena->used         = 0;
+} /* End of ms_arena_reset() */
+
+/***************************************************************************
+ * ms_arena_free:
+ *
+ * Free an arena including all memory allocated from it and set the
+ * pointer to NULL.
+ ***************************************************************************/
+void
+ms_arena_free (MSArena **pparena)
+{
+  MSArenaBlock *block;
+  MSArenaBlock *next;
+
+  if (!pparena || !*pparena)
+    return;
+
+  for (block = (*pparena)->blocks; block; block = next)
+  {
+    next = block->next;
+    free (block);
+  }
+
+  free (*pparena);
+  *pparena = NULL;
+} /* End of ms_arena_free() */
+
+/***************************************************************************
+ * ms_arena_newblock:
+ *
+ * Add a block to an arena with at least size bytes, twice the size of
+ * the current block or the first block size if none.
+ *
+ * Returns a pointer to the new block on success or NULL on error.
+ ***************************************************************************/
+static MSArenaBlock *
+ms_arena_newblock (MSArena *arena, size_t size)
+{
+  MSArenaBlock *block;
+  size_t blocksize;
+
+  blocksize = (arena->blocks) ? arena->blocks->size * 2 : arena->blocksize;
+
+  if (blocksize < size)
+    blocksize = size;
+
+  if (!(block = (MSArenaBlock *)malloc (ARENA_HEADER + blocksize)))
+  {
+    ms_log (2, "ms_arena_alloc(): Cannot allocate memory\n");
+    return NULL;
+  }
+
+  block->next   = arena->blocks;
+  block->size   = blocksize;
+  arena->blocks = block;
+  arena->used   = 0;
+
+  return block;
+} /* End of ms_arena_newblock() */
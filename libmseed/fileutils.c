@@ -297,6 +297,11 @@ ms_readmsr_main (MSFileParam **ppmsfp, MSRecord **ppmsr, const char *msfile,
     return MS_NOERROR;
   }
 
+  /* Blockettes of records read are allocated from an arena of the
+     MSRecord, which is reset for each record */
+  if (*ppmsr && !(*ppmsr)->arena)
+    (*ppmsr)->arena = ms_arena_init (1024);
+
   /* Allocate reading buffer */
   if (msfp->rawrec == NULL)
   {
@@ -798,6 +803,10 @@ ms_readtraces_selection (MSTraceGroup **ppmstg, const char *msfile,
       return MS_GENERROR;
   }
 
+  /* Index traces by channel while adding records, the index is
+     disabled afterwards as the caller may modify the traces */
+  mst_groupindex (*ppmstg, 1);
+
   /* Loop over the input file */
   while ((retcode = ms_readmsr_main (&msfp, &msr, msfile, reclen, NULL, NULL,
                                      skipnotdata, dataflag, NULL, verbose)) == MS_NOERROR)
@@ -821,6 +830,8 @@ ms_readtraces_selection (MSTraceGroup **ppmstg, const char *msfile,
     mst_addmsrtogroup (*ppmstg, msr, dataquality, timetol, sampratetol);
   }
 
+  mst_groupindex (*ppmstg, 0);
+
   /* Reset return code to MS_NOERROR on successful read by ms_readmsr() */
   if (retcode == MS_ENDOFFILE)
     retcode = MS_NOERROR;
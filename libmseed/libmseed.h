@@ -54,6 +54,24 @@ extern "C" {
   #define LMP_PACKED
 #endif
 
+/* SIMD code paths are compiled for x86 processors with compilers
+   supporting per-function target attributes and run time CPU
+   detection (GCC and Clang), and are selected at run time based on
+   the instruction sets supported by the CPU.
+
+   If "LMP_NOSIMD" is defined at compile time (e.g. -DLMP_NOSIMD)
+   only the portable code paths are compiled.
+  */
+#if !defined(LMP_NOSIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+  #define LMP_X86SIMD 1
+#endif
+
+/* SIMD instruction set levels returned by lmp_simdlevel() */
+#define LMP_SIMD_NONE 0
+#define LMP_SIMD_SSE2 1
+#define LMP_SIMD_AVX2 2
+
 /* Set platform specific defines */
 #if defined(__linux__) || defined(__linux) || defined(__CYGWIN__)
   #define LMP_LINUX 1
@@ -461,6 +479,7 @@ typedef struct StreamState_s
   int64_t   packedsamples;           /* Count of packed samples */
   int32_t   lastintsample;           /* Value of last integer sample packed */
   flag      comphistory;             /* Control use of lastintsample for compression history */
+  struct PackContext_s *packctx;     /* Cached packing state, private to msr_pack() */
 }
 StreamState;
 
@@ -495,6 +514,8 @@ typedef struct MSRecord_s {
 
   /* Stream oriented state information */
   StreamState    *ststate;           /* Stream processing state information */
+
+  struct MSArena_s *arena;           /* Arena for the blockette chain, NULL to use the heap */
 }
 MSRecord;
 
@@ -523,6 +544,8 @@ MSTrace;
 typedef struct MSTraceGroup_s {
   int32_t           numtraces;       /* Number of MSTraces in the trace chain */
   struct MSTrace_s *traces;          /* Root of the trace chain */
+  struct MSTraceGroupIndex_s *index; /* Index of traces, private to traceutils.c */
+  struct MSArena_s *arena;           /* Arena for new MSTraces, NULL to use the heap */
 }
 MSTraceGroup;
 
@@ -557,6 +580,7 @@ typedef struct MSTraceID_s {
   struct MSTraceSeg_s *first;        /* Pointer to first of list of segments */
   struct MSTraceSeg_s *last;         /* Pointer to last of list of segments */
   struct MSTraceID_s *next;          /* Pointer to next trace */
+  struct MSTraceSegIndex_s *index;   /* Index of segments, private to mstl_addmsr() */
 }
 MSTraceID;
 
@@ -565,6 +589,8 @@ typedef struct MSTraceList_s {
   int32_t             numtraces;     /* Number of traces in list */
   struct MSTraceID_s *traces;        /* Pointer to list of traces */
   struct MSTraceID_s *last;          /* Pointer to last used trace in list */
+  struct MSTraceIndex_s *index;      /* Index of trace IDs, private to mstl_addmsr() */
+  struct MSArena_s *arena;           /* Arena for MSTraceIDs and MSTraceSegs, NULL to use the heap */
 }
 MSTraceList;
 
@@ -620,6 +646,8 @@ extern int           msr_pack (MSRecord *msr, void (*record_handler) (char *, in
 
 extern int           msr_pack_header (MSRecord *msr, flag normalize, flag verbose);
 
+extern void          msr_free_ststate (StreamState **ppststate);
+
 extern int           msr_unpack_data (MSRecord *msr, int swapflag, flag verbose);
 
 extern MSRecord*     msr_init (MSRecord *msr);
@@ -660,6 +688,7 @@ extern int           mst_addspan (MSTrace *mst, hptime_t starttime,  hptime_t en
 extern MSTrace*      mst_addmsrtogroup (MSTraceGroup *mstg, MSRecord *msr, flag dataquality,
 					double timetol, double sampratetol);
 extern MSTrace*      mst_addtracetogroup (MSTraceGroup *mstg, MSTrace *mst);
+extern int           mst_groupindex (MSTraceGroup *mstg, flag enable);
 extern int           mst_groupheal (MSTraceGroup *mstg, double timetol, double sampratetol);
 extern int           mst_groupsort (MSTraceGroup *mstg, flag quality);
 extern int           mst_convertsamples (MSTrace *mst, char type, flag truncate);
@@ -766,6 +795,15 @@ extern char*    ms_blktdesc (uint16_t blkttype);
 extern uint16_t ms_blktlen (uint16_t blkttype, const char *blktdata, flag swapflag);
 extern char *   ms_errorstr (int errorcode);
 
+/* Arena allocation, memory released together */
+typedef struct MSArena_s MSArena;
+
+extern MSArena *ms_arena_init (size_t blocksize);
+extern void *   ms_arena_alloc (MSArena *arena, size_t size);
+extern int      ms_arena_contains (MSArena *arena, const void *ptr);
+extern void     ms_arena_reset (MSArena *arena);
+extern void     ms_arena_free (MSArena **pparena);
+
 /* Logging facility */
 #define MAX_LOG_MSG_LENGTH  200      /* Maximum length of log messages */
 
@@ -830,6 +868,7 @@ extern void     ms_gswap8a ( void *data8 );
 /* Platform portable functions */
 extern off_t lmp_ftello (FILE *stream);
 extern int lmp_fseeko (FILE *stream, off_t offset, int whence);
+extern int lmp_simdlevel (void);
 
 #ifdef __cplusplus
 }
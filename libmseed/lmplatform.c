@@ -3,7 +3,7 @@
  *
  * Platform portability routines.
  *
- * modified: 2010.304
+ * modified: 2026.289
  ***************************************************************************/
 
 /* Define _LARGEFILE_SOURCE to get ftello/fseeko on some systems (Linux) */
@@ -46,3 +46,48 @@ lmp_fseeko (FILE *stream, off_t offset, int whence)
 
 #endif
 } /* End of lmp_fseeko() */
+
+#if defined(LMP_X86SIMD)
+/* SIMD level supported by the CPU, set before main() is called */
+static int simdlevel = LMP_SIMD_NONE;
+
+/***************************************************************************
+ * lmp_simdinit:
+ *
+ * Query the CPU for supported SIMD instruction sets.  Run as a
+ * constructor so the level is set before any threads are started.
+ ***************************************************************************/
+static void __attribute__ ((constructor))
+lmp_simdinit (void)
+{
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2"))
+    simdlevel = LMP_SIMD_AVX2;
+  else if (__builtin_cpu_supports ("sse2"))
+    simdlevel = LMP_SIMD_SSE2;
+  else
+    simdlevel = LMP_SIMD_NONE;
+} /* End of lmp_simdinit() */
+#endif
+
+/***************************************************************************
+ * lmp_simdlevel:
+ *
+ * Determine the highest SIMD instruction set level supported by both
+ * the CPU and the compiled code paths.  The CPU is queried once when
+ * the library is loaded.
+ *
+ * Returns one of the LMP_SIMD_* levels.
+ ***************************************************************************/
+int
+lmp_simdlevel (void)
+{
+#if defined(LMP_X86SIMD)
+  return simdlevel;
+
+#else
+  return LMP_SIMD_NONE;
+
+#endif
+} /* End of lmp_simdlevel() */
@@ -7,7 +7,7 @@
  *   ORFEUS/EC-Project MEREDIAN
  *   IRIS Data Management Center
  *
- * modified: 2016.286
+ * modified: 2026.289
  ***************************************************************************/
 
 #include <stdio.h>
@@ -17,13 +17,16 @@
 
 #include "libmseed.h"
 
+static void *msr_blktalloc (MSRecord *msr, size_t size);
+
 /***************************************************************************
  * msr_init:
  *
  * Initialize and return an MSRecord struct, allocating memory if
  * needed.  If memory for the fsdh and datasamples fields has been
  * allocated the pointers will be retained for reuse.  If a blockette
- * chain is present all associated memory will be released.
+ * chain is present all associated memory will be released, an arena
+ * for the blockette chain is reset and retained for reuse.
  *
  * Returns a pointer to a MSRecord struct on success or NULL on error.
  ***************************************************************************/
@@ -32,6 +35,7 @@ msr_init (MSRecord *msr)
 {
   void *fsdh        = 0;
   void *datasamples = 0;
+  MSArena *arena    = 0;
 
   if (!msr)
   {
@@ -41,12 +45,12 @@ msr_init (MSRecord *msr)
   {
     fsdh        = msr->fsdh;
     datasamples = msr->datasamples;
+    arena       = msr->arena;
 
-    if (msr->blkts)
-      msr_free_blktchain (msr);
+    msr_free_blktchain (msr);
 
     if (msr->ststate)
-      free (msr->ststate);
+      msr_free_ststate (&msr->ststate);
   }
 
   if (msr == NULL)
@@ -59,6 +63,7 @@ msr_init (MSRecord *msr)
 
   msr->fsdh        = fsdh;
   msr->datasamples = datasamples;
+  msr->arena       = arena;
 
   msr->reclen    = -1;
   msr->samplecnt = -1;
@@ -86,13 +91,17 @@ msr_free (MSRecord **ppmsr)
     if ((*ppmsr)->blkts)
       msr_free_blktchain (*ppmsr);
 
+    /* Free blockette arena if present */
+    if ((*ppmsr)->arena)
+      ms_arena_free (&(*ppmsr)->arena);
+
     /* Free datasamples if present */
     if ((*ppmsr)->datasamples)
       free ((*ppmsr)->datasamples);
 
     /* Free stream processing state if present */
     if ((*ppmsr)->ststate)
-      free ((*ppmsr)->ststate);
+      msr_free_ststate (&(*ppmsr)->ststate);
 
     free (*ppmsr);
 
@@ -105,7 +114,8 @@ msr_free (MSRecord **ppmsr)
  *
  * Free all memory associated with a blockette chain in a MSRecord
  * struct and set MSRecord->blkts to NULL.  Also reset the shortcut
- * blockette pointers.
+ * blockette pointers.  Blockettes allocated from the arena of the
+ * MSRecord are released by resetting the arena.
  ***************************************************************************/
 void
 msr_free_blktchain (MSRecord *msr)
@@ -121,10 +131,11 @@ msr_free_blktchain (MSRecord *msr)
       {
         nb = bc->next;
 
-        if (bc->blktdata)
+        if (bc->blktdata && !ms_arena_contains (msr->arena, bc->blktdata))
           free (bc->blktdata);
 
-        free (bc);
+        if (!ms_arena_contains (msr->arena, bc))
+          free (bc);
 
         bc = nb;
       }
@@ -132,6 +143,9 @@ msr_free_blktchain (MSRecord *msr)
       msr->blkts = 0;
     }
 
+    if (msr->arena)
+      ms_arena_reset (msr->arena);
+
     msr->Blkt100  = 0;
     msr->Blkt1000 = 0;
     msr->Blkt1001 = 0;
@@ -149,6 +163,8 @@ msr_free_blktchain (MSRecord *msr)
  * end of the chain (last blockette), other wise it will be added to
  * the beginning of the chain (first blockette).
  *
+ * If the MSRecord has an arena the blockette is allocated from it.
+ *
  * Returns a pointer to the BlktLink added to the chain on success and
  * NULL on error.
  ***************************************************************************/
@@ -167,7 +183,7 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
   {
     if (chainpos != 0)
     {
-      blkt = (BlktLink *)malloc (sizeof (BlktLink));
+      blkt = (BlktLink *)msr_blktalloc (msr, sizeof (BlktLink));
 
       blkt->next = msr->blkts;
       msr->blkts = blkt;
@@ -180,7 +196,7 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
         blkt = blkt->next;
       }
 
-      blkt->next = (BlktLink *)malloc (sizeof (BlktLink));
+      blkt->next = (BlktLink *)msr_blktalloc (msr, sizeof (BlktLink));
 
       blkt       = blkt->next;
       blkt->next = 0;
@@ -194,7 +210,7 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
   }
   else
   {
-    msr->blkts = (BlktLink *)malloc (sizeof (BlktLink));
+    msr->blkts = (BlktLink *)msr_blktalloc (msr, sizeof (BlktLink));
 
     if (msr->blkts == NULL)
     {
@@ -210,7 +226,7 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
   blkt->blkt_type  = blkttype;
   blkt->next_blkt  = 0;
 
-  blkt->blktdata = (char *)malloc (length);
+  blkt->blktdata = (char *)msr_blktalloc (msr, length);
 
   if (blkt->blktdata == NULL)
   {
@@ -238,6 +254,23 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
   return blkt;
 } /* End of msr_addblockette() */
 
+/***************************************************************************
+ * msr_blktalloc:
+ *
+ * Allocate memory for a blockette of an MSRecord, from the arena of
+ * the MSRecord if present otherwise from the heap.
+ *
+ * Returns a pointer to the memory on success or NULL on error.
+ ***************************************************************************/
+static void *
+msr_blktalloc (MSRecord *msr, size_t size)
+{
+  if (msr->arena)
+    return ms_arena_alloc (msr->arena, size);
+
+  return malloc (size);
+} /* End of msr_blktalloc() */
+
 /***************************************************************************
  * msr_normalize_header:
  *
@@ -388,6 +421,9 @@ msr_duplicate (MSRecord *msr, flag datadup)
   /* Copy MSRecord structure */
   memcpy (dupmsr, msr, sizeof (MSRecord));
 
+  /* Blockettes of the duplicate are allocated from the heap */
+  dupmsr->arena = 0;
+
   /* Copy fixed-section data header structure */
   if (msr->fsdh)
   {
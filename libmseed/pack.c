@@ -7,7 +7,7 @@
  * Written by Chad Trabant,
  *   IRIS Data Management Center
  *
- * modified: 2015.273
+ * modified: 2026.289
  ***************************************************************************/
 
 #include <stdio.h>
@@ -18,7 +18,44 @@
 #include "libmseed.h"
 #include "packdata.h"
 
+/* Packing state cached in a StreamState by msr_pack().  The record
+ * buffer and packed header are reused by subsequent calls while the
+ * header values, represented by a key, are unchanged. */
+typedef struct PackContext_s
+{
+  char *rawrec;        /* Record buffer */
+  int rawreclen;       /* Allocated length of record buffer */
+  char *header;        /* Packed header including padding to data */
+  int dataoffset;      /* Length of packed header, offset to data */
+  int blkt1001offset;  /* Offset of Blockette 1001 in header or -1 */
+  char srcname[50];    /* Source name of records */
+  char *key;           /* Header values used to pack header */
+  int keylen;          /* Length of key, 0 when header is not valid */
+  char *newkey;        /* Key for current values */
+  int keysize;         /* Allocated size of key and newkey */
+} PackContext;
+
+/* Header values that are not in the fixed section or blockettes */
+struct packkey_s
+{
+  char network[11];
+  char station[11];
+  char location[11];
+  char channel[11];
+  char dataquality;
+  char sampletype;
+  int8_t encoding;
+  int8_t byteorder;
+  int32_t reclen;
+  double samprate;
+  flag headerswapflag;
+  flag dataswapflag;
+  flag packdatabyteorder;
+};
+
 /* Function(s) internal to this file */
+static int msr_pack_key (MSRecord *msr, flag headerswapflag, flag dataswapflag,
+                         PackContext *ctx);
 static int msr_pack_header_raw (MSRecord *msr, char *rawrec, int maxheaderlen,
                                 flag swapflag, flag normalize,
                                 struct blkt_1001_s **blkt1001,
@@ -71,13 +108,14 @@ int
 msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
           void *handlerdata, int64_t *packedsamples, flag flush, flag verbose)
 {
+  PackContext *ctx;
   uint16_t *HPnumsamples;
   uint16_t *HPdataoffset;
   struct blkt_1001_s *HPblkt1001 = NULL;
 
   char *rawrec;
   char *envvariable;
-  char srcname[50];
+  char *srcname;
 
   flag headerswapflag = 0;
   flag dataswapflag   = 0;
@@ -87,6 +125,7 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
   int dataoffset;
   int maxdatabytes;
   int maxsamples;
+  int keylen;
   int recordcnt = 0;
   int packsamples, packoffset;
   int64_t totalpackedsamples;
@@ -113,13 +152,20 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
     memset (msr->ststate, 0, sizeof (StreamState));
   }
 
-  /* Generate source name for MSRecord */
-  if (msr_srcname (msr, srcname, 1) == NULL)
+  /* Allocate packing context if needed */
+  if (!msr->ststate->packctx)
   {
-    ms_log (2, "msr_unpack_data(): Cannot generate srcname\n");
-    return MS_GENERROR;
+    msr->ststate->packctx = (PackContext *)calloc (1, sizeof (PackContext));
+    if (!msr->ststate->packctx)
+    {
+      ms_log (2, "msr_pack(): Could not allocate memory for packing context\n");
+      return -1;
+    }
   }
 
+  ctx     = msr->ststate->packctx;
+  srcname = ctx->srcname;
+
   /* Track original segment start time for new start time calculation */
   segstarttime = msr->starttime;
 
@@ -179,6 +225,10 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
     }
   }
 
+  /* Check for encode debugging environment variable */
+  if (getenv ("ENCODE_DEBUG"))
+    encodedebug = 1;
+
   /* Set default indicator, record length, byte order and encoding if needed */
   if (msr->dataquality == 0)
     msr->dataquality = 'D';
@@ -193,6 +243,40 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
   if (msr->sequence_number <= 0 || msr->sequence_number > 999999)
     msr->sequence_number = 1;
 
+  /* Check to see if byte swapping is needed */
+  if (msr->byteorder != ms_bigendianhost ())
+    headerswapflag = dataswapflag = 1;
+
+  /* Check if byte order is forced */
+  if (packheaderbyteorder >= 0)
+  {
+    headerswapflag = (msr->byteorder != packheaderbyteorder) ? 1 : 0;
+  }
+
+  if (packdatabyteorder >= 0)
+  {
+    dataswapflag = (msr->byteorder != packdatabyteorder) ? 1 : 0;
+  }
+
+  /* Determine if the cached header is valid for the current header values */
+  if ((keylen = msr_pack_key (msr, headerswapflag, dataswapflag, ctx)) < 0)
+  {
+    ms_log (2, "msr_pack(): Cannot allocate memory\n");
+    return -1;
+  }
+
+  if (keylen != ctx->keylen || memcmp (ctx->newkey, ctx->key, keylen))
+  {
+    ctx->keylen = 0;
+
+    /* Generate source name for MSRecord */
+    if (msr_srcname (msr, srcname, 1) == NULL)
+    {
+      ms_log (2, "msr_unpack_data(): Cannot generate srcname\n");
+      return MS_GENERROR;
+    }
+  }
+
   if (msr->reclen < MINRECLEN || msr->reclen > MAXRECLEN)
   {
     ms_log (2, "msr_pack(%s): Record length is out of range: %d\n",
@@ -225,33 +309,26 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
   }
 
   /* Allocate space for data record */
-  rawrec = (char *)malloc (msr->reclen);
-
-  if (rawrec == NULL)
+  if (ctx->rawreclen < msr->reclen)
   {
-    ms_log (2, "msr_pack(%s): Cannot allocate memory\n", srcname);
-    return -1;
+    free (ctx->rawrec);
+    ctx->rawreclen = 0;
+
+    if ((ctx->rawrec = (char *)malloc (msr->reclen)) == NULL)
+    {
+      ms_log (2, "msr_pack(%s): Cannot allocate memory\n", srcname);
+      return -1;
+    }
+
+    ctx->rawreclen = msr->reclen;
   }
 
+  rawrec = ctx->rawrec;
+
   /* Set header pointers to known offsets into FSDH */
   HPnumsamples = (uint16_t *)(rawrec + 30);
   HPdataoffset = (uint16_t *)(rawrec + 44);
 
-  /* Check to see if byte swapping is needed */
-  if (msr->byteorder != ms_bigendianhost ())
-    headerswapflag = dataswapflag = 1;
-
-  /* Check if byte order is forced */
-  if (packheaderbyteorder >= 0)
-  {
-    headerswapflag = (msr->byteorder != packheaderbyteorder) ? 1 : 0;
-  }
-
-  if (packdatabyteorder >= 0)
-  {
-    dataswapflag = (msr->byteorder != packdatabyteorder) ? 1 : 0;
-  }
-
   if (verbose > 2)
   {
     if (headerswapflag && dataswapflag)
@@ -264,52 +341,84 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
       ms_log (1, "%s: Byte swapping NOT needed for packing\n", srcname);
   }
 
-  /* Add a blank 1000 Blockette if one is not present, the blockette values
-     will be populated in msr_pack_header_raw()/msr_normalize_header() */
-  if (!msr->Blkt1000)
+  /* Reuse the cached header, updating the values that change between records */
+  if (ctx->keylen)
   {
-    struct blkt_1000_s blkt1000;
-    memset (&blkt1000, 0, sizeof (struct blkt_1000_s));
-
     if (verbose > 2)
-      ms_log (1, "%s: Adding 1000 Blockette\n", srcname);
+      ms_log (1, "%s: Reusing packed header\n", srcname);
 
-    if (!msr_addblockette (msr, (char *)&blkt1000, sizeof (struct blkt_1000_s), 1000, 0))
+    dataoffset = ctx->dataoffset;
+    memcpy (rawrec, ctx->header, dataoffset);
+
+    if (ctx->blkt1001offset >= 0)
+      HPblkt1001 = (struct blkt_1001_s *)(rawrec + ctx->blkt1001offset);
+
+    msr_update_header (msr, rawrec, headerswapflag, HPblkt1001, srcname, verbose);
+  }
+  else
+  {
+    /* Add a blank 1000 Blockette if one is not present, the blockette values
+       will be populated in msr_pack_header_raw()/msr_normalize_header() */
+    if (!msr->Blkt1000)
     {
-      ms_log (2, "msr_pack(%s): Error adding 1000 Blockette\n", srcname);
-      free (rawrec);
+      struct blkt_1000_s blkt1000;
+      memset (&blkt1000, 0, sizeof (struct blkt_1000_s));
+
+      if (verbose > 2)
+        ms_log (1, "%s: Adding 1000 Blockette\n", srcname);
+
+      if (!msr_addblockette (msr, (char *)&blkt1000, sizeof (struct blkt_1000_s), 1000, 0))
+      {
+        ms_log (2, "msr_pack(%s): Error adding 1000 Blockette\n", srcname);
+        return -1;
+      }
+    }
+
+    headerlen = msr_pack_header_raw (msr, rawrec, msr->reclen, headerswapflag, 1,
+                                     &HPblkt1001, srcname, verbose);
+
+    if (headerlen == -1)
+    {
+      ms_log (2, "msr_pack(%s): Error packing header\n", srcname);
       return -1;
     }
-  }
 
-  headerlen = msr_pack_header_raw (msr, rawrec, msr->reclen, headerswapflag, 1,
-                                   &HPblkt1001, srcname, verbose);
+    /* Determine offset to encoded data */
+    if (msr->encoding == DE_STEIM1 || msr->encoding == DE_STEIM2)
+    {
+      dataoffset = 64;
+      while (dataoffset < headerlen)
+        dataoffset += 64;
 
-  if (headerlen == -1)
-  {
-    ms_log (2, "msr_pack(%s): Error packing header\n", srcname);
-    free (rawrec);
-    return -1;
-  }
+      /* Zero memory between blockettes and data if any */
+      memset (rawrec + headerlen, 0, dataoffset - headerlen);
+    }
+    else
+    {
+      dataoffset = headerlen;
+    }
 
-  /* Determine offset to encoded data */
-  if (msr->encoding == DE_STEIM1 || msr->encoding == DE_STEIM2)
-  {
-    dataoffset = 64;
-    while (dataoffset < headerlen)
-      dataoffset += 64;
+    *HPdataoffset = (uint16_t)dataoffset;
+    if (headerswapflag)
+      ms_gswap2 (HPdataoffset);
 
-    /* Zero memory between blockettes and data if any */
-    memset (rawrec + headerlen, 0, dataoffset - headerlen);
-  }
-  else
-  {
-    dataoffset = headerlen;
-  }
+    /* Cache the packed header with the key of the normalized header values */
+    free (ctx->header);
 
-  *HPdataoffset = (uint16_t)dataoffset;
-  if (headerswapflag)
-    ms_gswap2 (HPdataoffset);
+    if ((ctx->header = (char *)malloc (dataoffset)) == NULL ||
+        (keylen = msr_pack_key (msr, headerswapflag, dataswapflag, ctx)) < 0)
+    {
+      ms_log (2, "msr_pack(%s): Cannot allocate memory\n", srcname);
+      return -1;
+    }
+
+    memcpy (ctx->header, rawrec, dataoffset);
+    ctx->dataoffset     = dataoffset;
+    ctx->blkt1001offset = (HPblkt1001) ? (int)((char *)HPblkt1001 - rawrec) : -1;
+
+    memcpy (ctx->key, ctx->newkey, keylen);
+    ctx->keylen = keylen;
+  }
 
   /* Determine the max data bytes and sample count */
   maxdatabytes = msr->reclen - dataoffset;
@@ -346,7 +455,6 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
     if (packsamples < 0)
     {
       ms_log (2, "msr_pack(%s): Error packing data samples\n", srcname);
-      free (rawrec);
       return -1;
     }
 
@@ -389,8 +497,6 @@ msr_pack (MSRecord *msr, void (*record_handler) (char *, int, void *),
   if (verbose > 2)
     ms_log (1, "%s: Packed %d total samples\n", srcname, totalpackedsamples);
 
-  free (rawrec);
-
   return recordcnt;
 } /* End of msr_pack() */
 
@@ -910,10 +1016,6 @@ msr_pack_data (void *dest, void *src, int maxsamples, int maxdatabytes,
   int32_t *intbuff;
   int32_t d0;
 
-  /* Check for encode debugging environment variable */
-  if (getenv ("ENCODE_DEBUG"))
-    encodedebug = 1;
-
   /* Decide if this is a format that we can encode */
   switch (encoding)
   {
@@ -1048,3 +1150,123 @@ msr_pack_data (void *dest, void *src, int maxsamples, int maxdatabytes,
 
   return nsamples;
 } /* End of msr_pack_data() */
+
+/***************************************************************************
+ * msr_pack_key:
+ *
+ * Generate a key of the MSRecord values used to pack a record header
+ * in the newkey buffer of the packing context, growing the key buffers
+ * as needed.  The key includes the fixed section of data header and
+ * blockette chain, excluding the values updated for each record by
+ * msr_update_header().
+ *
+ * Returns the length of the key on success or -1 on error.
+ ***************************************************************************/
+static int
+msr_pack_key (MSRecord *msr, flag headerswapflag, flag dataswapflag,
+              PackContext *ctx)
+{
+  struct packkey_s packkey;
+  struct fsdh_s fsdh;
+  struct blkt_link_s *cur_blkt;
+  struct blkt_1001_s *blkt_1001;
+  char *newkey;
+  int keylen;
+  int offset;
+
+  /* Determine key length */
+  keylen = sizeof (struct packkey_s) + sizeof (struct fsdh_s);
+  for (cur_blkt = msr->blkts; cur_blkt; cur_blkt = cur_blkt->next)
+    keylen += sizeof (uint16_t) * 2 + cur_blkt->blktdatalen;
+
+  if (keylen > ctx->keysize)
+  {
+    if ((newkey = (char *)realloc (ctx->key, keylen)) == NULL)
+      return -1;
+    ctx->key = newkey;
+
+    if ((newkey = (char *)realloc (ctx->newkey, keylen)) == NULL)
+      return -1;
+    ctx->newkey  = newkey;
+    ctx->keysize = keylen;
+  }
+
+  /* Values used to normalize the header, padding is cleared */
+  memset (&packkey, 0, sizeof (struct packkey_s));
+  memcpy (packkey.network, msr->network, strnlen (msr->network, sizeof (packkey.network) - 1));
+  memcpy (packkey.station, msr->station, strnlen (msr->station, sizeof (packkey.station) - 1));
+  memcpy (packkey.location, msr->location, strnlen (msr->location, sizeof (packkey.location) - 1));
+  memcpy (packkey.channel, msr->channel, strnlen (msr->channel, sizeof (packkey.channel) - 1));
+  packkey.dataquality       = msr->dataquality;
+  packkey.sampletype        = msr->sampletype;
+  packkey.encoding          = msr->encoding;
+  packkey.byteorder         = msr->byteorder;
+  packkey.reclen            = msr->reclen;
+  packkey.samprate          = msr->samprate;
+  packkey.headerswapflag    = headerswapflag;
+  packkey.dataswapflag      = dataswapflag;
+  packkey.packdatabyteorder = packdatabyteorder;
+
+  memcpy (ctx->newkey, &packkey, sizeof (struct packkey_s));
+  offset = sizeof (struct packkey_s);
+
+  /* Fixed section of data header without sequence number and start time */
+  memset (&fsdh, 0, sizeof (struct fsdh_s));
+  if (msr->fsdh)
+  {
+    memcpy (&fsdh, msr->fsdh, sizeof (struct fsdh_s));
+    memset (fsdh.sequence_number, 0, sizeof (fsdh.sequence_number));
+    memset (&fsdh.start_time, 0, sizeof (fsdh.start_time));
+  }
+
+  memcpy (ctx->newkey + offset, &fsdh, sizeof (struct fsdh_s));
+  offset += sizeof (struct fsdh_s);
+
+  /* Blockette chain without the Blockette 1001 microsecond offset */
+  for (cur_blkt = msr->blkts; cur_blkt; cur_blkt = cur_blkt->next)
+  {
+    memcpy (ctx->newkey + offset, &cur_blkt->blkt_type, sizeof (uint16_t));
+    memcpy (ctx->newkey + offset + 2, &cur_blkt->blktdatalen, sizeof (uint16_t));
+    offset += sizeof (uint16_t) * 2;
+
+    memcpy (ctx->newkey + offset, cur_blkt->blktdata, cur_blkt->blktdatalen);
+
+    if (cur_blkt->blkt_type == 1001 && cur_blkt->blktdatalen >= sizeof (struct blkt_1001_s))
+    {
+      blkt_1001       = (struct blkt_1001_s *)(ctx->newkey + offset);
+      blkt_1001->usec = 0;
+    }
+
+    offset += cur_blkt->blktdatalen;
+  }
+
+  return keylen;
+} /* End of msr_pack_key() */
+
+/***************************************************************************
+ * msr_free_ststate:
+ *
+ * Free all memory associated with a StreamState struct, including any
+ * packing context, and set the pointer to 0.
+ ***************************************************************************/
+void
+msr_free_ststate (StreamState **ppststate)
+{
+  PackContext *ctx;
+
+  if (ppststate && *ppststate)
+  {
+    if ((ctx = (*ppststate)->packctx))
+    {
+      free (ctx->rawrec);
+      free (ctx->header);
+      free (ctx->key);
+      free (ctx->newkey);
+      free (ctx);
+    }
+
+    free (*ppststate);
+
+    *ppststate = 0;
+  }
+} /* End of msr_free_ststate() */
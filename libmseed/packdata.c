@@ -2,7 +2,7 @@
  * Routines for packing text/ASCII, INT_16, INT_32, FLOAT_32, FLOAT_64,
  * STEIM1 and STEIM2 data records.
  *
- * modified: 2017.053
+ * modified: 2026.289
  ************************************************************************/
 
 #include <memory.h>
@@ -12,9 +12,46 @@
 #include "libmseed.h"
 #include "packdata.h"
 
+#if defined(LMP_X86SIMD)
+#include <immintrin.h>
+#endif
+
 /* Control for printing debugging information */
 int encodedebug = 0;
 
+/* Control for SIMD Steim encoding, highest LMP_SIMD_* level to use or
+ * -1 to use the highest level supported by the CPU */
+int encodesimd = -1;
+
+/* Number of differences buffered by the SIMD Steim encoders */
+#define STEIM_DIFFBUFFER 256
+
+/* Function to compute differences and classify them by bit width */
+typedef void (*steim_diff_fn) (const int32_t *input, int count,
+                               const int32_t *limits, int nlimits,
+                               int32_t *diffs, int32_t *classes);
+
+static steim_diff_fn steim_diff_select (void);
+static int msr_encode_steim1_simd (int32_t *input, int samplecount, int32_t *output,
+                                   int outputlength, int32_t diff0, int swapflag,
+                                   steim_diff_fn diff_fn);
+static int msr_encode_steim2_simd (int32_t *input, int samplecount, int32_t *output,
+                                   int outputlength, int32_t diff0, char *srcname,
+                                   int swapflag, steim_diff_fn diff_fn);
+
+/* Limits for Steim1 differences, classifying each difference by the
+ * maximum number of differences that can be packed in a word together
+ * with it: 0 for 1x32, 1 for 2x16 and 2 for 4x8 bits. */
+static const int32_t steim1limits[2] = {
+    32768, 128};
+
+/* Limits for Steim2 differences, classifying each difference by the
+ * maximum number of differences that can be packed in a word together
+ * with it: 1x30, 2x15, 3x10, 4x8, 5x6, 6x5 and 7x4 bits.  A value fits
+ * in B bits when (value ^ (value >> 31)) < 2^(B-1). */
+static const int32_t steim2limits[7] = {
+    536870912, 16384, 512, 128, 32, 16, 8};
+
 /************************************************************************
  * msr_encode_text:
  *
@@ -218,6 +255,147 @@ msr_encode_float64 (double *input, int samplecount, double *output,
   else                                                \
     RESULT = 32;
 
+/************************************************************************
+ * steim_class:
+ *
+ * Classify a difference as the number of limits that the magnitude of
+ * the difference is below.
+ *
+ * Return the class of the difference.
+ ************************************************************************/
+static inline int32_t
+steim_class (int32_t diff, const int32_t *limits, int nlimits)
+{
+  int32_t magnitude = diff ^ (diff >> 31);
+  int32_t class     = 0;
+  int idx;
+
+  for (idx = 0; idx < nlimits; idx++)
+    class += (magnitude < limits[idx]);
+
+  return class;
+} /* End of steim_class() */
+
+#if defined(LMP_X86SIMD)
+/************************************************************************
+ * steim_diff_sse2:
+ *
+ * Compute count differences between successive input samples and
+ * classify each by the specified limits, see steim_class(), using SSE2
+ * instructions.  The input array must contain count + 1 samples and at
+ * most 7 limits are supported.
+ ************************************************************************/
+__attribute__ ((target ("sse2"))) static void
+steim_diff_sse2 (const int32_t *input, int count,
+                 const int32_t *limits, int nlimits,
+                 int32_t *diffs, int32_t *classes)
+{
+  __m128i limit[7];
+  __m128i diff;
+  __m128i magnitude;
+  __m128i class;
+  int idx;
+  int lidx;
+
+  /* Broadcast limits once, the output arrays could alias the limits */
+  for (lidx = 0; lidx < nlimits && lidx < 7; lidx++)
+    limit[lidx] = _mm_set1_epi32 (limits[lidx]);
+
+  for (idx = 0; idx + 4 <= count; idx += 4)
+  {
+    diff      = _mm_sub_epi32 (_mm_loadu_si128 ((const __m128i *)(input + idx + 1)),
+                               _mm_loadu_si128 ((const __m128i *)(input + idx)));
+    magnitude = _mm_xor_si128 (diff, _mm_srai_epi32 (diff, 31));
+    class     = _mm_setzero_si128 ();
+
+    /* Comparison results are -1 for true, subtract to count */
+    for (lidx = 0; lidx < nlimits && lidx < 7; lidx++)
+      class = _mm_sub_epi32 (class, _mm_cmpgt_epi32 (limit[lidx], magnitude));
+
+    _mm_storeu_si128 ((__m128i *)(diffs + idx), diff);
+    _mm_storeu_si128 ((__m128i *)(classes + idx), class);
+  }
+
+  for (; idx < count; idx++)
+  {
+    diffs[idx]   = (int32_t)((uint32_t)input[idx + 1] - (uint32_t)input[idx]);
+    classes[idx] = steim_class (diffs[idx], limits, nlimits);
+  }
+} /* End of steim_diff_sse2() */
+
+/************************************************************************
+ * steim_diff_avx2:
+ *
+ * Compute count differences between successive input samples and
+ * classify each by the specified limits, see steim_class(), using AVX2
+ * instructions.  The input array must contain count + 1 samples and at
+ * most 7 limits are supported.
+ ************************************************************************/
+__attribute__ ((target ("avx2"))) static void
+steim_diff_avx2 (const int32_t *input, int count,
+                 const int32_t *limits, int nlimits,
+                 int32_t *diffs, int32_t *classes)
+{
+  __m256i limit[7];
+  __m256i diff;
+  __m256i magnitude;
+  __m256i class;
+  int idx;
+  int lidx;
+
+  /* Broadcast limits once, the output arrays could alias the limits */
+  for (lidx = 0; lidx < nlimits && lidx < 7; lidx++)
+    limit[lidx] = _mm256_set1_epi32 (limits[lidx]);
+
+  for (idx = 0; idx + 8 <= count; idx += 8)
+  {
+    diff      = _mm256_sub_epi32 (_mm256_loadu_si256 ((const __m256i *)(input + idx + 1)),
+                                  _mm256_loadu_si256 ((const __m256i *)(input + idx)));
+    magnitude = _mm256_xor_si256 (diff, _mm256_srai_epi32 (diff, 31));
+    class     = _mm256_setzero_si256 ();
+
+    /* Comparison results are -1 for true, subtract to count */
+    for (lidx = 0; lidx < nlimits && lidx < 7; lidx++)
+      class = _mm256_sub_epi32 (class, _mm256_cmpgt_epi32 (limit[lidx], magnitude));
+
+    _mm256_storeu_si256 ((__m256i *)(diffs + idx), diff);
+    _mm256_storeu_si256 ((__m256i *)(classes + idx), class);
+  }
+
+  for (; idx < count; idx++)
+  {
+    diffs[idx]   = (int32_t)((uint32_t)input[idx + 1] - (uint32_t)input[idx]);
+    classes[idx] = steim_class (diffs[idx], limits, nlimits);
+  }
+} /* End of steim_diff_avx2() */
+#endif /* LMP_X86SIMD */
+
+/************************************************************************
+ * steim_diff_select:
+ *
+ * Select the difference function for the SIMD Steim encoders based on
+ * the SIMD level supported by the CPU, limited by encodesimd.
+ *
+ * Return the function or NULL if no SIMD level is available.
+ ************************************************************************/
+static steim_diff_fn
+steim_diff_select (void)
+{
+  int level = lmp_simdlevel ();
+
+  if (encodesimd >= 0 && encodesimd < level)
+    level = encodesimd;
+
+#if defined(LMP_X86SIMD)
+  if (level >= LMP_SIMD_AVX2)
+    return steim_diff_avx2;
+  if (level >= LMP_SIMD_SSE2)
+    return steim_diff_sse2;
+#endif
+
+  return NULL;
+} /* End of steim_diff_select() */
+
 /************************************************************************
  * msr_encode_steim1:
  *
@@ -235,6 +413,7 @@ int
 msr_encode_steim1 (int32_t *input, int samplecount, int32_t *output,
                    int outputlength, int32_t diff0, int swapflag)
 {
+  steim_diff_fn diff_fn;
   int32_t *frameptr;   /* Frame pointer in output */
   int32_t *Xnp = NULL; /* Reverse integration constant, aka last sample */
   int32_t diffs[4];
@@ -261,6 +440,11 @@ msr_encode_steim1 (int32_t *input, int samplecount, int32_t *output,
   if (!input || !output || outputlength <= 0)
     return -1;
 
+  /* Use SIMD encoder if available, the scalar encoder prints debugging details */
+  if (!encodedebug && (diff_fn = steim_diff_select ()))
+    return msr_encode_steim1_simd (input, samplecount, output, outputlength,
+                                   diff0, swapflag, diff_fn);
+
   if (encodedebug)
     ms_log (1, "Encoding Steim1 frames, samples: %d, max frames: %d, swapflag: %d\n",
             samplecount, maxframes, swapflag);
@@ -426,6 +610,7 @@ msr_encode_steim2 (int32_t *input, int samplecount, int32_t *output,
                    int outputlength, int32_t diff0,
                    char *srcname, int swapflag)
 {
+  steim_diff_fn diff_fn;
   uint32_t *frameptr;  /* Frame pointer in output */
   int32_t *Xnp = NULL; /* Reverse integration constant, aka last sample */
   int32_t diffs[7];
@@ -452,6 +637,11 @@ msr_encode_steim2 (int32_t *input, int samplecount, int32_t *output,
   if (!input || !output || outputlength <= 0)
     return -1;
 
+  /* Use SIMD encoder if available, the scalar encoder prints debugging details */
+  if (!encodedebug && (diff_fn = steim_diff_select ()))
+    return msr_encode_steim2_simd (input, samplecount, output, outputlength,
+                                   diff0, srcname, swapflag, diff_fn);
+
   if (encodedebug)
     ms_log (1, "Encoding Steim2 frames, samples: %d, max frames: %d, swapflag: %d\n",
             samplecount, maxframes, swapflag);
@@ -710,3 +900,388 @@ msr_encode_steim2 (int32_t *input, int samplecount, int32_t *output,
 
   return outputsamples;
 } /* End of msr_encode_steim2() */
+
+/************************************************************************
+ * msr_encode_steim1_simd:
+ *
+ * Encode Steim1 data frames as msr_encode_steim1() does, producing
+ * identical output.  Differences and their bit width classes are
+ * computed in bulk by diff_fn and the packing for each word is
+ * selected from the classes.
+ *
+ * Return number of samples in output buffer on success, -1 on failure.
+ ************************************************************************/
+static int
+msr_encode_steim1_simd (int32_t *input, int samplecount, int32_t *output,
+                        int outputlength, int32_t diff0, int swapflag,
+                        steim_diff_fn diff_fn)
+{
+  uint32_t *frameptr;  /* Frame pointer in output */
+  int32_t *Xnp = NULL; /* Reverse integration constant, aka last sample */
+  int32_t diffs[STEIM_DIFFBUFFER];
+  int32_t classes[STEIM_DIFFBUFFER];
+  int32_t *diff;
+  int32_t *class;
+  int diffstart     = 0; /* Index of next difference to pack */
+  int diffend       = 0; /* Index after last difference in buffer */
+  int inputidx      = 0; /* Index of sample for next difference to compute */
+  int outputsamples = 0;
+  int maxframes     = outputlength / 64;
+  int count;
+  int frameidx;
+  int startnibble;
+  int widx;
+  int idx;
+
+  union dword {
+    int8_t d8[4];
+    int16_t d16[2];
+    uint32_t d32;
+  } packed;
+  uint32_t nibbles;
+
+  /* Add first difference to buffers */
+  diffs[0]   = diff0;
+  classes[0] = steim_class (diff0, steim1limits, 2);
+  diffend    = 1;
+
+  for (frameidx = 0; frameidx < maxframes && outputsamples < samplecount; frameidx++)
+  {
+    frameptr = (uint32_t *)output + (16 * frameidx);
+
+    /* Set 64-byte frame to 0's */
+    memset (frameptr, 0, 64);
+
+    /* Save forward integration constant (X0), pointer to reverse integration constant (Xn)
+     * and set the starting nibble index depending on frame. */
+    if (frameidx == 0)
+    {
+      frameptr[1] = input[0];
+
+      if (swapflag)
+        ms_gswap4a (&frameptr[1]);
+
+      Xnp = (int32_t *)&frameptr[2];
+
+      startnibble = 3; /* First frame: skip nibbles, X0, and Xn */
+    }
+    else
+    {
+      startnibble = 1; /* Subsequent frames: skip nibbles */
+    }
+
+    nibbles = 0;
+
+    for (widx = startnibble; widx < 16 && outputsamples < samplecount; widx++)
+    {
+      /* Shift remaining differences to the beginning of the buffers and refill */
+      if (diffend - diffstart < 4 && inputidx < (samplecount - 1))
+      {
+        for (idx = 0; idx < diffend - diffstart; idx++)
+        {
+          diffs[idx]   = diffs[diffstart + idx];
+          classes[idx] = classes[diffstart + idx];
+        }
+        diffend -= diffstart;
+        diffstart = 0;
+
+        count = STEIM_DIFFBUFFER - diffend;
+        if (count > (samplecount - 1 - inputidx))
+          count = samplecount - 1 - inputidx;
+
+        diff_fn (input + inputidx, count, steim1limits, 2,
+                 diffs + diffend, classes + diffend);
+
+        diffend += count;
+        inputidx += count;
+      }
+
+      diff  = diffs + diffstart;
+      class = classes + diffstart;
+      count = diffend - diffstart;
+
+      /* 4 x 8-bit differences */
+      if (count >= 4 &&
+          class[0] >= 2 && class[1] >= 2 &&
+          class[2] >= 2 && class[3] >= 2)
+      {
+        packed.d8[0] = diff[0];
+        packed.d8[1] = diff[1];
+        packed.d8[2] = diff[2];
+        packed.d8[3] = diff[3];
+
+        nibbles |= 0x1ul << (30 - 2 * widx);
+
+        count = 4;
+      }
+      /* 2 x 16-bit differences */
+      else if (count >= 2 && class[0] >= 1 && class[1] >= 1)
+      {
+        packed.d16[0] = diff[0];
+        packed.d16[1] = diff[1];
+
+        if (swapflag)
+        {
+          ms_gswap2a (&packed.d16[0]);
+          ms_gswap2a (&packed.d16[1]);
+        }
+
+        nibbles |= 0x2ul << (30 - 2 * widx);
+
+        count = 2;
+      }
+      /* 1 x 32-bit difference */
+      else
+      {
+        packed.d32 = (uint32_t)diff[0];
+
+        if (swapflag)
+          ms_gswap4a (&packed.d32);
+
+        nibbles |= 0x3ul << (30 - 2 * widx);
+
+        count = 1;
+      }
+
+      frameptr[widx] = packed.d32;
+
+      diffstart += count;
+      outputsamples += count;
+    } /* Done with words in frame */
+
+    /* Swap word with nibbles */
+    if (swapflag)
+      ms_gswap4a (&nibbles);
+
+    frameptr[0] = nibbles;
+  } /* Done with frames */
+
+  /* Set Xn (reverse integration constant) in first frame to last sample */
+  if (Xnp)
+    *Xnp = *(input + outputsamples - 1);
+  if (swapflag)
+    ms_gswap4a (Xnp);
+
+  /* Pad any remaining bytes */
+  if ((frameidx * 64) < outputlength)
+    memset (output + (frameidx * 16), 0, outputlength - (frameidx * 64));
+
+  return outputsamples;
+} /* End of msr_encode_steim1_simd() */
+
+/************************************************************************
+ * msr_encode_steim2_simd:
+ *
+ * Encode Steim2 data frames as msr_encode_steim2() does, producing
+ * identical output.  Differences and their bit width classes are
+ * computed in bulk by diff_fn and the packing for each word is
+ * selected from the classes instead of testing each pattern in turn.
+ *
+ * The packing of a word is the largest number of differences N, up to
+ * 7, for which the first N buffered differences all have a class of
+ * at least N.
+ *
+ * Return number of samples in output buffer on success, -1 on failure.
+ ************************************************************************/
+static int
+msr_encode_steim2_simd (int32_t *input, int samplecount, int32_t *output,
+                        int outputlength, int32_t diff0, char *srcname,
+                        int swapflag, steim_diff_fn diff_fn)
+{
+  uint32_t *frameptr;  /* Frame pointer in output */
+  int32_t *Xnp = NULL; /* Reverse integration constant, aka last sample */
+  int32_t diffs[STEIM_DIFFBUFFER];
+  int32_t classes[STEIM_DIFFBUFFER];
+  int32_t *diff;
+  int32_t *class;
+  int32_t minclass;
+  int diffstart     = 0; /* Index of next difference to pack */
+  int diffend       = 0; /* Index after last difference in buffer */
+  int inputidx      = 0; /* Index of sample for next difference to compute */
+  int outputsamples = 0;
+  int maxframes     = outputlength / 64;
+  int packedsamples = 0;
+  int count;
+  int frameidx;
+  int startnibble;
+  int widx;
+  int idx;
+
+  union dword {
+    int8_t d8[4];
+    int16_t d16[2];
+    uint32_t d32;
+  } packed;
+  uint32_t nibbles;
+
+  /* Add first difference to buffers */
+  diffs[0]   = diff0;
+  classes[0] = steim_class (diff0, steim2limits, 7);
+  diffend    = 1;
+
+  for (frameidx = 0; frameidx < maxframes && outputsamples < samplecount; frameidx++)
+  {
+    frameptr = (uint32_t *)output + (16 * frameidx);
+
+    /* Set 64-byte frame to 0's */
+    memset (frameptr, 0, 64);
+
+    /* Save forward integration constant (X0), pointer to reverse integration constant (Xn)
+     * and set the starting nibble index depending on frame. */
+    if (frameidx == 0)
+    {
+      frameptr[1] = input[0];
+
+      if (swapflag)
+        ms_gswap4a (&frameptr[1]);
+
+      Xnp = (int32_t *)&frameptr[2];
+
+      startnibble = 3; /* First frame: skip nibbles, X0, and Xn */
+    }
+    else
+    {
+      startnibble = 1; /* Subsequent frames: skip nibbles */
+    }
+
+    nibbles = 0;
+
+    for (widx = startnibble; widx < 16 && outputsamples < samplecount; widx++)
+    {
+      /* Shift remaining differences to the beginning of the buffers and refill */
+      if (diffend - diffstart < 7 && inputidx < (samplecount - 1))
+      {
+        for (idx = 0; idx < diffend - diffstart; idx++)
+        {
+          diffs[idx]   = diffs[diffstart + idx];
+          classes[idx] = classes[diffstart + idx];
+        }
+        diffend -= diffstart;
+        diffstart = 0;
+
+        count = STEIM_DIFFBUFFER - diffend;
+        if (count > (samplecount - 1 - inputidx))
+          count = samplecount - 1 - inputidx;
+
+        diff_fn (input + inputidx, count, steim2limits, 7,
+                 diffs + diffend, classes + diffend);
+
+        diffend += count;
+        inputidx += count;
+      }
+
+      diff  = diffs + diffstart;
+      class = classes + diffstart;
+
+      /* Determine the largest N where the first N classes are all >= N */
+      count = diffend - diffstart;
+      if (count > 7)
+        count = 7;
+
+      packedsamples = 0;
+      minclass      = 7;
+      for (idx = 0; idx < count; idx++)
+      {
+        if (class[idx] < minclass)
+          minclass = class[idx];
+
+        if (minclass <= idx)
+          break;
+
+        packedsamples = idx + 1;
+      }
+
+      switch (packedsamples)
+      {
+      case 7: /* 7 x 4-bit differences, decode nibble 0b10 */
+        packed.d32 = (((uint32_t)diff[6] & 0xFul) |
+                      ((uint32_t)diff[5] & 0xFul) << 4 |
+                      ((uint32_t)diff[4] & 0xFul) << 8 |
+                      ((uint32_t)diff[3] & 0xFul) << 12 |
+                      ((uint32_t)diff[2] & 0xFul) << 16 |
+                      ((uint32_t)diff[1] & 0xFul) << 20 |
+                      ((uint32_t)diff[0] & 0xFul) << 24 |
+                      0x2ul << 30);
+        nibbles |= 0x3ul << (30 - 2 * widx);
+        break;
+      case 6: /* 6 x 5-bit differences, decode nibble 0b01 */
+        packed.d32 = (((uint32_t)diff[5] & 0x1Ful) |
+                      ((uint32_t)diff[4] & 0x1Ful) << 5 |
+                      ((uint32_t)diff[3] & 0x1Ful) << 10 |
+                      ((uint32_t)diff[2] & 0x1Ful) << 15 |
+                      ((uint32_t)diff[1] & 0x1Ful) << 20 |
+                      ((uint32_t)diff[0] & 0x1Ful) << 25 |
+                      0x1ul << 30);
+        nibbles |= 0x3ul << (30 - 2 * widx);
+        break;
+      case 5: /* 5 x 6-bit differences, decode nibble 0b00 */
+        packed.d32 = (((uint32_t)diff[4] & 0x3Ful) |
+                      ((uint32_t)diff[3] & 0x3Ful) << 6 |
+                      ((uint32_t)diff[2] & 0x3Ful) << 12 |
+                      ((uint32_t)diff[1] & 0x3Ful) << 18 |
+                      ((uint32_t)diff[0] & 0x3Ful) << 24);
+        nibbles |= 0x3ul << (30 - 2 * widx);
+        break;
+      case 4: /* 4 x 8-bit differences */
+        packed.d8[0] = diff[0];
+        packed.d8[1] = diff[1];
+        packed.d8[2] = diff[2];
+        packed.d8[3] = diff[3];
+        nibbles |= 0x1ul << (30 - 2 * widx);
+        break;
+      case 3: /* 3 x 10-bit differences, decode nibble 0b11 */
+        packed.d32 = (((uint32_t)diff[2] & 0x3FFul) |
+                      ((uint32_t)diff[1] & 0x3FFul) << 10 |
+                      ((uint32_t)diff[0] & 0x3FFul) << 20 |
+                      0x3ul << 30);
+        nibbles |= 0x2ul << (30 - 2 * widx);
+        break;
+      case 2: /* 2 x 15-bit differences, decode nibble 0b10 */
+        packed.d32 = (((uint32_t)diff[1] & 0x7FFFul) |
+                      ((uint32_t)diff[0] & 0x7FFFul) << 15 |
+                      0x2ul << 30);
+        nibbles |= 0x2ul << (30 - 2 * widx);
+        break;
+      case 1: /* 1 x 30-bit difference, decode nibble 0b01 */
+        packed.d32 = (((uint32_t)diff[0] & 0x3FFFFFFFul) |
+                      0x1ul << 30);
+        nibbles |= 0x2ul << (30 - 2 * widx);
+        break;
+      default:
+        /* Leave the frame as the scalar encoder does on failure */
+        frameptr[0] = nibbles;
+
+        ms_log (2, "msr_encode_steim2(%s): Unable to represent difference in <= 30 bits\n",
+                srcname);
+        return -1;
+      }
+
+      /* Swap encoded word except for 4x8-bit samples */
+      if (swapflag && packedsamples != 4)
+        ms_gswap4a (&packed.d32);
+
+      frameptr[widx] = packed.d32;
+
+      diffstart += packedsamples;
+      outputsamples += packedsamples;
+    } /* Done with words in frame */
+
+    /* Swap word with nibbles */
+    if (swapflag)
+      ms_gswap4a (&nibbles);
+
+    frameptr[0] = nibbles;
+  } /* Done with frames */
+
+  /* Set Xn (reverse integration constant) in first frame to last sample */
+  if (Xnp)
+    *Xnp = *(input + outputsamples - 1);
+  if (swapflag)
+    ms_gswap4a (Xnp);
+
+  /* Pad any remaining bytes */
+  if ((frameidx * 64) < outputlength)
+    memset (output + (frameidx * 16), 0, outputlength - (frameidx * 64));
+
+  return outputsamples;
+} /* End of msr_encode_steim2_simd() */
@@ -4,7 +4,7 @@
  * Interface declarations for the Mini-SEED packing routines in
  * packdata.c
  *
- * modified: 2016.273
+ * modified: 2026.289
  ***************************************************************************/
 
 #ifndef PACKDATA_H
@@ -20,6 +20,10 @@ extern "C" {
 /* Control for printing debugging information, declared in packdata.c */
 extern int encodedebug;
 
+/* Control for SIMD Steim encoding, highest LMP_SIMD_* level to use or
+ * -1 for the highest supported level, declared in packdata.c */
+extern int encodesimd;
+
 extern int msr_encode_text (char *input, int samplecount, char *output,
                             int outputlength);
 extern int msr_encode_int16 (int32_t *input, int samplecount, int16_t *output,
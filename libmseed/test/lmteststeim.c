@@ -0,0 +1,415 @@
+/***************************************************************************
+ * lmteststeim.c
+ *
+ * A program for libmseed Steim encoder and decoder tests.
+ *
+ * The SIMD Steim encoders and decoders are compared to the scalar
+ * reference implementations over randomized and adversarial data sets,
+ * the encoded frames and decoded samples must be identical for every
+ * SIMD level supported by the CPU.  On systems without SIMD support
+ * the reference is compared to itself.
+ *
+ * modified 2026.289
+ ***************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+#include <packdata.h>
+#include <unpackdata.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " example]"
+#define PACKAGE "lmteststeim"
+
+/* Number of samples in each data set */
+#define SAMPLECOUNT 4000
+
+/* Largest output buffer tested */
+#define MAXOUTPUT 8192
+
+static int encoding = DE_STEIM2;
+
+static int parameter_proc (int argcount, char **argvec);
+static int encode (int32_t *input, int samplecount, int32_t *output,
+                   int outputlength, int32_t diff0, int swapflag);
+static int decode (int32_t *input, int inputlength, int samplecount,
+                   int32_t *output, int swapflag);
+static int compare (const char *name, int32_t *input, int samplecount);
+static int comparedecode (int32_t *input, int inputlength, int samplecount,
+                          int swapflag);
+static int compareframes (const char *name, uint32_t *state);
+static uint32_t lcg (uint32_t *state);
+static void print_none (char *message);
+static void usage (void);
+
+/* Signed values at the limits of each Steim bit width */
+static int32_t limits[] =
+    {7, -8, 15, -16, 31, -32, 127, -128, 511, -512,
+     16383, -16384, 32767, -32768, 536870911, -536870912};
+
+int
+main (int argc, char **argv)
+{
+  int32_t *data;
+  uint32_t state = 11;
+  uint32_t step;
+  int failures   = 0;
+  int idx;
+
+  /* Suppress expected errors for unrepresentable differences */
+  ms_loginit (print_none, NULL, print_none, NULL);
+
+  /* Process given parameters (command line and parameter file) */
+  if (parameter_proc (argc, argv) < 0)
+    return -1;
+
+  if (!(data = (int32_t *)malloc (SAMPLECOUNT * sizeof (int32_t))))
+  {
+    fprintf (stderr, "Could not allocate buffer, out of memory?\n");
+    return 1;
+  }
+
+  /* Constant values */
+  for (idx = 0; idx < SAMPLECOUNT; idx++)
+    data[idx] = 1234567;
+  failures += compare ("constant", data, SAMPLECOUNT);
+
+  /* Alternating between the extremes, differences overflow and wrap */
+  for (idx = 0; idx < SAMPLECOUNT; idx++)
+    data[idx] = (idx % 2) ? INT32_MAX : INT32_MIN;
+  failures += compare ("overflow", data, SAMPLECOUNT);
+
+  /* Alternating across each bit width limit */
+  for (idx = 0; idx < SAMPLECOUNT; idx++)
+    data[idx] = (idx % 2) ? limits[(idx / 64) % 16] : 0;
+  failures += compare ("alternating", data, SAMPLECOUNT);
+
+  /* Random walk with steps at bit width limits, computed unsigned to wrap */
+  data[0] = 0;
+  for (idx = 1; idx < SAMPLECOUNT; idx++)
+    data[idx] = (int32_t)((uint32_t)data[idx - 1] + (uint32_t)limits[lcg (&state) % 14]);
+  failures += compare ("limits", data, SAMPLECOUNT);
+
+  /* Random walk with runs of differing step magnitudes, computed unsigned to wrap */
+  data[0] = (int32_t)lcg (&state);
+  for (idx = 1; idx < SAMPLECOUNT; idx++)
+  {
+    step      = lcg (&state) >> (2 + (idx / 37) % 30);
+    step     -= lcg (&state) >> (2 + (idx / 37) % 30);
+    data[idx] = (int32_t)((uint32_t)data[idx - 1] + step);
+  }
+  failures += compare ("random", data, SAMPLECOUNT);
+
+  /* Small random values with occasional large differences */
+  for (idx = 0; idx < SAMPLECOUNT; idx++)
+    data[idx] = (lcg (&state) % 97) ? (int32_t)(lcg (&state) % 16) - 8 : (int32_t)lcg (&state);
+  failures += compare ("spikes", data, SAMPLECOUNT);
+
+  /* Random frames, decoded only */
+  failures += compareframes ("frames", &state);
+
+  free (data);
+
+  printf ("%s: %d data sets differ\n", (encoding == DE_STEIM1) ? "Steim1" : "Steim2", failures);
+
+  return (failures) ? 1 : 0;
+} /* End of main() */
+
+/***************************************************************************
+ * encode:
+ *
+ * Encode with the selected Steim encoder.
+ *
+ * Returns the number of samples encoded or -1 on error.
+ ***************************************************************************/
+static int
+encode (int32_t *input, int samplecount, int32_t *output,
+        int outputlength, int32_t diff0, int swapflag)
+{
+  if (encoding == DE_STEIM1)
+    return msr_encode_steim1 (input, samplecount, output, outputlength, diff0, swapflag);
+  else
+    return msr_encode_steim2 (input, samplecount, output, outputlength, diff0, "TEST", swapflag);
+} /* End of encode() */
+
+/***************************************************************************
+ * decode:
+ *
+ * Decode with the selected Steim decoder.
+ *
+ * Returns the number of samples decoded or -1 on error.
+ ***************************************************************************/
+static int
+decode (int32_t *input, int inputlength, int samplecount,
+        int32_t *output, int swapflag)
+{
+  if (encoding == DE_STEIM1)
+    return msr_decode_steim1 (input, inputlength, samplecount, output,
+                              samplecount * sizeof (int32_t), "TEST", swapflag);
+  else
+    return msr_decode_steim2 (input, inputlength, samplecount, output,
+                              samplecount * sizeof (int32_t), "TEST", swapflag);
+} /* End of decode() */
+
+/***************************************************************************
+ * compare:
+ *
+ * Compare the output of the SIMD encoders at each supported level to
+ * the reference encoder for different sample counts, output lengths,
+ * first differences and byte orders.
+ *
+ * Returns 0 if all output is identical and 1 otherwise.
+ ***************************************************************************/
+static int
+compare (const char *name, int32_t *input, int samplecount)
+{
+  int32_t reference[MAXOUTPUT / 4];
+  int32_t output[MAXOUTPUT / 4];
+  int32_t diff0s[]   = {0, -1, 536870911, INT32_MIN};
+  int counts[]       = {1, 2, 7, 8, 105, samplecount};
+  int outputlength[] = {64, 100, 448, 4032, MAXOUTPUT};
+  int refsamples;
+  int samples;
+  int level;
+  int cidx;
+  int oidx;
+  int didx;
+  int swapflag;
+
+  for (cidx = 0; cidx < (int)(sizeof (counts) / sizeof (int)); cidx++)
+    for (oidx = 0; oidx < (int)(sizeof (outputlength) / sizeof (int)); oidx++)
+      for (didx = 0; didx < (int)(sizeof (diff0s) / sizeof (int32_t)); didx++)
+        for (swapflag = 0; swapflag <= 1; swapflag++)
+        {
+          encodesimd = LMP_SIMD_NONE;
+          memset (reference, 0xA5, sizeof (reference));
+          refsamples = encode (input, counts[cidx], reference, outputlength[oidx],
+                               diff0s[didx], swapflag);
+
+          for (level = LMP_SIMD_NONE + 1; level <= lmp_simdlevel (); level++)
+          {
+            encodesimd = level;
+            memset (output, 0xA5, sizeof (output));
+            samples = encode (input, counts[cidx], output, outputlength[oidx],
+                              diff0s[didx], swapflag);
+
+            if (samples != refsamples || memcmp (output, reference, sizeof (output)))
+            {
+              printf ("%s: output differs for SIMD level %d, samples: %d, output length: %d, diff0: %d, swap: %d\n",
+                      name, level, counts[cidx], outputlength[oidx], diff0s[didx], swapflag);
+              encodesimd = -1;
+              return 1;
+            }
+          }
+
+          encodesimd = -1;
+
+          /* Decode encoded frames, also with fewer samples than encoded */
+          if (refsamples > 0 &&
+              (comparedecode (reference, outputlength[oidx], refsamples, swapflag) ||
+               comparedecode (reference, outputlength[oidx], refsamples / 2 + 1, swapflag)))
+          {
+            printf ("%s: decoded samples differ, samples: %d, output length: %d, diff0: %d, swap: %d\n",
+                    name, counts[cidx], outputlength[oidx], diff0s[didx], swapflag);
+            return 1;
+          }
+        }
+
+  encodesimd = -1;
+
+  printf ("%s: identical\n", name);
+
+  return 0;
+} /* End of compare() */
+
+/***************************************************************************
+ * comparedecode:
+ *
+ * Compare the output of the SIMD decoders at each supported level to
+ * the reference decoder.
+ *
+ * Returns 0 if all output is identical and 1 otherwise.
+ ***************************************************************************/
+static int
+comparedecode (int32_t *input, int inputlength, int samplecount, int swapflag)
+{
+  static int32_t reference[SAMPLECOUNT];
+  static int32_t output[SAMPLECOUNT];
+  int refsamples;
+  int samples;
+  int level;
+
+  if (samplecount > SAMPLECOUNT)
+    samplecount = SAMPLECOUNT;
+
+  decodesimd = LMP_SIMD_NONE;
+  memset (reference, 0xA5, sizeof (reference));
+  refsamples = decode (input, inputlength, samplecount, reference, swapflag);
+
+  for (level = LMP_SIMD_NONE + 1; level <= lmp_simdlevel (); level++)
+  {
+    decodesimd = level;
+    memset (output, 0xA5, sizeof (output));
+    samples = decode (input, inputlength, samplecount, output, swapflag);
+
+    if (samples != refsamples || memcmp (output, reference, sizeof (output)))
+    {
+      printf ("Decoding differs for SIMD level %d, samples: %d, input length: %d, swap: %d\n",
+              level, samplecount, inputlength, swapflag);
+      decodesimd = -1;
+      return 1;
+    }
+  }
+
+  decodesimd = -1;
+
+  return 0;
+} /* End of comparedecode() */
+
+/***************************************************************************
+ * compareframes:
+ *
+ * Compare decoding of random frames, both with and without invalid
+ * Steim2 words, for different input lengths and sample counts.
+ *
+ * Returns 0 if all output is identical and 1 otherwise.
+ ***************************************************************************/
+static int
+compareframes (const char *name, uint32_t *state)
+{
+  uint32_t frames[MAXOUTPUT / 4];
+  int inputlength[] = {64, 448, 4032, MAXOUTPUT};
+  int counts[]      = {1, 50, 500, SAMPLECOUNT};
+  uint32_t dnib;
+  int nibble;
+  int valid;
+  int iidx;
+  int cidx;
+  int widx;
+  int swapflag;
+
+  for (valid = 0; valid <= 1; valid++)
+    for (swapflag = 0; swapflag <= 1; swapflag++)
+    {
+      for (widx = 0; widx < MAXOUTPUT / 4; widx++)
+        frames[widx] = lcg (state);
+
+      /* Replace invalid Steim2 dnib values */
+      for (widx = 0; valid && widx < MAXOUTPUT / 4; widx++)
+      {
+        if (widx % 16 == 0)
+          continue;
+
+        nibble = (frames[widx - widx % 16] >> (30 - 2 * (widx % 16))) & 0x3;
+        dnib   = frames[widx] >> 30;
+
+        if ((nibble == 2 && dnib == 0) || (nibble == 3 && dnib == 3))
+          frames[widx] ^= 0x1ul << 30;
+      }
+
+      for (widx = 0; swapflag && widx < MAXOUTPUT / 4; widx++)
+        ms_gswap4a (&frames[widx]);
+
+      for (iidx = 0; iidx < (int)(sizeof (inputlength) / sizeof (int)); iidx++)
+        for (cidx = 0; cidx < (int)(sizeof (counts) / sizeof (int)); cidx++)
+          if (comparedecode ((int32_t *)frames, inputlength[iidx], counts[cidx], swapflag))
+          {
+            printf ("%s: decoded samples differ, valid: %d\n", name, valid);
+            return 1;
+          }
+    }
+
+  printf ("%s: identical\n", name);
+
+  return 0;
+} /* End of compareframes() */
+
+/***************************************************************************
+ * lcg:
+ *
+ * A linear congruential generator, used instead of rand() to produce
+ * the same data sets on all platforms.
+ *
+ * Returns the next pseudo-random value.
+ ***************************************************************************/
+static uint32_t
+lcg (uint32_t *state)
+{
+  *state = *state * 1664525u + 1013904223u;
+
+  return *state;
+} /* End of lcg() */
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-e") == 0 && optind + 1 < argcount)
+    {
+      encoding = strtol (argvec[++optind], NULL, 10);
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      exit (1);
+    }
+  }
+
+  if (encoding != DE_STEIM1 && encoding != DE_STEIM2)
+  {
+    ms_log (2, "Encoding must be Steim1 (10) or Steim2 (11)\n");
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * print_none():
+ * Discard log messages.
+ ***************************************************************************/
+static void
+print_none (char *message)
+{
+} /* End of print_none() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Steim encoder test program version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr,
+           " ## Options ##\n"
+           " -V             Report program version\n"
+           " -h             Show this usage message\n"
+           " -e encoding    Specify Steim encoding to test, 10 or 11, default: 11\n"
+           "\n");
+} /* End of usage() */
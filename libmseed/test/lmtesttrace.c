@@ -0,0 +1,639 @@
+/***************************************************************************
+ * lmtesttrace.c
+ *
+ * A program for libmseed trace list and trace group tests.
+ *
+ * Records of many channels, each with a number of segments separated
+ * by gaps, are added to an MSTraceList in a pseudo-random order.  The
+ * resulting trace IDs must be unique and in ascending source name
+ * order and each ID must contain exactly the expected segments.
+ *
+ * With -g the records are added to an MSTraceGroup with and without
+ * the channel index, the resulting trace chains must be identical.
+ *
+ * With -H the records are added as separate traces to an MSTraceGroup
+ * and healed, the result must be identical to healing by comparing
+ * every pair of traces.
+ *
+ * With -a the trace list, indexed trace group or healed trace group
+ * allocates its structures from an arena.
+ *
+ * modified 2026.289
+ ***************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " example]"
+#define PACKAGE "lmtesttrace"
+
+/* Samples in each record, at 1 sample per second */
+#define RECSAMPLES 100
+
+/* Gap between segments in seconds */
+#define SEGMENTGAP 1000
+
+static int channels = 1000;
+static int segments = 3;
+static int records  = 5;
+static flag printlist = 0;
+static flag tracegroup = 0;
+static flag traceheal = 0;
+static flag usearena = 0;
+
+static int parameter_proc (int argcount, char **argvec);
+static void setrecord (MSRecord *msr, int channel, int segment, int record);
+static hptime_t segmentstart (int segment);
+static int checklist (MSTraceList *mstl);
+static int testgroup (MSRecord *msr, int32_t *order, int32_t total);
+static int addgroup (MSTraceGroup *mstg, MSRecord *msr, int32_t *order, int32_t total);
+static int testheal (MSRecord *msr, int32_t *order, int32_t total);
+static int addtraces (MSTraceGroup *mstg, MSRecord *msr, int32_t *order, int32_t total);
+static int pairheal (MSTraceGroup *mstg, double timetol, double sampratetol);
+static uint32_t lcg (uint32_t *state);
+static void usage (void);
+
+int
+main (int argc, char **argv)
+{
+  MSTraceList *mstl = 0;
+  MSRecord *msr     = 0;
+  int32_t *order;
+  int32_t total;
+  int32_t swap;
+  int32_t idx;
+  int32_t jdx;
+  uint32_t state = 17;
+  int errors;
+
+  /* Process given parameters (command line and parameter file) */
+  if (parameter_proc (argc, argv) < 0)
+    return -1;
+
+  total = channels * segments * records;
+
+  if (!(order = (int32_t *)malloc (total * sizeof (int32_t))) ||
+      !(msr = msr_init (NULL)) || !(mstl = mstl_init (NULL)) ||
+      (usearena && !(mstl->arena = ms_arena_init (0))))
+  {
+    fprintf (stderr, "Could not allocate memory, out of memory?\n");
+    return 1;
+  }
+
+  /* Shuffle the order of all records */
+  for (idx = 0; idx < total; idx++)
+    order[idx] = idx;
+
+  for (idx = total - 1; idx > 0; idx--)
+  {
+    jdx        = lcg (&state) % (idx + 1);
+    swap       = order[idx];
+    order[idx] = order[jdx];
+    order[jdx] = swap;
+  }
+
+  if (tracegroup || traceheal)
+  {
+    errors = (traceheal) ? testheal (msr, order, total) : testgroup (msr, order, total);
+
+    msr_free (&msr);
+    mstl_free (&mstl, 0);
+    free (order);
+
+    return (errors) ? 1 : 0;
+  }
+
+  for (idx = 0; idx < total; idx++)
+  {
+    setrecord (msr, order[idx] / (segments * records),
+               (order[idx] / records) % segments, order[idx] % records);
+
+    if (!mstl_addmsr (mstl, msr, 0, 1, -1.0, -1.0))
+    {
+      fprintf (stderr, "Error adding record %d\n", order[idx]);
+      return 1;
+    }
+  }
+
+  errors = checklist (mstl);
+
+  if (printlist)
+    mstl_printtracelist (mstl, 1, 1, 1);
+
+  printf ("Trace list: %d traces, %d records, %d errors\n",
+          mstl->numtraces, total, errors);
+
+  mstl_free (&mstl, 0);
+  msr_free (&msr);
+  free (order);
+
+  return (errors) ? 1 : 0;
+} /* End of main() */
+
+/***************************************************************************
+ * setrecord:
+ *
+ * Set the header values of a record of a segment of a channel.
+ ***************************************************************************/
+static void
+setrecord (MSRecord *msr, int channel, int segment, int record)
+{
+  /* Station names are not created in order */
+  strcpy (msr->network, "XX");
+  snprintf (msr->station, sizeof (msr->station), "S%04d", (channel / 3 * 7919) % 10000);
+  strcpy (msr->location, (channel % 2) ? "00" : "");
+  snprintf (msr->channel, sizeof (msr->channel), "BH%c", "ZNE"[channel % 3]);
+  msr->dataquality = 'D';
+
+  msr->starttime = segmentstart (segment) + (hptime_t)record * RECSAMPLES * HPTMODULUS;
+  msr->samprate  = 1.0;
+  msr->samplecnt = RECSAMPLES;
+} /* End of setrecord() */
+
+/***************************************************************************
+ * segmentstart:
+ *
+ * Returns the start time of a segment.
+ ***************************************************************************/
+static hptime_t
+segmentstart (int segment)
+{
+  return ms_time2hptime (2026, 1, 0, 0, 0, 0) +
+         (hptime_t)segment * (records * RECSAMPLES + SEGMENTGAP) * HPTMODULUS;
+} /* End of segmentstart() */
+
+/***************************************************************************
+ * checklist:
+ *
+ * Check the order of trace IDs and the segments of each ID.
+ *
+ * Returns the number of errors found.
+ ***************************************************************************/
+static int
+checklist (MSTraceList *mstl)
+{
+  MSTraceID *id;
+  MSTraceSeg *seg;
+  int errors = 0;
+  int count  = 0;
+  int segment;
+
+  for (id = mstl->traces; id; id = id->next)
+  {
+    count++;
+
+    if (id->next && strcmp (id->srcname, id->next->srcname) >= 0)
+    {
+      printf ("Trace %s not before %s\n", id->srcname, id->next->srcname);
+      errors++;
+    }
+
+    if (id->numsegments != segments)
+    {
+      printf ("Trace %s has %d segments\n", id->srcname, id->numsegments);
+      errors++;
+    }
+
+    for (seg = id->first, segment = 0; seg; seg = seg->next, segment++)
+    {
+      if (seg->starttime != segmentstart (segment) ||
+          seg->samplecnt != (int64_t)records * RECSAMPLES)
+      {
+        printf ("Trace %s segment %d does not match\n", id->srcname, segment);
+        errors++;
+      }
+    }
+  }
+
+  if (count != mstl->numtraces || count != channels)
+  {
+    printf ("Trace list has %d of %d traces\n", count, mstl->numtraces);
+    errors++;
+  }
+
+  return errors;
+} /* End of checklist() */
+
+/***************************************************************************
+ * testgroup:
+ *
+ * Add records to trace groups with and without the channel index and
+ * compare the trace chains.  Segments alternate in data quality and
+ * records are grouped by quality.
+ *
+ * Returns the number of errors found.
+ ***************************************************************************/
+static int
+testgroup (MSRecord *msr, int32_t *order, int32_t total)
+{
+  MSTraceGroup *plain   = 0;
+  MSTraceGroup *indexed = 0;
+  MSTrace *mst1;
+  MSTrace *mst2;
+  int errors = 0;
+
+  if (!(plain = mst_initgroup (NULL)) || !(indexed = mst_initgroup (NULL)) ||
+      mst_groupindex (indexed, 1) || (usearena && !(indexed->arena = ms_arena_init (0))))
+  {
+    fprintf (stderr, "Could not allocate memory, out of memory?\n");
+    return 1;
+  }
+
+  if (addgroup (plain, msr, order, total) || addgroup (indexed, msr, order, total))
+    return 1;
+
+  for (mst1 = plain->traces, mst2 = indexed->traces; mst1 && mst2;
+       mst1 = mst1->next, mst2 = mst2->next)
+  {
+    if (strcmp (mst1->network, mst2->network) || strcmp (mst1->station, mst2->station) ||
+        strcmp (mst1->location, mst2->location) || strcmp (mst1->channel, mst2->channel) ||
+        mst1->dataquality != mst2->dataquality || mst1->starttime != mst2->starttime ||
+        mst1->endtime != mst2->endtime || mst1->samplecnt != mst2->samplecnt)
+    {
+      printf ("Trace %s.%s.%s.%s differs\n", mst1->network, mst1->station,
+              mst1->location, mst1->channel);
+      errors++;
+    }
+  }
+
+  if (mst1 || mst2 || plain->numtraces != indexed->numtraces)
+  {
+    printf ("Trace groups have %d and %d traces\n", plain->numtraces, indexed->numtraces);
+    errors++;
+  }
+
+  if (printlist)
+    mst_printtracelist (indexed, 1, 1, 1);
+
+  printf ("Trace group: %d traces, %d records, %d errors\n",
+          indexed->numtraces, total, errors);
+
+  mst_freegroup (&plain);
+  mst_freegroup (&indexed);
+
+  return errors;
+} /* End of testgroup() */
+
+/***************************************************************************
+ * addgroup:
+ *
+ * Add records to a trace group in the specified order.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+addgroup (MSTraceGroup *mstg, MSRecord *msr, int32_t *order, int32_t total)
+{
+  int32_t idx;
+  int segment;
+
+  for (idx = 0; idx < total; idx++)
+  {
+    segment = (order[idx] / records) % segments;
+
+    setrecord (msr, order[idx] / (segments * records), segment, order[idx] % records);
+    msr->dataquality = (segment % 2) ? 'R' : 'D';
+
+    if (!mst_addmsrtogroup (mstg, msr, 1, -1.0, -1.0))
+    {
+      fprintf (stderr, "Error adding record %d\n", order[idx]);
+      return -1;
+    }
+  }
+
+  return 0;
+} /* End of addgroup() */
+
+/***************************************************************************
+ * testheal:
+ *
+ * Add records as separate traces to two trace groups, heal one with
+ * mst_groupheal() and the other by comparing every pair of traces and
+ * compare the trace chains including the data samples.
+ *
+ * Returns the number of errors found.
+ ***************************************************************************/
+static int
+testheal (MSRecord *msr, int32_t *order, int32_t total)
+{
+  MSTraceGroup *healed = 0;
+  MSTraceGroup *paired = 0;
+  MSTrace *mst1;
+  MSTrace *mst2;
+  int mergings;
+  int errors = 0;
+
+  if (!(healed = mst_initgroup (NULL)) || !(paired = mst_initgroup (NULL)) ||
+      (usearena && !(healed->arena = ms_arena_init (0))))
+  {
+    fprintf (stderr, "Could not allocate memory, out of memory?\n");
+    return 1;
+  }
+
+  if (addtraces (healed, msr, order, total) || addtraces (paired, msr, order, total))
+    return 1;
+
+  mergings = mst_groupheal (healed, -1.0, -1.0);
+
+  if (mergings != pairheal (paired, -1.0, -1.0))
+  {
+    printf ("Trace groups healed with different merge counts\n");
+    errors++;
+  }
+
+  for (mst1 = healed->traces, mst2 = paired->traces; mst1 && mst2;
+       mst1 = mst1->next, mst2 = mst2->next)
+  {
+    if (strcmp (mst1->network, mst2->network) || strcmp (mst1->station, mst2->station) ||
+        strcmp (mst1->location, mst2->location) || strcmp (mst1->channel, mst2->channel) ||
+        mst1->dataquality != mst2->dataquality || mst1->starttime != mst2->starttime ||
+        mst1->endtime != mst2->endtime || mst1->samplecnt != mst2->samplecnt ||
+        mst1->numsamples != mst2->numsamples ||
+        memcmp (mst1->datasamples, mst2->datasamples, (size_t) (mst1->numsamples * sizeof (int32_t))))
+    {
+      printf ("Trace %s.%s.%s.%s differs\n", mst1->network, mst1->station,
+              mst1->location, mst1->channel);
+      errors++;
+    }
+  }
+
+  if (mst1 || mst2 || healed->numtraces != paired->numtraces)
+  {
+    printf ("Trace groups have %d and %d traces\n", healed->numtraces, paired->numtraces);
+    errors++;
+  }
+
+  if (printlist)
+    mst_printtracelist (healed, 1, 1, 1);
+
+  printf ("Trace heal: %d traces, %d mergings, %d errors\n",
+          healed->numtraces, mergings, errors);
+
+  mst_freegroup (&healed);
+  mst_freegroup (&paired);
+
+  return errors;
+} /* End of testheal() */
+
+/***************************************************************************
+ * addtraces:
+ *
+ * Add records as separate traces to a trace group in the specified
+ * order.  The data quality alternates by record and the second record
+ * of every fifth segment has a different sample rate.  Data samples
+ * are the sample number in the channel.  Traces are allocated from the
+ * arena of the group if present.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+addtraces (MSTraceGroup *mstg, MSRecord *msr, int32_t *order, int32_t total)
+{
+  MSTrace *mst;
+  int32_t *samples;
+  int32_t idx;
+  int sample;
+  int segment;
+  int record;
+
+  for (idx = 0; idx < total; idx++)
+  {
+    segment = (order[idx] / records) % segments;
+    record  = order[idx] % records;
+
+    setrecord (msr, order[idx] / (segments * records), segment, record);
+
+    if (!(mst = mst_init ((mstg->arena) ? (MSTrace *)ms_arena_alloc (mstg->arena, sizeof (MSTrace)) : NULL)) ||
+        !(samples = (int32_t *)malloc (RECSAMPLES * sizeof (int32_t))))
+    {
+      fprintf (stderr, "Could not allocate memory, out of memory?\n");
+      return -1;
+    }
+
+    for (sample = 0; sample < RECSAMPLES; sample++)
+      samples[sample] = (segment * records + record) * RECSAMPLES + sample;
+
+    strcpy (mst->network, msr->network);
+    strcpy (mst->station, msr->station);
+    strcpy (mst->location, msr->location);
+    strcpy (mst->channel, msr->channel);
+    mst->dataquality = (record % 2) ? 'R' : 'D';
+    mst->starttime   = msr->starttime;
+    mst->endtime     = msr->starttime + (hptime_t) (RECSAMPLES - 1) * HPTMODULUS;
+    mst->samprate    = (record == 1 && order[idx] / records % 5 == 0) ? 1.5 : msr->samprate;
+    mst->datasamples = samples;
+    mst->numsamples  = RECSAMPLES;
+    mst->samplecnt   = RECSAMPLES;
+    mst->sampletype  = 'i';
+
+    if (!mst_addtracetogroup (mstg, mst))
+    {
+      fprintf (stderr, "Error adding record %d\n", order[idx]);
+      return -1;
+    }
+  }
+
+  return 0;
+} /* End of addtraces() */
+
+/***************************************************************************
+ * pairheal:
+ *
+ * Heal a trace group by comparing every pair of traces, the reference
+ * for mst_groupheal().
+ *
+ * Return number of trace mergings.
+ ***************************************************************************/
+static int
+pairheal (MSTraceGroup *mstg, double timetol, double sampratetol)
+{
+  int mergings         = 0;
+  MSTrace *curtrace    = 0;
+  MSTrace *nexttrace   = 0;
+  MSTrace *searchtrace = 0;
+  MSTrace *prevtrace   = 0;
+  double postgap, pregap, delta;
+  flag whence;
+
+  mst_groupsort (mstg, 1);
+
+  for (curtrace = mstg->traces; curtrace; curtrace = curtrace->next)
+  {
+    prevtrace = mstg->traces;
+
+    for (nexttrace = mstg->traces; nexttrace;)
+    {
+      searchtrace = nexttrace;
+      nexttrace   = searchtrace->next;
+
+      if (searchtrace == curtrace ||
+          strcmp (searchtrace->network, curtrace->network) ||
+          strcmp (searchtrace->station, curtrace->station) ||
+          strcmp (searchtrace->location, curtrace->location) ||
+          strcmp (searchtrace->channel, curtrace->channel))
+      {
+        prevtrace = searchtrace;
+        continue;
+      }
+
+      if ((sampratetol == -1.0) ? !MS_ISRATETOLERABLE (searchtrace->samprate, curtrace->samprate)
+                                : ms_dabs (searchtrace->samprate - curtrace->samprate) > sampratetol)
+      {
+        prevtrace = searchtrace;
+        continue;
+      }
+
+      delta   = (curtrace->samprate) ? (1.0 / curtrace->samprate) : 0.0;
+      postgap = ((double)(searchtrace->starttime - curtrace->endtime) / HPTMODULUS) - delta;
+      pregap  = ((double)(curtrace->starttime - searchtrace->endtime) / HPTMODULUS) - delta;
+
+      if (timetol == -1.0)
+        timetol = 0.5 * delta;
+
+      if (ms_dabs (postgap) <= timetol)
+        whence = 1;
+      else if (ms_dabs (pregap) <= timetol)
+        whence = 2;
+      else
+      {
+        prevtrace = searchtrace;
+        continue;
+      }
+
+      mst_addspan (curtrace, searchtrace->starttime, searchtrace->endtime,
+                   searchtrace->datasamples, searchtrace->numsamples,
+                   searchtrace->sampletype, whence);
+
+      if (curtrace->dataquality != searchtrace->dataquality)
+        curtrace->dataquality = 0;
+
+      if (searchtrace == mstg->traces)
+        mstg->traces = nexttrace;
+      else
+        prevtrace->next = nexttrace;
+
+      mst_free (&searchtrace);
+
+      mstg->numtraces--;
+      mergings++;
+    }
+  }
+
+  return mergings;
+} /* End of pairheal() */
+
+/***************************************************************************
+ * lcg:
+ *
+ * Returns the next value of a linear congruential generator.
+ ***************************************************************************/
+static uint32_t
+lcg (uint32_t *state)
+{
+  *state = *state * 1664525u + 1013904223u;
+
+  return *state >> 1;
+} /* End of lcg() */
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+  {
+    if (strcmp (argvec[optind], "-V") == 0)
+    {
+      ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-h") == 0)
+    {
+      usage ();
+      exit (0);
+    }
+    else if (strcmp (argvec[optind], "-c") == 0 && optind + 1 < argcount)
+    {
+      channels = strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-s") == 0 && optind + 1 < argcount)
+    {
+      segments = strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-r") == 0 && optind + 1 < argcount)
+    {
+      records = strtol (argvec[++optind], NULL, 10);
+    }
+    else if (strcmp (argvec[optind], "-p") == 0)
+    {
+      printlist = 1;
+    }
+    else if (strcmp (argvec[optind], "-g") == 0)
+    {
+      tracegroup = 1;
+    }
+    else if (strcmp (argvec[optind], "-H") == 0)
+    {
+      traceheal = 1;
+    }
+    else if (strcmp (argvec[optind], "-a") == 0)
+    {
+      usearena = 1;
+    }
+    else
+    {
+      ms_log (2, "Unknown option: %s\n", argvec[optind]);
+      exit (1);
+    }
+  }
+
+  if (channels <= 0 || segments <= 0 || records <= 0)
+  {
+    ms_log (2, "Channel, segment and record counts must be positive\n");
+    return -1;
+  }
+
+  /* Station names repeat after 10000 stations */
+  if (channels > 30000)
+  {
+    ms_log (2, "Channel count must be at most 30000\n");
+    return -1;
+  }
+
+  return 0;
+} /* End of parameter_proc() */
+
+/***************************************************************************
+ * usage():
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s - Trace list test program version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr,
+           " ## Options ##\n"
+           " -V             Report program version\n"
+           " -h             Show this usage message\n"
+           " -c channels    Specify the number of channels, default: 1000\n"
+           " -s segments    Specify the number of segments per channel, default: 3\n"
+           " -r records     Specify the number of records per segment, default: 5\n"
+           " -p             Print the trace list\n"
+           " -g             Test trace groups instead of a trace list\n"
+           " -H             Test healing of trace groups instead of a trace list\n"
+           " -a             Allocate structures from an arena\n"
+           "\n");
+} /* End of usage() */
@@ -15,10 +15,72 @@
 
 #include "libmseed.h"
 
-MSTraceSeg *mstl_msr2seg (MSRecord *msr, hptime_t endtime);
+MSTraceSeg *mstl_msr2seg (MSTraceList *mstl, MSRecord *msr, hptime_t endtime);
 MSTraceSeg *mstl_addmsrtoseg (MSTraceSeg *seg, MSRecord *msr, hptime_t endtime, flag whence);
 MSTraceSeg *mstl_addsegtoseg (MSTraceSeg *seg1, MSTraceSeg *seg2);
 
+/* Index of the trace IDs of an MSTraceList.  IDs are found by source
+ * name in a hash table with open addressing and linear probing, the
+ * hash of each source name is kept to avoid most string comparisons.
+ * The sorted array contains the IDs in list order to find the place of
+ * a new ID with a binary search. */
+typedef struct MSTraceIndex_s
+{
+  MSTraceID **table;   /* Hash table of trace IDs */
+  uint32_t *hashes;    /* Source name hash of each table entry */
+  int32_t tablesize;   /* Size of hash table, a power of 2 */
+  MSTraceID **sorted;  /* Trace IDs in list order */
+  int32_t sortedsize;  /* Allocated length of sorted array */
+  int32_t count;       /* Number of indexed trace IDs */
+} MSTraceIndex;
+
+static MSTraceIndex *mstl_buildindex (MSTraceList *mstl);
+static void mstl_freeindex (MSTraceIndex **ppindex);
+static uint32_t mstl_hashsrcname (const char *srcname);
+static MSTraceID *mstl_findid (MSTraceIndex *index, const char *srcname, uint32_t hash);
+static MSTraceID *mstl_precedingid (MSTraceIndex *index, const char *srcname, int32_t *position);
+static int mstl_indexid (MSTraceIndex *index, MSTraceID *id, uint32_t hash, int32_t position);
+static void *mstl_alloc (MSTraceList *mstl, size_t size);
+static void mstl_release (MSTraceList *mstl, void *ptr);
+
+/* Minimum number of segments of a trace ID before they are indexed */
+#define MSTL_SEGINDEX_MIN 8
+
+/* Reference to a segment with the times of the segment when indexed */
+typedef struct MSTraceSegRef_s
+{
+  MSTraceSeg *seg;     /* Indexed segment */
+  hptime_t starttime;  /* Start time of segment when indexed */
+  hptime_t endtime;    /* End time of segment when indexed */
+} MSTraceSegRef;
+
+/* Index of the segments of a trace ID.  Segments are referenced in
+ * list order, ascending start time and descending end time, and in
+ * ascending end time order to find the segments that a record fits
+ * before or after with a binary search.  A modified segment is removed
+ * from the index before its times change and added again once it is
+ * in place in the list. */
+typedef struct MSTraceSegIndex_s
+{
+  MSTraceSegRef *bystart;  /* Segments in list order */
+  MSTraceSegRef *byend;    /* Segments in end time order */
+  int32_t *matches;        /* List positions of candidate segments */
+  int32_t count;           /* Number of indexed segments */
+  int32_t size;            /* Allocated length of arrays */
+} MSTraceSegIndex;
+
+static MSTraceSegIndex *mstl_segindex (MSTraceID *id, flag build);
+static void mstl_freesegindex (MSTraceSegIndex **ppindex);
+static int32_t mstl_segbound (MSTraceSegRef *refs, int32_t count, hptime_t time, flag end);
+static int32_t mstl_segposition (MSTraceSegIndex *index, MSTraceSeg *seg);
+static void mstl_segremove (MSTraceSegIndex *index, MSTraceSeg *seg);
+static int mstl_seginsert (MSTraceSegIndex *index, MSTraceSeg *seg);
+static void mstl_segsearch (MSTraceSegIndex *index, MSRecord *msr, hptime_t endtime,
+                            hptime_t hpdelta, hptime_t hptimetol, double sampratetol,
+                            flag autoheal, MSTraceSeg **segbefore, MSTraceSeg **segafter,
+                            MSTraceSeg **followseg);
+static int mstl_segcmppos (const void *pos1, const void *pos2);
+
 /***************************************************************************
  * mstl_init:
  *
@@ -91,7 +153,7 @@ mstl_free (MSTraceList **ppmstl, flag freeprvtptr)
         if (seg->datasamples)
           free (seg->datasamples);
 
-        free (seg);
+        mstl_release (*ppmstl, seg);
         seg = nextseg;
       }
 
@@ -99,10 +161,16 @@ mstl_free (MSTraceList **ppmstl, flag freeprvtptr)
       if (freeprvtptr && id->prvtptr)
         free (id->prvtptr);
 
-      free (id);
+      mstl_freesegindex (&id->index);
+
+      mstl_release (*ppmstl, id);
       id = nextid;
     }
 
+    mstl_freeindex (&(*ppmstl)->index);
+
+    ms_arena_free (&(*ppmstl)->arena);
+
     free (*ppmstl);
 
     *ppmstl = NULL;
@@ -126,9 +194,16 @@ mstl_free (MSTraceList **ppmstl, flag freeprvtptr)
  * added.  For segments that are removed, any memory at the prvtptr
  * will be freed.
  *
+ * If the MSTraceList has an arena new MSTraceIDs and MSTraceSegs are
+ * allocated from it, they are released when the list is freed.
+ *
  * An MSTraceList is always maintained with the MSTraceIDs in
- * descending alphanumeric order.  MSTraceIDs are always maintained
- * with MSTraceSegs in data time time order.
+ * ascending alphanumeric order.  The MSTraceIDs are indexed by source
+ * name, the list of IDs should only be modified by this routine.
+ * MSTraceIDs are always maintained with MSTraceSegs in data time time
+ * order.  The MSTraceSegs of IDs with many segments are indexed by
+ * start and end time, an index that no longer matches the segment list
+ * is discarded.
  *
  * Return a pointer to the MSTraceSeg updated or 0 on error.
  ***************************************************************************/
@@ -136,9 +211,10 @@ MSTraceSeg *
 mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
              flag autoheal, double timetol, double sampratetol)
 {
-  MSTraceID *id       = 0;
-  MSTraceID *searchid = 0;
-  MSTraceID *ltid     = 0;
+  MSTraceIndex *index       = 0;
+  MSTraceSegIndex *segindex = 0;
+  MSTraceID *id             = 0;
+  MSTraceID *ltid           = 0;
 
   MSTraceSeg *seg       = 0;
   MSTraceSeg *searchseg = 0;
@@ -156,14 +232,11 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
   hptime_t nhptimetol = 0;
 
   char srcname[45];
-  char *s1, *s2;
+  uint32_t hash = 0;
+  int32_t position = 0;
   flag whence;
   flag lastratecheck;
   flag firstratecheck;
-  int mag;
-  int cmp;
-  int ltmag;
-  int ltcmp;
 
   if (!mstl || !msr)
     return 0;
@@ -183,79 +256,35 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
   }
 
   /* Search for matching trace ID starting with last accessed ID and
-     then looping through the trace ID list. */
-  if (mstl->last)
+     then in the index of trace IDs, which is built if not present or
+     if it does not match the list. */
+  if (mstl->last && !strcmp (mstl->last->srcname, srcname))
   {
-    s1 = mstl->last->srcname;
-    s2 = srcname;
-    while (*s1 == *s2++)
-    {
-      if (*s1++ == '\0')
-        break;
-    }
-    cmp = (*s1 - *--s2);
+    id = mstl->last;
+  }
+  else
+  {
+    index = mstl->index;
 
-    if (!cmp)
+    if (!index || index->count != mstl->numtraces)
     {
-      id = mstl->last;
-    }
-    else
-    {
-      /* Loop through trace ID list searching for a match, simultaneously
-         track the source name which is closest but less than the MSRecord
-         to allow for later insertion with sort order. */
-      searchid = mstl->traces;
-      ltcmp    = 0;
-      ltmag    = 0;
-      while (searchid)
-      {
-        /* Compare source names */
-        s1  = searchid->srcname;
-        s2  = srcname;
-        mag = 0;
-        while (*s1 == *s2++)
-        {
-          mag++;
-          if (*s1++ == '\0')
-            break;
-        }
-        cmp = (*s1 - *--s2);
+      mstl_freeindex (&mstl->index);
 
-        /* If source names did not match track closest "less than" value
-           and continue searching. */
-        if (cmp != 0)
-        {
-          if (cmp < 0)
-          {
-            if ((ltcmp == 0 || cmp >= ltcmp) && mag >= ltmag)
-            {
-              ltcmp = cmp;
-              ltmag = mag;
-              ltid  = searchid;
-            }
-            else if (mag > ltmag)
-            {
-              ltcmp = cmp;
-              ltmag = mag;
-              ltid  = searchid;
-            }
-          }
+      if (!(index = mstl->index = mstl_buildindex (mstl)))
+        return 0;
+    }
 
-          searchid = searchid->next;
-          continue;
-        }
+    hash = mstl_hashsrcname (srcname);
 
-        /* If we made it this far we found a match */
-        id = searchid;
-        break;
-      }
-    }
+    /* If no match track the closest "less than" ID for insertion in sort order */
+    if (!(id = mstl_findid (index, srcname, hash)))
+      ltid = mstl_precedingid (index, srcname, &position);
   } /* Done searching for match in trace ID list */
 
   /* If no matching ID was found create new MSTraceID and MSTraceSeg entries */
   if (!id)
   {
-    if (!(id = (MSTraceID *)calloc (1, sizeof (MSTraceID))))
+    if (!(id = (MSTraceID *)mstl_alloc (mstl, sizeof (MSTraceID))))
     {
       ms_log (2, "mstl_addmsr(): Error allocating memory\n");
       return 0;
@@ -273,12 +302,22 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
     id->latest      = endtime;
     id->numsegments = 1;
 
-    if (!(seg = mstl_msr2seg (msr, endtime)))
+    if (!(seg = mstl_msr2seg (mstl, msr, endtime)))
     {
+      mstl_release (mstl, id);
       return 0;
     }
     id->first = id->last = seg;
 
+    if (mstl_indexid (index, id, hash, position))
+    {
+      if (seg->datasamples)
+        free (seg->datasamples);
+      mstl_release (mstl, seg);
+      mstl_release (mstl, id);
+      return 0;
+    }
+
     /* Add new MSTraceID to MSTraceList */
     if (!mstl->traces || !ltid)
     {
@@ -296,6 +335,9 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
   /* Add data coverage to the matching MSTraceID */
   else
   {
+    /* Use segment index if present and matching the segment list */
+    segindex = mstl_segindex (id, 0);
+
     /* Calculate high-precision sample period */
     hpdelta = (hptime_t) ((msr->samprate) ? (HPTMODULUS / msr->samprate) : 0.0);
 
@@ -340,6 +382,9 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
     /* Record coverage fits at end of last segment */
     if (lastgap <= hptimetol && lastgap >= nhptimetol && lastratecheck)
     {
+      if (segindex)
+        mstl_segremove (segindex, id->last);
+
       if (!mstl_addmsrtoseg (id->last, msr, endtime, 1))
         return 0;
 
@@ -351,7 +396,7 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
     /* Record coverage is after all other coverage */
     else if ((msr->starttime - hpdelta - hptimetol) > id->latest)
     {
-      if (!(seg = mstl_msr2seg (msr, endtime)))
+      if (!(seg = mstl_msr2seg (mstl, msr, endtime)))
         return 0;
 
       /* Add to end of list */
@@ -366,7 +411,7 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
     /* Record coverage is before all other coverage */
     else if ((endtime + hpdelta + hptimetol) < id->earliest)
     {
-      if (!(seg = mstl_msr2seg (msr, endtime)))
+      if (!(seg = mstl_msr2seg (mstl, msr, endtime)))
         return 0;
 
       /* Add to beginning of list */
@@ -381,6 +426,9 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
     /* Record coverage fits at beginning of first segment */
     else if (firstgap <= hptimetol && firstgap >= nhptimetol && firstratecheck)
     {
+      if (segindex)
+        mstl_segremove (segindex, id->first);
+
       if (!mstl_addmsrtoseg (id->first, msr, endtime, 2))
         return 0;
 
@@ -396,6 +444,18 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
       segbefore = 0; /* Find segment that record fits before */
       segafter  = 0; /* Find segment that record fits after */
       followseg = 0; /* Track segment that record follows in time order */
+
+      /* Search the segment index instead of the list for many segments */
+      if (!segindex && id->numsegments >= MSTL_SEGINDEX_MIN)
+        segindex = mstl_segindex (id, 1);
+
+      if (segindex)
+      {
+        mstl_segsearch (segindex, msr, endtime, hpdelta, hptimetol, sampratetol,
+                        autoheal, &segbefore, &segafter, &followseg);
+        searchseg = 0;
+      }
+
       while (searchseg)
       {
         if (msr->starttime > searchseg->starttime)
@@ -453,6 +513,9 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
       /* Add MSRecord coverage to end of segment before */
       if (segbefore)
       {
+        if (segindex)
+          mstl_segremove (segindex, segbefore);
+
         if (!mstl_addmsrtoseg (segbefore, msr, endtime, 1))
         {
           return 0;
@@ -467,6 +530,9 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
             return 0;
           }
 
+          if (segindex)
+            mstl_segremove (segindex, segafter);
+
           /* Shift last segment pointer if it's going to be removed */
           if (segafter == id->last)
             id->last = id->last->prev;
@@ -484,7 +550,8 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
           if (segafter->prvtptr)
             free (segafter->prvtptr);
 
-          free (segafter);
+          mstl_release (mstl, segafter);
+          id->numsegments--;
         }
 
         seg = segbefore;
@@ -492,6 +559,9 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
       /* Add MSRecord coverage to beginning of segment after */
       else if (segafter)
       {
+        if (segindex)
+          mstl_segremove (segindex, segafter);
+
         if (!mstl_addmsrtoseg (segafter, msr, endtime, 2))
         {
           return 0;
@@ -503,7 +573,7 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
       else
       {
         /* Create new segment */
-        if (!(seg = mstl_msr2seg (msr, endtime)))
+        if (!(seg = mstl_msr2seg (mstl, msr, endtime)))
         {
           return 0;
         }
@@ -592,26 +662,642 @@ mstl_addmsr (MSTraceList *mstl, MSRecord *msr, flag dataquality,
       id->last = segbefore;
   }
 
+  /* Add modified segment to index in its new place */
+  if (segindex && mstl_seginsert (segindex, seg))
+    mstl_freesegindex (&id->index);
+
   /* Set MSTraceID as last accessed */
   mstl->last = id;
 
   return seg;
 } /* End of mstl_addmsr() */
 
+/***************************************************************************
+ * mstl_buildindex:
+ *
+ * Create an index of the trace IDs in a MSTraceList.  The trace ID
+ * list must be in ascending source name order.
+ *
+ * Return a pointer to a MSTraceIndex otherwise 0 on error.
+ ***************************************************************************/
+static MSTraceIndex *
+mstl_buildindex (MSTraceList *mstl)
+{
+  MSTraceIndex *index;
+  MSTraceID *id;
+
+  if (!(index = (MSTraceIndex *)calloc (1, sizeof (MSTraceIndex))))
+  {
+    ms_log (2, "mstl_addmsr(): Error allocating memory\n");
+    return 0;
+  }
+
+  for (id = mstl->traces; id; id = id->next)
+  {
+    if (mstl_indexid (index, id, mstl_hashsrcname (id->srcname), index->count))
+    {
+      mstl_freeindex (&index);
+      return 0;
+    }
+  }
+
+  mstl->numtraces = index->count;
+
+  return index;
+} /* End of mstl_buildindex() */
+
+/***************************************************************************
+ * mstl_freeindex:
+ *
+ * Free an index of trace IDs and set the pointer to 0.
+ ***************************************************************************/
+static void
+mstl_freeindex (MSTraceIndex **ppindex)
+{
+  if (!ppindex || !*ppindex)
+    return;
+
+  if ((*ppindex)->table)
+    free ((*ppindex)->table);
+
+  if ((*ppindex)->hashes)
+    free ((*ppindex)->hashes);
+
+  if ((*ppindex)->sorted)
+    free ((*ppindex)->sorted);
+
+  free (*ppindex);
+  *ppindex = NULL;
+} /* End of mstl_freeindex() */
+
+/***************************************************************************
+ * mstl_hashsrcname:
+ *
+ * Return the 32-bit FNV-1a hash of a source name.
+ ***************************************************************************/
+static uint32_t
+mstl_hashsrcname (const char *srcname)
+{
+  uint32_t hash = 2166136261u;
+
+  while (*srcname)
+  {
+    hash ^= (uint8_t)*srcname++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+} /* End of mstl_hashsrcname() */
+
+/***************************************************************************
+ * mstl_findid:
+ *
+ * Search the hash table of an index for the trace ID with a source
+ * name.
+ *
+ * Return a pointer to the MSTraceID if found otherwise 0.
+ ***************************************************************************/
+static MSTraceID *
+mstl_findid (MSTraceIndex *index, const char *srcname, uint32_t hash)
+{
+  uint32_t mask;
+  uint32_t slot;
+
+  if (!index->tablesize)
+    return 0;
+
+  mask = (uint32_t)index->tablesize - 1;
+
+  for (slot = hash & mask; index->table[slot]; slot = (slot + 1) & mask)
+  {
+    if (index->hashes[slot] == hash && !strcmp (index->table[slot]->srcname, srcname))
+      return index->table[slot];
+  }
+
+  return 0;
+} /* End of mstl_findid() */
+
+/***************************************************************************
+ * mstl_precedingid:
+ *
+ * Search the sorted array of an index for the last trace ID with a
+ * source name less than srcname.  The position in the sorted array
+ * where an ID with srcname belongs is returned in position.
+ *
+ * Return a pointer to the preceding MSTraceID or 0 if there is none.
+ ***************************************************************************/
+static MSTraceID *
+mstl_precedingid (MSTraceIndex *index, const char *srcname, int32_t *position)
+{
+  int32_t low  = 0;
+  int32_t high = index->count;
+  int32_t mid;
+
+  /* Most IDs are added in order, check the end first */
+  if (high > 0 && strcmp (index->sorted[high - 1]->srcname, srcname) < 0)
+    low = high;
+
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
+
+    if (strcmp (index->sorted[mid]->srcname, srcname) < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  *position = low;
+
+  return (low > 0) ? index->sorted[low - 1] : 0;
+} /* End of mstl_precedingid() */
+
+/***************************************************************************
+ * mstl_indexid:
+ *
+ * Add a trace ID to an index, in the hash table and at position in
+ * the sorted array.  The tables are grown as needed, the hash table is
+ * kept at most half full.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mstl_indexid (MSTraceIndex *index, MSTraceID *id, uint32_t hash, int32_t position)
+{
+  MSTraceID **table;
+  MSTraceID **sorted;
+  uint32_t *hashes;
+  uint32_t mask;
+  uint32_t slot;
+  int32_t tablesize;
+  int32_t idx;
+
+  /* Grow hash table and rehash entries */
+  if ((index->count + 1) * 2 > index->tablesize)
+  {
+    tablesize = (index->tablesize) ? index->tablesize * 2 : 64;
+
+    table  = (MSTraceID **)calloc (tablesize, sizeof (MSTraceID *));
+    hashes = (uint32_t *)malloc (tablesize * sizeof (uint32_t));
+
+    if (!table || !hashes)
+    {
+      ms_log (2, "mstl_addmsr(): Error allocating memory\n");
+      free (table);
+      free (hashes);
+      return -1;
+    }
+
+    mask = (uint32_t)tablesize - 1;
+
+    for (idx = 0; idx < index->tablesize; idx++)
+    {
+      if (!index->table[idx])
+        continue;
+
+      for (slot = index->hashes[idx] & mask; table[slot]; slot = (slot + 1) & mask)
+        ;
+
+      table[slot]  = index->table[idx];
+      hashes[slot] = index->hashes[idx];
+    }
+
+    free (index->table);
+    free (index->hashes);
+
+    index->table     = table;
+    index->hashes    = hashes;
+    index->tablesize = tablesize;
+  }
+
+  /* Grow sorted array */
+  if (index->count >= index->sortedsize)
+  {
+    idx = (index->sortedsize) ? index->sortedsize * 2 : 32;
+
+    if (!(sorted = (MSTraceID **)realloc (index->sorted, idx * sizeof (MSTraceID *))))
+    {
+      ms_log (2, "mstl_addmsr(): Error allocating memory\n");
+      return -1;
+    }
+
+    index->sorted     = sorted;
+    index->sortedsize = idx;
+  }
+
+  mask = (uint32_t)index->tablesize - 1;
+
+  for (slot = hash & mask; index->table[slot]; slot = (slot + 1) & mask)
+    ;
+
+  index->table[slot]  = id;
+  index->hashes[slot] = hash;
+
+  if (position < index->count)
+    memmove (&index->sorted[position + 1], &index->sorted[position],
+             (index->count - position) * sizeof (MSTraceID *));
+
+  index->sorted[position] = id;
+  index->count++;
+
+  return 0;
+} /* End of mstl_indexid() */
+
+/***************************************************************************
+ * mstl_segindex:
+ *
+ * Return the segment index of a trace ID if it matches the segment
+ * list, an index that does not match is freed.  If the build flag is
+ * true a missing index is created.
+ *
+ * Return a pointer to a MSTraceSegIndex otherwise 0.
+ ***************************************************************************/
+static MSTraceSegIndex *
+mstl_segindex (MSTraceID *id, flag build)
+{
+  MSTraceSegIndex *index = id->index;
+  MSTraceSeg *seg;
+  int32_t size;
+
+  if (index)
+  {
+    if (index->count == id->numsegments && index->count > 0 &&
+        index->bystart[0].seg == id->first &&
+        index->bystart[index->count - 1].seg == id->last)
+      return index;
+
+    mstl_freesegindex (&id->index);
+  }
+
+  if (!build)
+    return 0;
+
+  if (!(index = (MSTraceSegIndex *)calloc (1, sizeof (MSTraceSegIndex))))
+  {
+    ms_log (2, "mstl_addmsr(): Error allocating memory\n");
+    return 0;
+  }
+
+  id->index = index;
+
+  for (size = 64; size < id->numsegments * 2; size *= 2)
+    ;
+
+  index->bystart = (MSTraceSegRef *)malloc (size * sizeof (MSTraceSegRef));
+  index->byend   = (MSTraceSegRef *)malloc (size * sizeof (MSTraceSegRef));
+  index->matches = (int32_t *)malloc (size * sizeof (int32_t));
+  index->size    = size;
+
+  if (!index->bystart || !index->byend || !index->matches)
+  {
+    ms_log (2, "mstl_addmsr(): Error allocating memory\n");
+    mstl_freesegindex (&id->index);
+    return 0;
+  }
+
+  for (seg = id->first; seg; seg = seg->next)
+  {
+    if (mstl_seginsert (index, seg))
+    {
+      mstl_freesegindex (&id->index);
+      return 0;
+    }
+  }
+
+  return index;
+} /* End of mstl_segindex() */
+
+/***************************************************************************
+ * mstl_freesegindex:
+ *
+ * Free a segment index and set the pointer to 0.
+ ***************************************************************************/
+static void
+mstl_freesegindex (MSTraceSegIndex **ppindex)
+{
+  if (!ppindex || !*ppindex)
+    return;
+
+  if ((*ppindex)->bystart)
+    free ((*ppindex)->bystart);
+
+  if ((*ppindex)->byend)
+    free ((*ppindex)->byend);
+
+  if ((*ppindex)->matches)
+    free ((*ppindex)->matches);
+
+  free (*ppindex);
+  *ppindex = NULL;
+} /* End of mstl_freesegindex() */
+
+/***************************************************************************
+ * mstl_segbound:
+ *
+ * Return the position of the first reference with a start time, or
+ * end time if the end flag is true, not less than the specified time,
+ * or count if there is none.
+ ***************************************************************************/
+static int32_t
+mstl_segbound (MSTraceSegRef *refs, int32_t count, hptime_t time, flag end)
+{
+  int32_t low  = 0;
+  int32_t high = count;
+  int32_t mid;
+
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
+
+    if (((end) ? refs[mid].endtime : refs[mid].starttime) < time)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+} /* End of mstl_segbound() */
+
+/***************************************************************************
+ * mstl_segposition:
+ *
+ * Find the list position of an indexed segment, the times of the
+ * segment must not have changed since it was indexed.
+ *
+ * Return the position of the segment otherwise -1.
+ ***************************************************************************/
+static int32_t
+mstl_segposition (MSTraceSegIndex *index, MSTraceSeg *seg)
+{
+  MSTraceSegRef *refs = index->bystart;
+  int32_t pos;
+
+  for (pos = mstl_segbound (refs, index->count, seg->starttime, 0);
+       pos < index->count && refs[pos].starttime == seg->starttime; pos++)
+  {
+    if (refs[pos].seg == seg)
+      return pos;
+
+    /* Segments with the same start time are in descending end time order */
+    if (refs[pos].endtime < seg->endtime)
+      break;
+  }
+
+  return -1;
+} /* End of mstl_segposition() */
+
+/***************************************************************************
+ * mstl_segremove:
+ *
+ * Remove a segment from an index, the times of the segment must not
+ * have changed since it was indexed.
+ ***************************************************************************/
+static void
+mstl_segremove (MSTraceSegIndex *index, MSTraceSeg *seg)
+{
+  MSTraceSegRef *refs;
+  int32_t pos;
+
+  if ((pos = mstl_segposition (index, seg)) < 0)
+    return;
+
+  refs = index->bystart;
+  memmove (&refs[pos], &refs[pos + 1], (index->count - pos - 1) * sizeof (MSTraceSegRef));
+
+  refs = index->byend;
+  for (pos = mstl_segbound (refs, index->count, seg->endtime, 1);
+       pos < index->count && refs[pos].seg != seg; pos++)
+    ;
+
+  if (pos < index->count)
+    memmove (&refs[pos], &refs[pos + 1], (index->count - pos - 1) * sizeof (MSTraceSegRef));
+
+  index->count--;
+} /* End of mstl_segremove() */
+
+/***************************************************************************
+ * mstl_seginsert:
+ *
+ * Add a segment to an index, in list order following the segment
+ * before it in the list, which must be indexed, and in end time order.
+ * The arrays are grown as needed.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mstl_seginsert (MSTraceSegIndex *index, MSTraceSeg *seg)
+{
+  MSTraceSegRef ref;
+  void *newarray;
+  int32_t size;
+  int32_t pos;
+
+  if (index->count >= index->size)
+  {
+    size = index->size * 2;
+
+    if (!(newarray = realloc (index->bystart, size * sizeof (MSTraceSegRef))))
+      goto error;
+    index->bystart = (MSTraceSegRef *)newarray;
+
+    if (!(newarray = realloc (index->byend, size * sizeof (MSTraceSegRef))))
+      goto error;
+    index->byend = (MSTraceSegRef *)newarray;
+
+    if (!(newarray = realloc (index->matches, size * sizeof (int32_t))))
+      goto error;
+    index->matches = (int32_t *)newarray;
+
+    index->size = size;
+  }
+
+  ref.seg       = seg;
+  ref.starttime = seg->starttime;
+  ref.endtime   = seg->endtime;
+
+  /* Most segments follow the last indexed segment */
+  if (!seg->prev)
+    pos = 0;
+  else if (index->count > 0 && index->bystart[index->count - 1].seg == seg->prev)
+    pos = index->count;
+  else if ((pos = mstl_segposition (index, seg->prev)) < 0)
+    return -1;
+  else
+    pos++;
+
+  memmove (&index->bystart[pos + 1], &index->bystart[pos], (index->count - pos) * sizeof (MSTraceSegRef));
+  index->bystart[pos] = ref;
+
+  pos = mstl_segbound (index->byend, index->count, seg->endtime + 1, 1);
+
+  memmove (&index->byend[pos + 1], &index->byend[pos], (index->count - pos) * sizeof (MSTraceSegRef));
+  index->byend[pos] = ref;
+
+  index->count++;
+
+  return 0;
+
+error:
+  ms_log (2, "mstl_addmsr(): Error allocating memory\n");
+  return -1;
+} /* End of mstl_seginsert() */
+
+/***************************************************************************
+ * mstl_segsearch:
+ *
+ * Search a segment index for the segments that a record fits before
+ * and after and the segment that the record follows in time order,
+ * the equivalent of searching the complete segment list.  Segments
+ * ending or starting within the time tolerance of the record are
+ * found with a binary search and then checked in list order.
+ ***************************************************************************/
+static void
+mstl_segsearch (MSTraceSegIndex *index, MSRecord *msr, hptime_t endtime,
+                hptime_t hpdelta, hptime_t hptimetol, double sampratetol,
+                flag autoheal, MSTraceSeg **segbefore, MSTraceSeg **segafter,
+                MSTraceSeg **followseg)
+{
+  MSTraceSeg *seg;
+  hptime_t postgap;
+  hptime_t pregap;
+  hptime_t nhptimetol = (hptimetol) ? -hptimetol : 0;
+  int32_t nmatches = 0;
+  int32_t first;
+  int32_t pos;
+  int32_t idx;
+  flag whence;
+
+  /* Last segment starting before the record */
+  idx        = mstl_segbound (index->bystart, index->count, msr->starttime, 0);
+  *followseg = (idx > 0) ? index->bystart[idx - 1].seg : 0;
+
+  /* Segments starting after the record end, in list order */
+  for (idx = mstl_segbound (index->bystart, index->count, endtime + hpdelta + nhptimetol, 0);
+       idx < index->count && index->bystart[idx].starttime <= endtime + hpdelta + hptimetol; idx++)
+    index->matches[nmatches++] = idx;
+
+  first = nmatches;
+
+  /* Segments ending before the record start, not already found */
+  for (idx = mstl_segbound (index->byend, index->count, msr->starttime - hpdelta - hptimetol, 1);
+       idx < index->count && index->byend[idx].endtime <= msr->starttime - hpdelta - nhptimetol; idx++)
+  {
+    seg    = index->byend[idx].seg;
+    pregap = seg->starttime - endtime - hpdelta;
+
+    if (pregap <= hptimetol && pregap >= nhptimetol)
+      continue;
+
+    if ((pos = mstl_segposition (index, seg)) >= 0)
+      index->matches[nmatches++] = pos;
+  }
+
+  if (nmatches > first)
+    qsort (index->matches, nmatches, sizeof (int32_t), mstl_segcmppos);
+
+  *segbefore = 0;
+  *segafter  = 0;
+
+  for (idx = 0; idx < nmatches; idx++)
+  {
+    seg    = index->bystart[index->matches[idx]].seg;
+    whence = 0;
+
+    postgap = msr->starttime - seg->endtime - hpdelta;
+    if (!*segbefore && postgap <= hptimetol && postgap >= nhptimetol)
+      whence = 1;
+
+    pregap = seg->starttime - endtime - hpdelta;
+    if (!*segafter && pregap <= hptimetol && pregap >= nhptimetol)
+      whence = 2;
+
+    if (!whence)
+      continue;
+
+    if (sampratetol == -1.0)
+    {
+      if (!MS_ISRATETOLERABLE (msr->samprate, seg->samprate))
+        continue;
+    }
+    else if (ms_dabs (msr->samprate - seg->samprate) > sampratetol)
+    {
+      continue;
+    }
+
+    if (whence == 1)
+      *segbefore = seg;
+    else
+      *segafter = seg;
+
+    /* Done searching if not autohealing */
+    if (!autoheal)
+      break;
+
+    /* Done searching if both before and after segments are found */
+    if (*segbefore && *segafter)
+      break;
+  }
+} /* End of mstl_segsearch() */
+
+/***************************************************************************
+ * mstl_segcmppos:
+ *
+ * Compare two list positions, used with qsort() by mstl_segsearch().
+ ***************************************************************************/
+static int
+mstl_segcmppos (const void *pos1, const void *pos2)
+{
+  int32_t p1 = *(const int32_t *)pos1;
+  int32_t p2 = *(const int32_t *)pos2;
+
+  return (p1 < p2) ? -1 : (p1 > p2) ? 1 : 0;
+} /* End of mstl_segcmppos() */
+
+/***************************************************************************
+ * mstl_alloc:
+ *
+ * Allocate zeroed memory for a structure of a MSTraceList, from the
+ * arena of the list if present otherwise from the heap.
+ *
+ * Return a pointer to the memory otherwise 0 on error.
+ ***************************************************************************/
+static void *
+mstl_alloc (MSTraceList *mstl, size_t size)
+{
+  if (mstl->arena)
+    return ms_arena_alloc (mstl->arena, size);
+
+  return calloc (1, size);
+} /* End of mstl_alloc() */
+
+/***************************************************************************
+ * mstl_release:
+ *
+ * Release memory of a structure of a MSTraceList, memory allocated from
+ * the arena of the list is released when the arena is freed.
+ ***************************************************************************/
+static void
+mstl_release (MSTraceList *mstl, void *ptr)
+{
+  if (ptr && !ms_arena_contains (mstl->arena, ptr))
+    free (ptr);
+} /* End of mstl_release() */
+
 /***************************************************************************
  * mstl_msr2seg:
  *
- * Create an MSTraceSeg structure from an MSRecord structure.
+ * Create an MSTraceSeg structure from an MSRecord structure, the
+ * structure is allocated with mstl_alloc().
  *
  * Return a pointer to a MSTraceSeg otherwise 0 on error.
  ***************************************************************************/
 MSTraceSeg *
-mstl_msr2seg (MSRecord *msr, hptime_t endtime)
+mstl_msr2seg (MSTraceList *mstl, MSRecord *msr, hptime_t endtime)
 {
   MSTraceSeg *seg = 0;
   int samplesize;
 
-  if (!(seg = (MSTraceSeg *)calloc (1, sizeof (MSTraceSeg))))
+  if (!(seg = (MSTraceSeg *)mstl_alloc (mstl, sizeof (MSTraceSeg))))
   {
     ms_log (2, "mstl_addmsr(): Error allocating memory\n");
     return 0;
@@ -633,6 +1319,7 @@ mstl_msr2seg (MSRecord *msr, hptime_t endtime)
     if (!(seg->datasamples = malloc ((size_t) (samplesize * msr->numsamples))))
     {
       ms_log (2, "mstl_msr2seg(): Error allocating memory\n");
+      mstl_release (mstl, seg);
       return 0;
     }
 
@@ -5,7 +5,7 @@
  *
  * Written by Chad Trabant, IRIS Data Management Center
  *
- * modified: 2015.108
+ * modified: 2026.289
  ***************************************************************************/
 
 #include <stdio.h>
@@ -17,6 +17,77 @@
 
 static int mst_groupsort_cmp (MSTrace *mst1, MSTrace *mst2, flag quality);
 
+/* Reference to a trace of a channel in a trace group index */
+typedef struct MSTraceRef_s
+{
+  MSTrace *mst;            /* Indexed trace */
+  hptime_t time;           /* Start or end time of trace when indexed */
+  int32_t seq;             /* Order of trace in the trace chain */
+} MSTraceRef;
+
+/* Traces of a channel in a trace group index */
+typedef struct MSTraceChan_s
+{
+  char srcname[45];        /* Source name without quality */
+  uint32_t hash;           /* Hash of source name */
+  MSTraceRef *bystart;     /* Traces ordered by start time */
+  MSTraceRef *byend;       /* Traces ordered by end time */
+  int32_t count;           /* Number of traces */
+  int32_t size;            /* Allocated length of reference arrays */
+} MSTraceChan;
+
+/* Index of a MSTraceGroup.  The last trace of the chain is always
+ * tracked, traces are only indexed by channel and time when enabled
+ * with mst_groupindex().  The index is rebuilt when the head of the
+ * chain or the trace count no longer match. */
+typedef struct MSTraceGroupIndex_s
+{
+  MSTrace *head;           /* First trace of chain when indexed */
+  MSTrace *tail;           /* Last trace of chain */
+  int32_t numtraces;       /* Number of traces when indexed, -1 if invalid */
+  int32_t nextseq;         /* Chain order of next trace added */
+  flag enabled;            /* Flag to index traces by channel */
+  MSTraceChan **table;     /* Hash table of channels */
+  int32_t tablesize;       /* Size of hash table, a power of 2 */
+  int32_t numchans;        /* Number of channels */
+} MSTraceGroupIndex;
+
+static MSTraceGroupIndex *mstg_index (MSTraceGroup *mstg);
+static void mstg_clearindex (MSTraceGroupIndex *index);
+static void mstg_freeindex (MSTraceGroupIndex **ppindex);
+static void mstg_linktrace (MSTraceGroup *mstg, MSTrace *mst);
+static void mstg_freetrace (MSTraceGroup *mstg, MSTrace **ppmst);
+static MSTraceChan *mstg_findchan (MSTraceGroupIndex *index, char *network, char *station,
+                                   char *location, char *channel, flag add);
+static int mstg_indextrace (MSTraceGroupIndex *index, MSTrace *mst);
+static void mstg_updatetrace (MSTraceGroup *mstg, MSTrace *mst,
+                              hptime_t starttime, hptime_t endtime);
+static int32_t mstg_lowerbound (MSTraceRef *refs, int32_t count, hptime_t time);
+static void mstg_moveref (MSTraceRef *refs, int32_t count, MSTrace *mst,
+                          hptime_t oldtime, hptime_t newtime);
+static MSTrace *mstg_findadjacent (MSTraceChan *chan, flag *whence, char dataquality,
+                                   double samprate, double sampratetol,
+                                   hptime_t starttime, hptime_t endtime, double timetol);
+
+/* State of a trace while healing a MSTraceGroup */
+typedef struct MSTraceHeal_s
+{
+  MSTrace *mst;            /* Trace, NULL when merged with another trace */
+  int32_t prev;            /* Chain order of previous trace, -1 if first */
+  int32_t next;            /* Chain order of next trace, -1 if last */
+  int32_t first;           /* First reference of the channel of the trace */
+  int32_t last;            /* End of references of the channel of the trace */
+  size_t capacity;         /* Allocated size of sample buffer */
+} MSTraceHeal;
+
+static int mstg_healcmp (const void *ref1, const void *ref2);
+static int mstg_healcmpchan (MSTrace *mst1, MSTrace *mst2);
+static int mstg_healrate (MSTrace *mst, MSTrace *curmst, double sampratetol);
+static int32_t mstg_healfind (MSTraceHeal *heal, MSTraceRef *bystart, MSTraceRef *byend,
+                              MSTraceHeal *cur, int32_t after, double delta,
+                              double timetol, double sampratetol);
+static int mstg_healmerge (MSTraceHeal *cur, MSTrace *mst, flag whence);
+
 /***************************************************************************
  * mst_init:
  *
@@ -38,7 +109,7 @@ mst_init (MSTrace *mst)
       free (mst->prvtptr);
 
     if (mst->ststate)
-      free (mst->ststate);
+      msr_free_ststate (&mst->ststate);
   }
   else
   {
@@ -77,7 +148,7 @@ mst_free (MSTrace **ppmst)
 
     /* Free stream processing state if present */
     if ((*ppmst)->ststate)
-      free ((*ppmst)->ststate);
+      msr_free_ststate (&(*ppmst)->ststate);
 
     free (*ppmst);
 
@@ -90,15 +161,16 @@ mst_free (MSTrace **ppmst)
  *
  * Initialize and return a MSTraceGroup struct, allocating memory if
  * needed.  If the supplied MSTraceGroup is not NULL any associated
- * memory it will be freed.
+ * memory it will be freed, an arena is reset and retained for reuse.
  *
  * Returns a pointer to a MSTraceGroup struct on success or NULL on error.
  ***************************************************************************/
 MSTraceGroup *
 mst_initgroup (MSTraceGroup *mstg)
 {
-  MSTrace *mst  = 0;
-  MSTrace *next = 0;
+  MSTrace *mst   = 0;
+  MSTrace *next  = 0;
+  MSArena *arena = 0;
 
   if (mstg)
   {
@@ -107,9 +179,14 @@ mst_initgroup (MSTraceGroup *mstg)
     while (mst)
     {
       next = mst->next;
-      mst_free (&mst);
+      mstg_freetrace (mstg, &mst);
       mst = next;
     }
+
+    mstg_freeindex (&mstg->index);
+
+    arena = mstg->arena;
+    ms_arena_reset (arena);
   }
   else
   {
@@ -124,6 +201,8 @@ mst_initgroup (MSTraceGroup *mstg)
 
   memset (mstg, 0, sizeof (MSTraceGroup));
 
+  mstg->arena = arena;
+
   return mstg;
 } /* End of mst_initgroup() */
 
@@ -146,10 +225,14 @@ mst_freegroup (MSTraceGroup **ppmstg)
     while (mst)
     {
       next = mst->next;
-      mst_free (&mst);
+      mstg_freetrace (*ppmstg, &mst);
       mst = next;
     }
 
+    mstg_freeindex (&(*ppmstg)->index);
+
+    ms_arena_free (&(*ppmstg)->arena);
+
     free (*ppmstg);
 
     *ppmstg = 0;
@@ -271,6 +354,8 @@ mst_findadjacent (MSTraceGroup *mstg, flag *whence, char dataquality,
                   double samprate, double sampratetol,
                   hptime_t starttime, hptime_t endtime, double timetol)
 {
+  MSTraceGroupIndex *index;
+  MSTraceChan *chan;
   MSTrace *mst = 0;
   hptime_t pregap;
   hptime_t postgap;
@@ -295,6 +380,16 @@ mst_findadjacent (MSTraceGroup *mstg, flag *whence, char dataquality,
 
   nhptimetol = (hptimetol) ? -hptimetol : 0;
 
+  /* Search the traces of the channel if indexed */
+  if (mstg->index && mstg->index->enabled && (index = mstg_index (mstg)))
+  {
+    if (!(chan = mstg_findchan (index, network, station, location, channel, 0)))
+      return 0;
+
+    return mstg_findadjacent (chan, whence, dataquality, samprate, sampratetol,
+                              starttime, endtime, timetol);
+  }
+
   mst = mstg->traces;
 
   while (mst)
@@ -641,6 +736,7 @@ mst_addmsrtogroup (MSTraceGroup *mstg, MSRecord *msr, flag dataquality,
                    double timetol, double sampratetol)
 {
   MSTrace *mst = 0;
+  hptime_t starttime;
   hptime_t endtime;
   flag whence;
   char dq;
@@ -672,14 +768,23 @@ mst_addmsrtogroup (MSTraceGroup *mstg, MSRecord *msr, flag dataquality,
     if (msr->samplecnt <= 0 || msr->samprate <= 0.0)
       return mst;
 
+    starttime = mst->starttime;
+    endtime   = mst->endtime;
+
     if (mst_addmsr (mst, msr, whence))
     {
       return 0;
     }
+
+    mstg_updatetrace (mstg, mst, starttime, endtime);
   }
   else
   {
-    mst = mst_init (NULL);
+    /* Allocate from the arena of the group if present */
+    mst = mst_init ((mstg->arena) ? (MSTrace *)ms_arena_alloc (mstg->arena, sizeof (MSTrace)) : NULL);
+
+    if (!mst)
+      return 0;
 
     mst->dataquality = dq;
 
@@ -694,26 +799,12 @@ mst_addmsrtogroup (MSTraceGroup *mstg, MSRecord *msr, flag dataquality,
 
     if (mst_addmsr (mst, msr, 1))
     {
-      mst_free (&mst);
+      mstg_freetrace (mstg, &mst);
       return 0;
     }
 
     /* Link new MSTrace into the end of the chain */
-    if (!mstg->traces)
-    {
-      mstg->traces = mst;
-    }
-    else
-    {
-      MSTrace *lasttrace = mstg->traces;
-
-      while (lasttrace->next)
-        lasttrace = lasttrace->next;
-
-      lasttrace->next = mst;
-    }
-
-    mstg->numtraces++;
+    mstg_linktrace (mstg, mst);
   }
 
   return mst;
@@ -729,31 +820,64 @@ mst_addmsrtogroup (MSTraceGroup *mstg, MSRecord *msr, flag dataquality,
 MSTrace *
 mst_addtracetogroup (MSTraceGroup *mstg, MSTrace *mst)
 {
-  MSTrace *lasttrace;
-
   if (!mstg || !mst)
     return 0;
 
-  if (!mstg->traces)
-  {
-    mstg->traces = mst;
-  }
-  else
-  {
-    lasttrace = mstg->traces;
+  mstg_linktrace (mstg, mst);
 
-    while (lasttrace->next)
-      lasttrace = lasttrace->next;
+  return mst;
+} /* End of mst_addtracetogroup() */
 
-    lasttrace->next = mst;
+/***************************************************************************
+ * mst_groupindex:
+ *
+ * Enable or disable indexing of the traces in a MSTraceGroup by
+ * channel and time.  When enabled mst_findadjacent(), and therefore
+ * mst_addmsrtogroup(), search only the traces of the matching channel
+ * for adjacent time coverage instead of every trace in the group.
+ *
+ * While indexing is enabled traces in the group must only be extended
+ * using mst_addmsrtogroup(), the index does not track changes made to
+ * the traces by other means.  Traces may be added or removed from the
+ * chain if the trace count is updated, which causes the index to be
+ * rebuilt.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+int
+mst_groupindex (MSTraceGroup *mstg, flag enable)
+{
+  if (!mstg)
+    return -1;
+
+  if (!enable)
+  {
+    if (mstg->index)
+    {
+      mstg_clearindex (mstg->index);
+      mstg->index->enabled = 0;
+    }
+
+    return 0;
   }
 
-  mst->next = 0;
+  if (!mstg->index)
+  {
+    if (!(mstg->index = (MSTraceGroupIndex *)calloc (1, sizeof (MSTraceGroupIndex))))
+    {
+      ms_log (2, "mst_groupindex(): Cannot allocate memory\n");
+      return -1;
+    }
+  }
 
-  mstg->numtraces++;
+  if (!mstg->index->enabled)
+  {
+    mstg->index->enabled   = 1;
+    mstg->index->numtraces = -1;
+  }
 
-  return mst;
-} /* End of mst_addtracetogroup() */
+  return (mstg_index (mstg)) ? 0 : -1;
+} /* End of mst_groupindex() */
 
 /***************************************************************************
  * mst_groupheal:
@@ -771,18 +895,36 @@ mst_addtracetogroup (MSTraceGroup *mstg, MSTrace *mst)
  * is -1.0 the default tolerance check of abs(1-sr1/sr2) < 0.0001 is
  * used (defined in libmseed.h).
  *
+ * Each trace, in chain order, absorbs the traces that fit at its end
+ * or beginning, in chain order.  The traces of each channel are
+ * ordered by start and end time once so only traces within the time
+ * tolerance are compared instead of every pair of traces.  Sample
+ * buffers grow geometrically while merging and are trimmed to size
+ * when healing is done.
+ *
  * Return number of trace mergings on success otherwise -1 on error.
  ***************************************************************************/
 int
 mst_groupheal (MSTraceGroup *mstg, double timetol, double sampratetol)
 {
-  int mergings         = 0;
-  MSTrace *curtrace    = 0;
-  MSTrace *nexttrace   = 0;
-  MSTrace *searchtrace = 0;
-  MSTrace *prevtrace   = 0;
-  int8_t merged        = 0;
-  double postgap, pregap, delta;
+  MSTraceHeal *heal   = 0;
+  MSTraceRef *bystart = 0;
+  MSTraceRef *byend   = 0;
+  MSTraceHeal *cur;
+  MSTraceHeal *search;
+  MSTrace *mst;
+  hptime_t oldtime;
+  int32_t count = 0;
+  int32_t first;
+  int32_t last;
+  int32_t seq;
+  int32_t found;
+  int32_t idx;
+  double delta;
+  double postgap;
+  flag whence;
+  int mergings = 0;
+  int retval   = -1;
 
   if (!mstg)
     return -1;
@@ -791,127 +933,169 @@ mst_groupheal (MSTraceGroup *mstg, double timetol, double sampratetol)
   if (mst_groupsort (mstg, 1))
     return -1;
 
-  curtrace = mstg->traces;
+  for (mst = mstg->traces; mst; mst = mst->next)
+    count++;
 
-  while (curtrace)
-  {
-    nexttrace = mstg->traces;
-    prevtrace = mstg->traces;
+  if (count < 2)
+    return 0;
 
-    while (nexttrace)
-    {
-      searchtrace = nexttrace;
-      nexttrace   = searchtrace->next;
+  heal    = (MSTraceHeal *)malloc (count * sizeof (MSTraceHeal));
+  bystart = (MSTraceRef *)malloc (count * sizeof (MSTraceRef));
+  byend   = (MSTraceRef *)malloc (count * sizeof (MSTraceRef));
 
-      /* Do not process the same MSTrace we are trying to match */
-      if (searchtrace == curtrace)
-      {
-        prevtrace = searchtrace;
-        continue;
-      }
-
-      /* Check if this trace matches the curtrace */
-      if (strcmp (searchtrace->network, curtrace->network) ||
-          strcmp (searchtrace->station, curtrace->station) ||
-          strcmp (searchtrace->location, curtrace->location) ||
-          strcmp (searchtrace->channel, curtrace->channel))
-      {
-        prevtrace = searchtrace;
-        continue;
-      }
+  if (!heal || !bystart || !byend)
+  {
+    ms_log (2, "mst_groupheal(): Cannot allocate memory\n");
+    goto cleanup;
+  }
 
-      /* Perform default samprate tolerance check if requested */
-      if (sampratetol == -1.0)
-      {
-        if (!MS_ISRATETOLERABLE (searchtrace->samprate, curtrace->samprate))
-        {
-          prevtrace = searchtrace;
-          continue;
-        }
-      }
-      /* Otherwise check against the specified sample rates tolerance */
-      else if (ms_dabs (searchtrace->samprate - curtrace->samprate) > sampratetol)
-      {
-        prevtrace = searchtrace;
-        continue;
-      }
+  for (seq = 0, mst = mstg->traces; mst; seq++, mst = mst->next)
+  {
+    heal[seq].mst      = mst;
+    heal[seq].prev     = seq - 1;
+    heal[seq].next     = (mst->next) ? seq + 1 : -1;
+    heal[seq].capacity = (mst->datasamples && mst->numsamples > 0) ?
+                         (size_t) (mst->numsamples * ms_samplesize (mst->sampletype)) : 0;
+
+    bystart[seq].mst  = mst;
+    bystart[seq].time = mst->starttime;
+    bystart[seq].seq  = seq;
+
+    byend[seq].mst  = mst;
+    byend[seq].time = mst->endtime;
+    byend[seq].seq  = seq;
+  }
 
-      merged = 0;
+  /* Order references by channel and time */
+  qsort (bystart, count, sizeof (MSTraceRef), mstg_healcmp);
+  qsort (byend, count, sizeof (MSTraceRef), mstg_healcmp);
 
-      /* post/pregap are negative when searchtrace overlaps curtrace
-         segment and positive when there is a time gap. */
-      delta = (curtrace->samprate) ? (1.0 / curtrace->samprate) : 0.0;
+  /* Determine the range of references of each channel */
+  for (first = 0; first < count; first = last)
+  {
+    for (last = first + 1; last < count; last++)
+      if (mstg_healcmpchan (bystart[first].mst, bystart[last].mst))
+        break;
 
-      postgap = ((double)(searchtrace->starttime - curtrace->endtime) / HPTMODULUS) - delta;
+    for (idx = first; idx < last; idx++)
+    {
+      heal[bystart[idx].seq].first = first;
+      heal[bystart[idx].seq].last  = last;
+    }
+  }
 
-      pregap = ((double)(curtrace->starttime - searchtrace->endtime) / HPTMODULUS) - delta;
+  /* Default time tolerance is 1/2 sample period of the first trace,
+   * in chain order, with another trace of the same channel with a
+   * tolerable sample rate */
+  for (seq = 0; seq < count && timetol == -1.0; seq++)
+  {
+    cur = &heal[seq];
 
-      /* Calculate default time tolerance (1/2 sample period) if needed */
-      if (timetol == -1.0)
+    for (idx = cur->first; idx < cur->last; idx++)
+    {
+      if (bystart[idx].seq != seq &&
+          mstg_healrate (bystart[idx].mst, cur->mst, sampratetol))
+      {
+        delta   = (cur->mst->samprate) ? (1.0 / cur->mst->samprate) : 0.0;
         timetol = 0.5 * delta;
+        break;
+      }
+    }
+  }
 
-      /* Fits right at the end of curtrace */
-      if (ms_dabs (postgap) <= timetol)
-      {
-        /* Merge searchtrace with curtrace */
-        mst_addspan (curtrace, searchtrace->starttime, searchtrace->endtime,
-                     searchtrace->datasamples, searchtrace->numsamples,
-                     searchtrace->sampletype, 1);
+  /* No traces can be merged with a negative tolerance */
+  if (!(timetol >= 0.0))
+  {
+    retval = 0;
+    goto cleanup;
+  }
 
-        /* If no data is present, make sure sample count is updated */
-        if (searchtrace->numsamples <= 0)
-          curtrace->samplecnt += searchtrace->samplecnt;
+  for (seq = 0; seq < count; seq++)
+  {
+    cur = &heal[seq];
 
-        /* If qualities do not match reset the indicator */
-        if (curtrace->dataquality != searchtrace->dataquality)
-          curtrace->dataquality = 0;
+    if (!cur->mst)
+      continue;
 
-        merged = 1;
-      }
+    delta = (cur->mst->samprate) ? (1.0 / cur->mst->samprate) : 0.0;
 
-      /* Fits right at the beginning of curtrace */
-      else if (ms_dabs (pregap) <= timetol)
-      {
-        /* Merge searchtrace with curtrace */
-        mst_addspan (curtrace, searchtrace->starttime, searchtrace->endtime,
-                     searchtrace->datasamples, searchtrace->numsamples,
-                     searchtrace->sampletype, 2);
+    /* Traces are merged in chain order following the last merged trace */
+    found = -1;
 
-        /* If no data is present, make sure sample count is updated */
-        if (searchtrace->numsamples <= 0)
-          curtrace->samplecnt += searchtrace->samplecnt;
+    while ((found = mstg_healfind (heal, bystart, byend, cur, found,
+                                   delta, timetol, sampratetol)) >= 0)
+    {
+      search = &heal[found];
 
-        /* If qualities do not match reset the indicator */
-        if (curtrace->dataquality != searchtrace->dataquality)
-          curtrace->dataquality = 0;
+      postgap = ((double)(search->mst->starttime - cur->mst->endtime) / HPTMODULUS) - delta;
 
-        merged = 1;
-      }
+      /* Fits right at the end of curtrace, otherwise at the beginning */
+      whence  = (ms_dabs (postgap) <= timetol) ? 1 : 2;
+      oldtime = (whence == 1) ? cur->mst->endtime : cur->mst->starttime;
 
-      /* If searchtrace was merged with curtrace remove it from the chain */
-      if (merged)
-      {
-        /* Re-link trace chain and free searchtrace */
-        if (searchtrace == mstg->traces)
-          mstg->traces = nexttrace;
-        else
-          prevtrace->next = nexttrace;
+      if (mstg_healmerge (cur, search->mst, whence))
+        goto cleanup;
+
+      /* Keep the references of the merged trace in time order */
+      if (whence == 1)
+        mstg_moveref (byend + cur->first, cur->last - cur->first,
+                      cur->mst, oldtime, cur->mst->endtime);
+      else
+        mstg_moveref (bystart + cur->first, cur->last - cur->first,
+                      cur->mst, oldtime, cur->mst->starttime);
 
-        mst_free (&searchtrace);
+      /* If qualities do not match reset the indicator */
+      if (cur->mst->dataquality != search->mst->dataquality)
+        cur->mst->dataquality = 0;
 
-        mstg->numtraces--;
-        mergings++;
+      /* Re-link trace chain and free searchtrace */
+      if (search->prev >= 0)
+      {
+        heal[search->prev].mst->next = search->mst->next;
+        heal[search->prev].next      = search->next;
       }
       else
       {
-        prevtrace = searchtrace;
+        mstg->traces = search->mst->next;
       }
+
+      if (search->next >= 0)
+        heal[search->next].prev = search->prev;
+
+      mstg_freetrace (mstg, &search->mst);
+
+      mstg->numtraces--;
+      mergings++;
     }
+  }
+
+  retval = mergings;
+
+cleanup:
+  /* Trim sample buffers grown while merging */
+  for (seq = 0; heal && seq < count; seq++)
+  {
+    mst = heal[seq].mst;
 
-    curtrace = curtrace->next;
+    if (mst && mst->datasamples && mst->numsamples > 0 &&
+        heal[seq].capacity > (size_t) (mst->numsamples * ms_samplesize (mst->sampletype)))
+    {
+      void *datasamples = realloc (mst->datasamples,
+                                   (size_t) (mst->numsamples * ms_samplesize (mst->sampletype)));
+
+      if (datasamples)
+        mst->datasamples = datasamples;
+    }
   }
 
-  return mergings;
+  if (heal)
+    free (heal);
+  if (bystart)
+    free (bystart);
+  if (byend)
+    free (byend);
+
+  return retval;
 } /* End of mst_groupheal() */
 
 /***************************************************************************
@@ -1016,6 +1200,10 @@ mst_groupsort (MSTraceGroup *mstg, flag quality)
     {
       mstg->traces = top;
 
+      /* Chain order has changed, rebuild index when next used */
+      if (mstg->index)
+        mstg->index->numtraces = -1;
+
       return 0;
     }
 
@@ -1083,6 +1271,774 @@ mst_groupsort_cmp (MSTrace *mst1, MSTrace *mst2, flag quality)
   return 0;
 } /* End of mst_groupsort_cmp() */
 
+/***************************************************************************
+ * mstg_index:
+ *
+ * Return the index of a MSTraceGroup, creating it if needed.  If the
+ * index does not match the trace chain it is rebuilt.
+ *
+ * Return a pointer to the MSTraceGroupIndex on success or 0 on error.
+ ***************************************************************************/
+static MSTraceGroupIndex *
+mstg_index (MSTraceGroup *mstg)
+{
+  MSTraceGroupIndex *index = mstg->index;
+  MSTrace *mst;
+
+  if (!index)
+  {
+    if (!(index = (MSTraceGroupIndex *)calloc (1, sizeof (MSTraceGroupIndex))))
+    {
+      ms_log (2, "mstg_index(): Cannot allocate memory\n");
+      return 0;
+    }
+
+    index->numtraces = -1;
+    mstg->index      = index;
+  }
+
+  if (index->numtraces == mstg->numtraces && index->head == mstg->traces &&
+      ((index->tail) ? !index->tail->next : !mstg->traces))
+    return index;
+
+  /* Rebuild index from the trace chain */
+  mstg_clearindex (index);
+
+  index->head = mstg->traces;
+  index->tail = 0;
+
+  for (mst = mstg->traces; mst; mst = mst->next)
+  {
+    if (index->enabled && mstg_indextrace (index, mst))
+    {
+      mstg_clearindex (index);
+      return 0;
+    }
+
+    index->tail = mst;
+  }
+
+  index->numtraces = mstg->numtraces;
+
+  return index;
+} /* End of mstg_index() */
+
+/***************************************************************************
+ * mstg_clearindex:
+ *
+ * Free the channels of a MSTraceGroup index and mark it invalid.
+ ***************************************************************************/
+static void
+mstg_clearindex (MSTraceGroupIndex *index)
+{
+  int32_t idx;
+
+  for (idx = 0; idx < index->tablesize; idx++)
+  {
+    if (!index->table[idx])
+      continue;
+
+    free (index->table[idx]->bystart);
+    free (index->table[idx]->byend);
+    free (index->table[idx]);
+  }
+
+  if (index->table)
+    free (index->table);
+
+  index->table     = 0;
+  index->tablesize = 0;
+  index->numchans  = 0;
+  index->nextseq   = 0;
+  index->numtraces = -1;
+} /* End of mstg_clearindex() */
+
+/***************************************************************************
+ * mstg_freeindex:
+ *
+ * Free a MSTraceGroup index and set the pointer to 0.
+ ***************************************************************************/
+static void
+mstg_freeindex (MSTraceGroupIndex **ppindex)
+{
+  if (!ppindex || !*ppindex)
+    return;
+
+  mstg_clearindex (*ppindex);
+  free (*ppindex);
+
+  *ppindex = 0;
+} /* End of mstg_freeindex() */
+
+/***************************************************************************
+ * mstg_linktrace:
+ *
+ * Link a MSTrace to the end of the trace chain of a MSTraceGroup and
+ * add it to the index.  If the index cannot be used the end of the
+ * chain is found by traversing it.
+ ***************************************************************************/
+static void
+mstg_linktrace (MSTraceGroup *mstg, MSTrace *mst)
+{
+  MSTraceGroupIndex *index = mstg_index (mstg);
+  MSTrace *lasttrace;
+
+  mst->next = 0;
+
+  if (!mstg->traces)
+  {
+    mstg->traces = mst;
+  }
+  else
+  {
+    lasttrace = (index) ? index->tail : mstg->traces;
+
+    while (lasttrace->next)
+      lasttrace = lasttrace->next;
+
+    lasttrace->next = mst;
+  }
+
+  mstg->numtraces++;
+
+  if (index)
+  {
+    index->head      = mstg->traces;
+    index->tail      = mst;
+    index->numtraces = mstg->numtraces;
+
+    if (index->enabled && mstg_indextrace (index, mst))
+      index->numtraces = -1;
+  }
+} /* End of mstg_linktrace() */
+
+/***************************************************************************
+ * mstg_freetrace:
+ *
+ * Free a MSTrace of a MSTraceGroup and set the pointer to 0.  A trace
+ * allocated from the arena of the group is released with the arena,
+ * only the memory associated with it is freed.
+ ***************************************************************************/
+static void
+mstg_freetrace (MSTraceGroup *mstg, MSTrace **ppmst)
+{
+  if (!*ppmst)
+    return;
+
+  if (ms_arena_contains (mstg->arena, *ppmst))
+  {
+    mst_init (*ppmst);
+    *ppmst = 0;
+  }
+  else
+  {
+    mst_free (ppmst);
+  }
+} /* End of mstg_freetrace() */
+
+/***************************************************************************
+ * mstg_findchan:
+ *
+ * Search the hash table of a MSTraceGroup index for the traces of a
+ * channel.  If the add flag is true a missing channel is added.
+ *
+ * Return a pointer to the MSTraceChan if found or added otherwise 0.
+ ***************************************************************************/
+static MSTraceChan *
+mstg_findchan (MSTraceGroupIndex *index, char *network, char *station,
+               char *location, char *channel, flag add)
+{
+  MSTraceChan **table;
+  MSTraceChan *chan;
+  char srcname[45];
+  uint32_t hash = 2166136261u;
+  uint32_t mask;
+  uint32_t slot;
+  int32_t tablesize;
+  int32_t idx;
+  char *cp;
+
+  snprintf (srcname, sizeof (srcname), "%s_%s_%s_%s", network, station, location, channel);
+
+  /* 32-bit FNV-1a hash of source name */
+  for (cp = srcname; *cp; cp++)
+  {
+    hash ^= (uint8_t)*cp;
+    hash *= 16777619u;
+  }
+
+  if (index->tablesize)
+  {
+    mask = (uint32_t)index->tablesize - 1;
+
+    for (slot = hash & mask; index->table[slot]; slot = (slot + 1) & mask)
+    {
+      if (index->table[slot]->hash == hash && !strcmp (index->table[slot]->srcname, srcname))
+        return index->table[slot];
+    }
+  }
+
+  if (!add)
+    return 0;
+
+  /* Grow hash table and rehash channels, keeping it at most half full */
+  if ((index->numchans + 1) * 2 > index->tablesize)
+  {
+    tablesize = (index->tablesize) ? index->tablesize * 2 : 64;
+
+    if (!(table = (MSTraceChan **)calloc (tablesize, sizeof (MSTraceChan *))))
+    {
+      ms_log (2, "mstg_findchan(): Cannot allocate memory\n");
+      return 0;
+    }
+
+    mask = (uint32_t)tablesize - 1;
+
+    for (idx = 0; idx < index->tablesize; idx++)
+    {
+      if (!index->table[idx])
+        continue;
+
+      for (slot = index->table[idx]->hash & mask; table[slot]; slot = (slot + 1) & mask)
+        ;
+
+      table[slot] = index->table[idx];
+    }
+
+    if (index->table)
+      free (index->table);
+
+    index->table     = table;
+    index->tablesize = tablesize;
+  }
+
+  if (!(chan = (MSTraceChan *)calloc (1, sizeof (MSTraceChan))))
+  {
+    ms_log (2, "mstg_findchan(): Cannot allocate memory\n");
+    return 0;
+  }
+
+  strcpy (chan->srcname, srcname);
+  chan->hash = hash;
+
+  mask = (uint32_t)index->tablesize - 1;
+
+  for (slot = hash & mask; index->table[slot]; slot = (slot + 1) & mask)
+    ;
+
+  index->table[slot] = chan;
+  index->numchans++;
+
+  return chan;
+} /* End of mstg_findchan() */
+
+/***************************************************************************
+ * mstg_indextrace:
+ *
+ * Add a MSTrace to the traces of its channel in a MSTraceGroup index,
+ * the trace is the last in chain order.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mstg_indextrace (MSTraceGroupIndex *index, MSTrace *mst)
+{
+  MSTraceChan *chan;
+  MSTraceRef *refs;
+  int32_t size;
+  int32_t pos;
+
+  if (!(chan = mstg_findchan (index, mst->network, mst->station,
+                              mst->location, mst->channel, 1)))
+    return -1;
+
+  if (chan->count >= chan->size)
+  {
+    size = (chan->size) ? chan->size * 2 : 4;
+
+    if (!(refs = (MSTraceRef *)realloc (chan->bystart, size * sizeof (MSTraceRef))))
+    {
+      ms_log (2, "mstg_indextrace(): Cannot allocate memory\n");
+      return -1;
+    }
+    chan->bystart = refs;
+
+    if (!(refs = (MSTraceRef *)realloc (chan->byend, size * sizeof (MSTraceRef))))
+    {
+      ms_log (2, "mstg_indextrace(): Cannot allocate memory\n");
+      return -1;
+    }
+    chan->byend = refs;
+
+    chan->size = size;
+  }
+
+  /* Insert after any references with the same time */
+  pos = mstg_lowerbound (chan->bystart, chan->count, mst->starttime + 1);
+  memmove (&chan->bystart[pos + 1], &chan->bystart[pos], (chan->count - pos) * sizeof (MSTraceRef));
+  chan->bystart[pos].mst  = mst;
+  chan->bystart[pos].time = mst->starttime;
+  chan->bystart[pos].seq  = index->nextseq;
+
+  pos = mstg_lowerbound (chan->byend, chan->count, mst->endtime + 1);
+  memmove (&chan->byend[pos + 1], &chan->byend[pos], (chan->count - pos) * sizeof (MSTraceRef));
+  chan->byend[pos].mst  = mst;
+  chan->byend[pos].time = mst->endtime;
+  chan->byend[pos].seq  = index->nextseq;
+
+  chan->count++;
+  index->nextseq++;
+
+  return 0;
+} /* End of mstg_indextrace() */
+
+/***************************************************************************
+ * mstg_updatetrace:
+ *
+ * Update the index of a MSTraceGroup after the start or end time of a
+ * MSTrace changed from starttime and endtime.
+ ***************************************************************************/
+static void
+mstg_updatetrace (MSTraceGroup *mstg, MSTrace *mst,
+                  hptime_t starttime, hptime_t endtime)
+{
+  MSTraceGroupIndex *index = mstg->index;
+  MSTraceChan *chan;
+
+  if (!index || !index->enabled || index->numtraces != mstg->numtraces)
+    return;
+
+  if (!(chan = mstg_findchan (index, mst->network, mst->station,
+                              mst->location, mst->channel, 0)))
+  {
+    index->numtraces = -1;
+    return;
+  }
+
+  if (mst->starttime != starttime)
+    mstg_moveref (chan->bystart, chan->count, mst, starttime, mst->starttime);
+
+  if (mst->endtime != endtime)
+    mstg_moveref (chan->byend, chan->count, mst, endtime, mst->endtime);
+} /* End of mstg_updatetrace() */
+
+/***************************************************************************
+ * mstg_lowerbound:
+ *
+ * Return the position of the first reference with a time not less
+ * than the specified time, or count if there is none.
+ ***************************************************************************/
+static int32_t
+mstg_lowerbound (MSTraceRef *refs, int32_t count, hptime_t time)
+{
+  int32_t low  = 0;
+  int32_t high = count;
+  int32_t mid;
+
+  while (low < high)
+  {
+    mid = low + (high - low) / 2;
+
+    if (refs[mid].time < time)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+} /* End of mstg_lowerbound() */
+
+/***************************************************************************
+ * mstg_moveref:
+ *
+ * Change the time of the reference to a MSTrace from oldtime to
+ * newtime, moving it to keep the references in time order.
+ ***************************************************************************/
+static void
+mstg_moveref (MSTraceRef *refs, int32_t count, MSTrace *mst,
+              hptime_t oldtime, hptime_t newtime)
+{
+  MSTraceRef ref;
+  int32_t pos;
+  int32_t newpos;
+
+  for (pos = mstg_lowerbound (refs, count, oldtime);
+       pos < count && refs[pos].time == oldtime; pos++)
+  {
+    if (refs[pos].mst == mst)
+      break;
+  }
+
+  if (pos >= count || refs[pos].mst != mst)
+    return;
+
+  ref      = refs[pos];
+  ref.time = newtime;
+
+  memmove (&refs[pos], &refs[pos + 1], (count - pos - 1) * sizeof (MSTraceRef));
+
+  newpos = mstg_lowerbound (refs, count - 1, newtime + 1);
+
+  memmove (&refs[newpos + 1], &refs[newpos], (count - 1 - newpos) * sizeof (MSTraceRef));
+  refs[newpos] = ref;
+} /* End of mstg_moveref() */
+
+/***************************************************************************
+ * mstg_findadjacent:
+ *
+ * Find the first MSTrace in chain order of an indexed channel that is
+ * adjacent with a time span, the equivalent of the search in
+ * mst_findadjacent() limited to the traces of a channel.  Traces that
+ * end or start within the time tolerance of the span are found with a
+ * binary search of the references ordered by end and start time.
+ *
+ * Return a pointer a matching MSTrace and set the 'whence' flag
+ * otherwise 0 if no match found.
+ ***************************************************************************/
+static MSTrace *
+mstg_findadjacent (MSTraceChan *chan, flag *whence, char dataquality,
+                   double samprate, double sampratetol,
+                   hptime_t starttime, hptime_t endtime, double timetol)
+{
+  MSTraceRef *refs;
+  MSTraceRef *best = 0;
+  MSTrace *mst;
+  hptime_t hpdelta;
+  hptime_t hptimetol = 0;
+  hptime_t low;
+  hptime_t high;
+  int32_t idx;
+  int pass;
+
+  /* Calculate high-precision sample period */
+  hpdelta = (hptime_t) ((samprate) ? (HPTMODULUS / samprate) : 0.0);
+
+  /* Calculate high-precision time tolerance */
+  if (timetol == -1.0)
+    hptimetol = (hptime_t) (0.5 * hpdelta); /* Default time tolerance is 1/2 sample period */
+  else if (timetol >= 0.0)
+    hptimetol = (hptime_t) (timetol * HPTMODULUS);
+
+  /* Pass 1: traces ending where the span starts (whence 1)
+   * Pass 2: traces starting where the span ends (whence 2)
+   * Without a time tolerance check all traces are candidates. */
+  for (pass = 1; pass <= 2; pass++)
+  {
+    if (timetol == -2.0)
+    {
+      if (pass == 2)
+        break;
+
+      refs = chan->bystart;
+      idx  = 0;
+      low  = HPTERROR;
+      high = 0;
+    }
+    else if (pass == 1)
+    {
+      refs = chan->byend;
+      low  = starttime - hpdelta - hptimetol;
+      high = starttime - hpdelta + hptimetol;
+      idx  = mstg_lowerbound (refs, chan->count, low);
+    }
+    else
+    {
+      refs = chan->bystart;
+      low  = endtime + hpdelta - hptimetol;
+      high = endtime + hpdelta + hptimetol;
+      idx  = mstg_lowerbound (refs, chan->count, low);
+    }
+
+    for (; idx < chan->count && (timetol == -2.0 || refs[idx].time <= high); idx++)
+    {
+      mst = refs[idx].mst;
+
+      /* Only the first match in chain order is needed */
+      if (best && refs[idx].seq >= best->seq)
+        continue;
+
+      /* Perform samprate tolerance check if requested */
+      if (sampratetol != -2.0)
+      {
+        if (sampratetol == -1.0)
+        {
+          if (!MS_ISRATETOLERABLE (samprate, mst->samprate))
+            continue;
+        }
+        else if (ms_dabs (samprate - mst->samprate) > sampratetol)
+        {
+          continue;
+        }
+      }
+
+      /* Compare data qualities */
+      if (dataquality && dataquality != mst->dataquality)
+        continue;
+
+      best    = &refs[idx];
+      *whence = pass;
+    }
+  }
+
+  if (!best)
+    return 0;
+
+  mst = best->mst;
+
+  /* If not checking the time tolerance decide if beginning or end is a better fit */
+  if (timetol == -2.0)
+  {
+    if (ms_dabs ((double)(starttime - mst->endtime - hpdelta)) <
+        ms_dabs ((double)(mst->starttime - endtime - hpdelta)))
+      *whence = 1;
+    else
+      *whence = 2;
+  }
+
+  return mst;
+} /* End of mstg_findadjacent() */
+
+/***************************************************************************
+ * mstg_healcmp:
+ *
+ * Compare two MSTraceRefs by channel, time and chain order, used with
+ * qsort() by mst_groupheal().
+ *
+ * Return -1, 0 or 1 as ref1 orders before, equal or after ref2.
+ ***************************************************************************/
+static int
+mstg_healcmp (const void *ref1, const void *ref2)
+{
+  const MSTraceRef *r1 = (const MSTraceRef *)ref1;
+  const MSTraceRef *r2 = (const MSTraceRef *)ref2;
+  int cmp;
+
+  if ((cmp = mstg_healcmpchan (r1->mst, r2->mst)))
+    return cmp;
+
+  if (r1->time != r2->time)
+    return (r1->time < r2->time) ? -1 : 1;
+
+  if (r1->seq != r2->seq)
+    return (r1->seq < r2->seq) ? -1 : 1;
+
+  return 0;
+} /* End of mstg_healcmp() */
+
+/***************************************************************************
+ * mstg_healcmpchan:
+ *
+ * Compare the network, station, location and channel of two MSTraces.
+ *
+ * Return a value less than, equal to or greater than 0 as mst1 orders
+ * before, equal or after mst2.
+ ***************************************************************************/
+static int
+mstg_healcmpchan (MSTrace *mst1, MSTrace *mst2)
+{
+  int cmp;
+
+  if ((cmp = strcmp (mst1->network, mst2->network)))
+    return cmp;
+  if ((cmp = strcmp (mst1->station, mst2->station)))
+    return cmp;
+  if ((cmp = strcmp (mst1->location, mst2->location)))
+    return cmp;
+
+  return strcmp (mst1->channel, mst2->channel);
+} /* End of mstg_healcmpchan() */
+
+/***************************************************************************
+ * mstg_healrate:
+ *
+ * Check if the sample rate of a MSTrace is tolerable compared to the
+ * sample rate of the trace being healed.  If sampratetol is -1.0 the
+ * default tolerance check is used.
+ *
+ * Return 1 if the sample rate is tolerable otherwise 0.
+ ***************************************************************************/
+static int
+mstg_healrate (MSTrace *mst, MSTrace *curmst, double sampratetol)
+{
+  if (sampratetol == -1.0)
+    return (MS_ISRATETOLERABLE (mst->samprate, curmst->samprate)) ? 1 : 0;
+
+  return (ms_dabs (mst->samprate - curmst->samprate) > sampratetol) ? 0 : 1;
+} /* End of mstg_healrate() */
+
+/***************************************************************************
+ * mstg_healfind:
+ *
+ * Find the first trace in chain order, after the trace with chain
+ * order 'after', that fits at the end or the beginning of the trace
+ * being healed.  Candidates are the traces of the channel starting
+ * within the time tolerance after the end of the trace and ending
+ * within the time tolerance before the start of the trace, found with
+ * a binary search of the references ordered by start and end time.
+ * The tolerance window is widened by a tick to allow for rounding,
+ * the gaps of candidates are checked exactly as the pairwise
+ * comparison would.
+ *
+ * Return the chain order of the matching trace otherwise -1.
+ ***************************************************************************/
+static int32_t
+mstg_healfind (MSTraceHeal *heal, MSTraceRef *bystart, MSTraceRef *byend,
+               MSTraceHeal *cur, int32_t after, double delta,
+               double timetol, double sampratetol)
+{
+  MSTraceRef *refs;
+  MSTrace *mst;
+  hptime_t low;
+  hptime_t high;
+  double lowoffset;
+  double highoffset;
+  double postgap;
+  double pregap;
+  int32_t count = cur->last - cur->first;
+  int32_t best  = -1;
+  int32_t idx;
+  int pass;
+
+  /* Offsets from the trace of candidate times, limited to the range of
+     time values */
+  lowoffset  = (delta - timetol) * HPTMODULUS;
+  highoffset = (delta + timetol) * HPTMODULUS;
+
+  if (lowoffset < -4.0e18)
+    lowoffset = -4.0e18;
+  if (highoffset > 4.0e18)
+    highoffset = 4.0e18;
+
+  /* Pass 1: traces starting after the end of the trace
+   * Pass 2: traces ending before the start of the trace */
+  for (pass = 1; pass <= 2; pass++)
+  {
+    if (pass == 1)
+    {
+      refs = bystart + cur->first;
+      low  = cur->mst->endtime + (hptime_t)lowoffset - 2;
+      high = cur->mst->endtime + (hptime_t)highoffset + 2;
+    }
+    else
+    {
+      refs = byend + cur->first;
+      low  = cur->mst->starttime - (hptime_t)highoffset - 2;
+      high = cur->mst->starttime - (hptime_t)lowoffset + 2;
+    }
+
+    for (idx = mstg_lowerbound (refs, count, low);
+         idx < count && refs[idx].time <= high; idx++)
+    {
+      if (refs[idx].seq <= after || (best >= 0 && refs[idx].seq >= best))
+        continue;
+
+      mst = heal[refs[idx].seq].mst;
+
+      /* Skip the trace itself and traces already merged */
+      if (!mst || mst == cur->mst)
+        continue;
+
+      if (!mstg_healrate (mst, cur->mst, sampratetol))
+        continue;
+
+      postgap = ((double)(mst->starttime - cur->mst->endtime) / HPTMODULUS) - delta;
+      pregap  = ((double)(cur->mst->starttime - mst->endtime) / HPTMODULUS) - delta;
+
+      if (ms_dabs (postgap) <= timetol || ms_dabs (pregap) <= timetol)
+        best = refs[idx].seq;
+    }
+  }
+
+  return best;
+} /* End of mstg_healfind() */
+
+/***************************************************************************
+ * mstg_healmerge:
+ *
+ * Add the time span and samples of a MSTrace to a trace being healed,
+ * the equivalent of mst_addspan() except that the sample buffer of the
+ * trace grows geometrically.  If no data samples are present the
+ * sample count is added.  On a sample type mismatch the trace is not
+ * changed.
+ *
+ * Return 0 on success and -1 on allocation error.
+ ***************************************************************************/
+static int
+mstg_healmerge (MSTraceHeal *cur, MSTrace *mst, flag whence)
+{
+  MSTrace *curmst = cur->mst;
+  size_t cursize;
+  size_t addsize;
+  size_t capacity;
+  void *datasamples;
+  int samplesize;
+
+  if (mst->datasamples && mst->numsamples > 0)
+  {
+    if ((samplesize = ms_samplesize (mst->sampletype)) == 0)
+    {
+      ms_log (2, "mst_groupheal(): Unrecognized sample type: '%c'\n",
+              mst->sampletype);
+      return 0;
+    }
+
+    if (mst->sampletype != curmst->sampletype)
+    {
+      ms_log (2, "mst_groupheal(): Mismatched sample type, '%c' and '%c'\n",
+              mst->sampletype, curmst->sampletype);
+      return 0;
+    }
+
+    cursize = (size_t) (curmst->numsamples * samplesize);
+    addsize = (size_t) (mst->numsamples * samplesize);
+
+    if (cursize + addsize > cur->capacity || !curmst->datasamples)
+    {
+      capacity = cur->capacity * 2;
+
+      if (capacity < cursize + addsize)
+        capacity = cursize + addsize;
+
+      if (!(datasamples = realloc (curmst->datasamples, capacity)))
+      {
+        ms_log (2, "mst_groupheal(): Cannot allocate memory\n");
+        return -1;
+      }
+
+      curmst->datasamples = datasamples;
+      cur->capacity       = capacity;
+    }
+
+    if (whence == 1)
+    {
+      memcpy ((char *)curmst->datasamples + cursize, mst->datasamples, addsize);
+    }
+    else
+    {
+      /* Move any samples to end of buffer */
+      if (cursize > 0)
+        memmove ((char *)curmst->datasamples + addsize, curmst->datasamples, cursize);
+
+      memcpy (curmst->datasamples, mst->datasamples, addsize);
+    }
+
+    curmst->numsamples += mst->numsamples;
+  }
+
+  if (whence == 1)
+    curmst->endtime = mst->endtime;
+  else
+    curmst->starttime = mst->starttime;
+
+  /* Update sample count, if no data is present add the sample count */
+  if (mst->numsamples > 0)
+    curmst->samplecnt += mst->numsamples;
+  else
+    curmst->samplecnt += mst->samplecnt;
+
+  return 0;
+} /* End of mstg_healmerge() */
+
 /***************************************************************************
  * mst_convertsamples:
  *
@@ -1637,6 +2593,8 @@ mst_printgaplist (MSTraceGroup *mstg, flag timeformat,
  *
  * If the flush flag is > 0 all of the data will be packed into data
  * records even though the last one will probably not be filled.
+ * Otherwise remaining samples are moved to the beginning of the
+ * MSTrace->datasamples buffer, which keeps its allocated size.
  *
  * If the mstemplate argument is not NULL it will be used as the
  * template for the packed Mini-SEED records.  Otherwise a new
@@ -1747,19 +2705,15 @@ mst_pack (MSTrace *mst, void (*record_handler) (char *, int, void *),
     samplesize = ms_samplesize (mst->sampletype);
     bufsize    = (mst->numsamples - trpackedsamples) * samplesize;
 
+    /* Move remaining samples to the beginning of the buffer.  All full
+     * records have been packed, so this is less than a record of samples
+     * unless an error occurred.  The buffer is not reduced, avoiding a
+     * reallocation when samples are added before the next call. */
     if (bufsize)
     {
       memmove (mst->datasamples,
                (char *)mst->datasamples + (trpackedsamples * samplesize),
                (size_t)bufsize);
-
-      mst->datasamples = realloc (mst->datasamples, (size_t)bufsize);
-
-      if (mst->datasamples == NULL)
-      {
-        ms_log (2, "mst_pack(): Cannot (re)allocate datasamples buffer\n");
-        return -1;
-      }
     }
     else
     {
@@ -3,7 +3,7 @@
  * STEIM2, GEOSCOPE (24bit and gain ranged), CDSN, SRO and DWWSSN
  * encoded data.
  *
- * modified: 2017.053
+ * modified: 2026.289
  ************************************************************************/
 
 #include <memory.h>
@@ -13,9 +13,17 @@
 #include "libmseed.h"
 #include "unpackdata.h"
 
+#if defined(LMP_X86SIMD)
+#include <immintrin.h>
+#endif
+
 /* Control for printing debugging information */
 int decodedebug = 0;
 
+/* Control for SIMD Steim decoding, highest LMP_SIMD_* level to use or
+ * -1 to use the highest level supported by the CPU */
+int decodesimd = -1;
+
 /* Extract bit range.  Byte order agnostic & defined when used with unsigned values */
 #define EXTRACTBITRANGE(VALUE, STARTBIT, LENGTH) ((VALUE >> STARTBIT) & ((1U << LENGTH) - 1))
 
@@ -24,6 +32,62 @@ int decodedebug = 0;
 #define MAX16 0x7FFFul   /* maximum 16 bit positive # */
 #define MAX24 0x7FFFFFul /* maximum 24 bit positive # */
 
+#if defined(LMP_X86SIMD)
+/* Number of differences buffered for a frame by the SIMD Steim
+ * decoders, 15 words of up to 7 differences plus room for a full
+ * vector store after the last word */
+#define STEIM_FRAMEDIFFS 120
+
+/* Expansion of a Steim word into differences, each difference is
+ * (int32_t)(value << lshift) >> rshift where value is the word in host
+ * order, except for 4 x 8-bit differences which are in memory order
+ * (the host is little-endian).  A count of -1 indicates an invalid word.
+ *
+ * Words are indexed by nibble * 4 + the high order two bits of the
+ * word in host order (dnib), entries not using dnib are repeated. */
+typedef struct SteimWord_s
+{
+  int32_t count;
+  int32_t lshift[8];
+  int32_t rshift[8];
+} SteimWord;
+
+#define STEIM_NONE {0, {0}, {0}}
+#define STEIM_4X8 {4, {24, 16, 8, 0}, {24, 24, 24, 24}}
+
+/* Steim1 words, without and with byte swapping, 2 x 16-bit differences
+ * are in memory order of each half word. */
+static const SteimWord steim1words[2][16] = {
+    {STEIM_NONE, STEIM_NONE, STEIM_NONE, STEIM_NONE,
+     STEIM_4X8, STEIM_4X8, STEIM_4X8, STEIM_4X8,
+     {2, {16, 0}, {16, 16}}, {2, {16, 0}, {16, 16}},
+     {2, {16, 0}, {16, 16}}, {2, {16, 0}, {16, 16}},
+     {1, {0}, {0}}, {1, {0}, {0}}, {1, {0}, {0}}, {1, {0}, {0}}},
+    {STEIM_NONE, STEIM_NONE, STEIM_NONE, STEIM_NONE,
+     STEIM_4X8, STEIM_4X8, STEIM_4X8, STEIM_4X8,
+     {2, {0, 16}, {16, 16}}, {2, {0, 16}, {16, 16}},
+     {2, {0, 16}, {16, 16}}, {2, {0, 16}, {16, 16}},
+     {1, {0}, {0}}, {1, {0}, {0}}, {1, {0}, {0}}, {1, {0}, {0}}}};
+
+/* Steim2 words */
+static const SteimWord steim2words[16] = {
+    STEIM_NONE, STEIM_NONE, STEIM_NONE, STEIM_NONE,
+    STEIM_4X8, STEIM_4X8, STEIM_4X8, STEIM_4X8,
+    {-1, {0}, {0}},
+    {1, {2}, {2}},
+    {2, {2, 17}, {17, 17}},
+    {3, {2, 12, 22}, {22, 22, 22}},
+    {5, {2, 8, 14, 20, 26}, {26, 26, 26, 26, 26}},
+    {6, {2, 7, 12, 17, 22, 27}, {27, 27, 27, 27, 27, 27}},
+    {7, {4, 8, 12, 16, 20, 24, 28}, {28, 28, 28, 28, 28, 28, 28}},
+    {-1, {0}, {0}}};
+
+static int steim_decode_level (void);
+static int msr_decode_steim_simd (int32_t *input, int inputlength, int samplecount,
+                                  int32_t *output, char *srcname, int swapflag,
+                                  int version);
+#endif /* LMP_X86SIMD */
+
 /************************************************************************
  * msr_decode_int16:
  *
@@ -205,6 +269,13 @@ msr_decode_steim1 (int32_t *input, int inputlength, int samplecount,
   if (!input || !output || outputlength <= 0 || maxframes <= 0)
     return -1;
 
+#if defined(LMP_X86SIMD)
+  /* Use SIMD decoder if available, the scalar decoder prints debugging details */
+  if (!decodedebug && steim_decode_level () >= LMP_SIMD_AVX2)
+    return msr_decode_steim_simd (input, inputlength, samplecount, output,
+                                  srcname, swapflag, 1);
+#endif
+
   if (decodedebug)
     ms_log (1, "Decoding %d Steim1 frames, swapflag: %d, srcname: %s\n",
             maxframes, swapflag, (srcname) ? srcname : "");
@@ -360,6 +431,13 @@ msr_decode_steim2 (int32_t *input, int inputlength, int samplecount,
   if (!input || !output || outputlength <= 0 || maxframes <= 0)
     return -1;
 
+#if defined(LMP_X86SIMD)
+  /* Use SIMD decoder if available, the scalar decoder prints debugging details */
+  if (!decodedebug && steim_decode_level () >= LMP_SIMD_AVX2)
+    return msr_decode_steim_simd (input, inputlength, samplecount, output,
+                                  srcname, swapflag, 2);
+#endif
+
   if (decodedebug)
     ms_log (1, "Decoding %d Steim2 frames, swapflag: %d, srcname: %s\n",
             maxframes, swapflag, (srcname) ? srcname : "");
@@ -563,6 +641,220 @@ msr_decode_steim2 (int32_t *input, int inputlength, int samplecount,
   return (outputptr - output);
 } /* End of msr_decode_steim2() */
 
+#if defined(LMP_X86SIMD)
+/************************************************************************
+ * steim_decode_level:
+ *
+ * Determine the SIMD level for the Steim decoders based on the level
+ * supported by the CPU, limited by decodesimd.  The SIMD decoders
+ * require AVX2 for variable shifts.
+ *
+ * Return the LMP_SIMD_* level to use.
+ ************************************************************************/
+static int
+steim_decode_level (void)
+{
+  int level = lmp_simdlevel ();
+
+  if (decodesimd >= 0 && decodesimd < level)
+    level = decodesimd;
+
+  return level;
+} /* End of steim_decode_level() */
+
+/************************************************************************
+ * steim_expand_avx2:
+ *
+ * Expand the differences in the words of a frame, starting at word
+ * startnibble and stopping once at least limit differences have been
+ * expanded.  The frame is given as read and in host order.  All
+ * differences of a word are extracted at once with AVX2 variable
+ * shifts.  If an invalid word is found expansion stops and the index
+ * of the word in words is returned in error, otherwise error is 0.
+ *
+ * Return the number of differences expanded.
+ ************************************************************************/
+__attribute__ ((target ("avx2"))) static int
+steim_expand_avx2 (const uint32_t *frame, const uint32_t *host, int startnibble,
+                   int limit, const SteimWord *words, int32_t *diffs, int *error)
+{
+  const SteimWord *word;
+  __m256i expanded;
+  uint32_t value;
+  int nibble;
+  int count = 0;
+  int code;
+  int widx;
+
+  *error = 0;
+
+  for (widx = startnibble; widx < 16 && count < limit; widx++)
+  {
+    nibble = EXTRACTBITRANGE (host[0], (30 - (2 * widx)), 2);
+    value  = (nibble == 1) ? frame[widx] : host[widx];
+    code   = (nibble << 2) | (host[widx] >> 30);
+    word   = &words[code];
+
+    if (word->count < 0)
+    {
+      *error = code;
+      break;
+    }
+
+    /* Store all 8 lanes, only count differences are kept */
+    expanded = _mm256_set1_epi32 ((int32_t)value);
+    expanded = _mm256_sllv_epi32 (expanded, _mm256_loadu_si256 ((const __m256i *)word->lshift));
+    expanded = _mm256_srav_epi32 (expanded, _mm256_loadu_si256 ((const __m256i *)word->rshift));
+    _mm256_storeu_si256 ((__m256i *)(diffs + count), expanded);
+
+    count += word->count;
+  }
+
+  return count;
+} /* End of steim_expand_avx2() */
+
+/************************************************************************
+ * steim_integrate_avx2:
+ *
+ * Integrate count differences starting from the previous sample last
+ * and place the samples in output, using an AVX2 prefix sum.
+ *
+ * Return the last sample.
+ ************************************************************************/
+__attribute__ ((target ("avx2"))) static int32_t
+steim_integrate_avx2 (const int32_t *diffs, int count, int32_t last,
+                      int32_t *output)
+{
+  const __m256i lastlane = _mm256_set1_epi32 (7);
+  __m256i carry          = _mm256_set1_epi32 (last);
+  __m256i lanetotal;
+  __m256i sum;
+  int idx;
+
+  for (idx = 0; idx + 8 <= count; idx += 8)
+  {
+    /* Prefix sum within each 128-bit lane, then carry the lower lane total */
+    sum = _mm256_loadu_si256 ((const __m256i *)(diffs + idx));
+    sum = _mm256_add_epi32 (sum, _mm256_slli_si256 (sum, 4));
+    sum = _mm256_add_epi32 (sum, _mm256_slli_si256 (sum, 8));
+    lanetotal = _mm256_shuffle_epi32 (sum, 0xFF);
+    sum = _mm256_add_epi32 (sum, _mm256_permute2x128_si256 (lanetotal, lanetotal, 0x08));
+    sum = _mm256_add_epi32 (sum, carry);
+    _mm256_storeu_si256 ((__m256i *)(output + idx), sum);
+
+    carry = _mm256_permutevar8x32_epi32 (sum, lastlane);
+  }
+
+  last = _mm256_cvtsi256_si32 (carry);
+
+  for (; idx < count; idx++)
+    output[idx] = last = (int32_t)((uint32_t)last + (uint32_t)diffs[idx]);
+
+  return last;
+} /* End of steim_integrate_avx2() */
+
+/************************************************************************
+ * msr_decode_steim_simd:
+ *
+ * Decode Steim1 or Steim2 (version) encoded miniSEED data as
+ * msr_decode_steim1() and msr_decode_steim2() do, producing identical
+ * output.  The differences of each frame are expanded with tables of
+ * shifts instead of testing each word type in turn and integrated with
+ * a vector prefix sum, using AVX2 instructions.
+ *
+ * Return number of samples in output buffer on success, -1 on error.
+ ************************************************************************/
+static int
+msr_decode_steim_simd (int32_t *input, int inputlength, int samplecount,
+                       int32_t *output, char *srcname, int swapflag,
+                       int version)
+{
+  const SteimWord *words;
+  int32_t *outputptr = output; /* Pointer to next output sample location */
+  uint32_t frame[16];          /* Frame, 16 x 32-bit quantities = 64 bytes */
+  uint32_t host[16];           /* Frame in host byte order */
+  int32_t diffs[STEIM_FRAMEDIFFS];
+  int32_t X0    = 0; /* Forward integration constant, aka first sample */
+  int32_t Xn    = 0; /* Reverse integration constant, aka last sample */
+  int32_t last  = 0;
+  int maxframes = inputlength / 64;
+  int frameidx;
+  int startnibble;
+  int count;
+  int error;
+  int idx;
+
+  words = (version == 1) ? steim1words[(swapflag) ? 1 : 0] : steim2words;
+
+  for (frameidx = 0; frameidx < maxframes && samplecount > 0; frameidx++)
+  {
+    /* Copy frame, each is 16x32-bit quantities = 64 bytes */
+    memcpy (frame, input + (16 * frameidx), 64);
+
+    /* Swap all words to host order, including the nibbles */
+    if (swapflag)
+    {
+      for (idx = 0; idx < 16; idx++)
+        host[idx] = __builtin_bswap32 (frame[idx]);
+    }
+    else
+    {
+      memcpy (host, frame, 64);
+    }
+
+    /* Save forward integration constant (X0) and reverse integration constant (Xn)
+       and set the starting nibble index depending on frame. */
+    if (frameidx == 0)
+    {
+      X0 = host[1];
+      Xn = host[2];
+
+      startnibble = 3; /* First frame: skip nibbles, X0, and Xn */
+    }
+    else
+    {
+      startnibble = 1; /* Subsequent frames: skip nibbles */
+    }
+
+    count = steim_expand_avx2 (frame, host, startnibble, samplecount, words, diffs, &error);
+
+    if (count > samplecount)
+      count = samplecount;
+
+    /* Ignore first difference, instead store X0 */
+    idx = 0;
+    if (outputptr == output && count > 0)
+    {
+      *outputptr++ = last = X0;
+      idx              = 1;
+    }
+
+    /* Apply differences to calculate output samples */
+    last = steim_integrate_avx2 (diffs + idx, count - idx, last, outputptr);
+
+    outputptr += count - idx;
+    samplecount -= count;
+
+    if (error)
+    {
+      ms_log (2, "%s: Impossible Steim2 dnib=%s for nibble=%s\n", srcname,
+              (error == 8) ? "00" : "11", (error == 8) ? "10" : "11");
+
+      return -1;
+    }
+  } /* Done looping over frames */
+
+  /* Check data integrity by comparing last sample to Xn (reverse integration constant) */
+  if (outputptr != output && *(outputptr - 1) != Xn)
+  {
+    ms_log (1, "%s: Warning: Data integrity check for Steim%d failed, Last sample=%d, Xn=%d\n",
+            srcname, version, *(outputptr - 1), Xn);
+  }
+
+  return (outputptr - output);
+} /* End of msr_decode_steim_simd() */
+#endif /* LMP_X86SIMD */
+
 /* Defines for GEOSCOPE encoding */
 #define GEOSCOPE_MANTISSA_MASK 0x0FFFul /* mask for mantissa */
 #define GEOSCOPE_GAIN3_MASK 0x7000ul    /* mask for gainrange factor */
@@ -4,7 +4,7 @@
  * Interface declarations for the Mini-SEED unpacking routines in
  * unpackdata.c
  *
- * modified: 2016.273
+ * modified: 2026.289
  ***************************************************************************/
 
 #ifndef UNPACKDATA_H
@@ -17,6 +17,10 @@ extern "C" {
 /* Control for printing debugging information, declared in unpackdata.c */
 extern int decodedebug;
 
+/* Control for SIMD Steim decoding, highest LMP_SIMD_* level to use or
+ * -1 for the highest supported level, declared in unpackdata.c */
+extern int decodesimd;
+
 extern int msr_decode_int16 (int16_t *input, int samplecount, int32_t *output,
                              int outputlength, int swapflag);
 extern int msr_decode_int32 (int32_t *input, int samplecount, int32_t *output,
@@ -19,11 +19,22 @@ INCS = -I..\libmseed
 
 all: $(BIN)
 
-$(BIN):	ascii2mseed.obj
-	wlink $(lflags) name $(BIN) file {ascii2mseed.obj}
+OBJS = ascii2mseed.obj readbuffer.obj parsenum.obj timeparse.obj taskpool.obj segindex.obj writebuffer.obj archive.obj decompress.obj stats.obj
+
+$(BIN):	$(OBJS)
+	wlink $(lflags) name $(BIN) file {$(OBJS)}
 
 # Source dependencies:
 ascii2mseed.obj:	ascii2mseed.c
+readbuffer.obj:	readbuffer.c
+parsenum.obj:	parsenum.c
+timeparse.obj:	timeparse.c
+taskpool.obj:	taskpool.c
+segindex.obj:	segindex.c
+writebuffer.obj:	writebuffer.c
+archive.obj:	archive.c
+decompress.obj:	decompress.c
+stats.obj:	stats.c
 
 # How to compile sources:
 .c.obj:
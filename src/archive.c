@@ -0,0 +1,498 @@
+/***************************************************************************
+ * archive.c
+ *
+ * Routing of miniSEED records to archive files.  The path of the file
+ * for each record is created from a format containing the following
+ * flags, which are replaced with values from the record header:
+ *
+ *   %n : network code
+ *   %s : station code
+ *   %l : location code
+ *   %c : channel code
+ *   %q : data quality indicator
+ *   %Y : year of record start, 4 digits
+ *   %j : day of year of record start, 3 digits
+ *   %H : hour of record start, 2 digits
+ *   %M : minute of record start, 2 digits
+ *   %S : second of record start, 2 digits
+ *   %% : the percent (%) character
+ *
+ * Records are appended to existing files and missing directories are
+ * created.  To allow writing to thousands of files without running
+ * out of file descriptors, or opening and closing a file for each
+ * record, a limited number of files is kept open.  Open files are
+ * found by path in a hash table and kept in a list ordered by use,
+ * the least recently used file is closed when the limit is reached.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libmseed.h>
+
+#if defined(LMP_WIN)
+  #include <direct.h>
+  #define ar_mkdir(path) _mkdir(path)
+#else
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #define ar_mkdir(path) mkdir(path, 0777)
+#endif
+
+#include "archive.h"
+
+static int ar_path (Archive *ar, const char *record, char *path);
+static ArchiveFile *ar_open (Archive *ar, const char *path, uint32_t hash);
+static void ar_closefile (Archive *ar, ArchiveFile *af);
+static int ar_checkformat (const char *format);
+static int ar_mkdirs (Archive *ar, const char *path);
+static uint32_t ar_hash (const char *path);
+
+
+/***************************************************************************
+ * ar_init:
+ *
+ * Initialize an archive with the specified path format keeping at
+ * most maxopen files open, if maxopen is 0 or less a default of
+ * AR_MAXOPEN is used.
+ *
+ * Returns a new Archive on success and NULL on error.
+ ***************************************************************************/
+Archive *
+ar_init (const char *format, int maxopen)
+{
+  Archive *ar;
+
+  if ( ! format )
+    return NULL;
+
+  if ( ! (ar = (Archive *) calloc (1, sizeof (Archive))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for archive\n");
+      return NULL;
+    }
+
+  if ( ar_checkformat (format) )
+    {
+      free (ar);
+      return NULL;
+    }
+
+  ar->maxopen = ( maxopen > 0 ) ? maxopen : AR_MAXOPEN;
+
+  /* Hash table of at least twice the number of open files */
+  ar->tablesize = 16;
+  while ( ar->tablesize < (uint32_t) ar->maxopen * 2 )
+    ar->tablesize *= 2;
+
+  ar->format = strdup (format);
+  ar->table = (ArchiveFile **) calloc (ar->tablesize, sizeof (ArchiveFile *));
+
+  if ( ! ar->format || ! ar->table )
+    {
+      fprintf (stderr, "Cannot allocate memory for archive\n");
+      ar_close (&ar);
+      return NULL;
+    }
+
+  return ar;
+}  /* End of ar_init() */
+
+
+/***************************************************************************
+ * ar_write:
+ *
+ * Write a record to the archive file for the record.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+ar_write (Archive *ar, const char *record, int reclen)
+{
+  ArchiveFile *af;
+  char path[AR_MAXPATH];
+  uint32_t hash;
+
+  if ( ! ar || ! record || reclen < (int) sizeof (struct fsdh_s) )
+    return -1;
+
+  if ( ar_path (ar, record, path) )
+    {
+      ar->errors++;
+      return -1;
+    }
+
+  hash = ar_hash (path);
+
+  for ( af = ar->table[hash & (ar->tablesize - 1)]; af; af = af->hnext )
+    if ( af->hash == hash && ! strcmp (af->path, path) )
+      break;
+
+  if ( af )
+    {
+      /* Move file to the head of the list */
+      if ( af != ar->head )
+        {
+          af->prev->next = af->next;
+          if ( af->next )
+            af->next->prev = af->prev;
+          else
+            ar->tail = af->prev;
+
+          af->prev = NULL;
+          af->next = ar->head;
+          ar->head->prev = af;
+          ar->head = af;
+        }
+    }
+  else if ( ! (af = ar_open (ar, path, hash)) )
+    {
+      ar->errors++;
+      return -1;
+    }
+
+  return wb_write (af->wb, record, reclen);
+}  /* End of ar_write() */
+
+
+/***************************************************************************
+ * ar_close:
+ *
+ * Close all files of an archive and free all memory associated with
+ * it.  An error message is printed if any record was not written.
+ *
+ * Returns 0 on success and -1 if any write or close failed.
+ ***************************************************************************/
+int
+ar_close (Archive **ar)
+{
+  int rv;
+
+  if ( ! ar || ! *ar )
+    return -1;
+
+  while ( (*ar)->head )
+    ar_closefile (*ar, (*ar)->head);
+
+  rv = 0;
+  if ( (*ar)->errors )
+    {
+      fprintf (stderr, "Error writing to archive, %lld file open(s) or write(s) failed\n",
+               (long long int)(*ar)->errors);
+      rv = -1;
+    }
+
+  if ( (*ar)->table )
+    free ((*ar)->table);
+
+  if ( (*ar)->format )
+    free ((*ar)->format);
+
+  free (*ar);
+  *ar = NULL;
+
+  return rv;
+}  /* End of ar_close() */
+
+
+/***************************************************************************
+ * ar_path:
+ *
+ * Create the path of the archive file for a record from the archive
+ * format, the path buffer must hold AR_MAXPATH characters.  Records
+ * with codes containing path separators or dots are rejected so that
+ * files are not written outside of the archive.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ar_path (Archive *ar, const char *record, char *path)
+{
+  struct fsdh_s *fsdh = (struct fsdh_s *) record;
+  BTime btime;
+  char value[16];
+  const char *fp;
+  size_t length = 0;
+  size_t vlength;
+
+  memcpy (&btime, &fsdh->start_time, sizeof (BTime));
+
+  /* Swap byte order of time if needed, as determined by libmseed */
+  if ( ! MS_ISVALIDYEARDAY (btime.year, btime.day) )
+    {
+      MS_SWAPBTIME (&btime);
+    }
+
+  for ( fp = ar->format; *fp; fp++ )
+    {
+      if ( *fp != '%' )
+        {
+          value[0] = *fp;
+          value[1] = '\0';
+        }
+      else
+        {
+          switch ( *++fp )
+            {
+            case 'n':
+              ms_strncpclean (value, fsdh->network, 2);
+              break;
+            case 's':
+              ms_strncpclean (value, fsdh->station, 5);
+              break;
+            case 'l':
+              ms_strncpclean (value, fsdh->location, 2);
+              break;
+            case 'c':
+              ms_strncpclean (value, fsdh->channel, 3);
+              break;
+            case 'q':
+              value[0] = fsdh->dataquality;
+              value[1] = '\0';
+              break;
+            case 'Y':
+              snprintf (value, sizeof (value), "%04d", (int) btime.year);
+              break;
+            case 'j':
+              snprintf (value, sizeof (value), "%03d", (int) btime.day);
+              break;
+            case 'H':
+              snprintf (value, sizeof (value), "%02d", (int) btime.hour);
+              break;
+            case 'M':
+              snprintf (value, sizeof (value), "%02d", (int) btime.min);
+              break;
+            case 'S':
+              snprintf (value, sizeof (value), "%02d", (int) btime.sec);
+              break;
+            case '%':
+              strcpy (value, "%");
+              break;
+            default:
+              return -1;
+            }
+
+          /* Codes must not add path components, '.' is not valid in SEED codes */
+          if ( strchr ("nslcq", *fp) && strpbrk (value, "/\\.") )
+            {
+              fprintf (stderr, "Invalid code for archive file path: '%s'\n", value);
+              return -1;
+            }
+        }
+
+      vlength = strlen (value);
+
+      if ( length + vlength >= AR_MAXPATH )
+        {
+          fprintf (stderr, "Archive file path is too long: %.*s...\n",
+                   (int) length, path);
+          return -1;
+        }
+
+      memcpy (path + length, value, vlength);
+      length += vlength;
+    }
+
+  path[length] = '\0';
+
+  return 0;
+}  /* End of ar_path() */
+
+
+/***************************************************************************
+ * ar_open:
+ *
+ * Open an archive file for appending, creating missing directories.
+ * If the maximum number of files are open the least recently used
+ * file is closed first.  The file is added to the hash table and at
+ * the head of the list.
+ *
+ * Returns the ArchiveFile on success and NULL on error.
+ ***************************************************************************/
+static ArchiveFile *
+ar_open (Archive *ar, const char *path, uint32_t hash)
+{
+  ArchiveFile *af;
+  ArchiveFile **chain;
+
+  if ( ar->numopen >= ar->maxopen )
+    ar_closefile (ar, ar->tail);
+
+  if ( ! (af = (ArchiveFile *) calloc (1, sizeof (ArchiveFile))) ||
+       ! (af->path = strdup (path)) )
+    {
+      fprintf (stderr, "Cannot allocate memory for archive file\n");
+      if ( af )
+        free (af);
+      return NULL;
+    }
+
+  if ( ar_mkdirs (ar, path) ||
+       ! (af->wb = wb_open (path, AR_BUFSIZE, WB_APPEND)) )
+    {
+      free (af->path);
+      free (af);
+      return NULL;
+    }
+
+  af->hash = hash;
+
+  chain = &ar->table[hash & (ar->tablesize - 1)];
+  af->hnext = *chain;
+  *chain = af;
+
+  af->next = ar->head;
+  if ( ar->head )
+    ar->head->prev = af;
+  else
+    ar->tail = af;
+  ar->head = af;
+
+  ar->numopen++;
+
+  return af;
+}  /* End of ar_open() */
+
+
+/***************************************************************************
+ * ar_closefile:
+ *
+ * Close an archive file and remove it from the hash table and list.
+ ***************************************************************************/
+static void
+ar_closefile (Archive *ar, ArchiveFile *af)
+{
+  ArchiveFile **chain;
+
+  for ( chain = &ar->table[af->hash & (ar->tablesize - 1)]; *chain; chain = &(*chain)->hnext )
+    {
+      if ( *chain == af )
+        {
+          *chain = af->hnext;
+          break;
+        }
+    }
+
+  if ( af->prev )
+    af->prev->next = af->next;
+  else
+    ar->head = af->next;
+
+  if ( af->next )
+    af->next->prev = af->prev;
+  else
+    ar->tail = af->prev;
+
+  if ( wb_close (&af->wb) )
+    ar->errors++;
+
+  ar->numopen--;
+
+  free (af->path);
+  free (af);
+}  /* End of ar_closefile() */
+
+
+/***************************************************************************
+ * ar_checkformat:
+ *
+ * Check that an archive format only contains known flags.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ar_checkformat (const char *format)
+{
+  const char *fp;
+
+  for ( fp = format; *fp; fp++ )
+    {
+      if ( *fp != '%' )
+        continue;
+
+      if ( ! *++fp || ! strchr ("nslcqYjHMS%", *fp) )
+        {
+          fprintf (stderr, "Unknown flag in archive format: '%%%c'\n",
+                   ( *fp ) ? *fp : ' ');
+          return -1;
+        }
+    }
+
+  return 0;
+}  /* End of ar_checkformat() */
+
+
+/***************************************************************************
+ * ar_mkdirs:
+ *
+ * Create any missing directories in the path of a file.  The parent
+ * directory is tried first, usually it exists or only it is missing.
+ * Only the first failure of an archive is reported, later records
+ * for the same directories would repeat it.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ar_mkdirs (Archive *ar, const char *path)
+{
+  char dir[AR_MAXPATH];
+  char *cp;
+
+  strncpy (dir, path, sizeof (dir) - 1);
+  dir[sizeof (dir) - 1] = '\0';
+
+  if ( ! (cp = strrchr (dir, '/')) || cp == dir )
+    return 0;
+
+  *cp = '\0';
+
+  if ( ar_mkdir (dir) == 0 || errno == EEXIST )
+    return 0;
+
+  if ( errno == ENOENT )
+    {
+      for ( cp = dir + 1; *cp; cp++ )
+        {
+          if ( *cp != '/' )
+            continue;
+
+          *cp = '\0';
+
+          if ( ar_mkdir (dir) && errno != EEXIST )
+            break;
+
+          *cp = '/';
+        }
+
+      if ( ! *cp && (ar_mkdir (dir) == 0 || errno == EEXIST) )
+        return 0;
+    }
+
+  if ( ar->errors == 0 )
+    fprintf (stderr, "Cannot create directory: %s (%s)\n",
+             dir, strerror(errno));
+
+  return -1;
+}  /* End of ar_mkdirs() */
+
+
+/***************************************************************************
+ * ar_hash:
+ *
+ * Returns the 32-bit FNV-1a hash of a path.
+ ***************************************************************************/
+static uint32_t
+ar_hash (const char *path)
+{
+  uint32_t hash = 2166136261u;
+
+  while ( *path )
+    {
+      hash ^= (uint8_t) *path++;
+      hash *= 16777619u;
+    }
+
+  return hash;
+}  /* End of ar_hash() */
@@ -0,0 +1,55 @@
+/***************************************************************************
+ * archive.h
+ *
+ * Declarations for writing records to an archive of files with paths
+ * derived from the record headers.
+ ***************************************************************************/
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H 1
+
+#include <stdint.h>
+
+#include "writebuffer.h"
+
+/* Layout of an SDS (SeisComP Data Structure) archive below its root */
+#define AR_SDSLAYOUT "%Y/%n/%s/%c.D/%n.%s.%l.%c.D.%Y.%j"
+
+/* Default maximum number of open archive files */
+#define AR_MAXOPEN 100
+
+/* Size of the output buffer of each open archive file */
+#define AR_BUFSIZE 65536
+
+/* Maximum length of an archive file path */
+#define AR_MAXPATH 1024
+
+/* An open archive file, in a hash chain and the list of open files */
+typedef struct ArchiveFile_s {
+  char     *path;               /* Path of file */
+  uint32_t  hash;               /* Hash of path */
+  WriteBuffer *wb;              /* Output for file */
+  struct ArchiveFile_s *hnext;  /* Next file in hash chain */
+  struct ArchiveFile_s *prev;   /* More recently used file */
+  struct ArchiveFile_s *next;   /* Less recently used file */
+} ArchiveFile;
+
+/* Archive of files with paths created from a format, a limited number
+ * of files is kept open and the least recently used file is closed
+ * when another is needed */
+typedef struct Archive_s {
+  char     *format;             /* Path format */
+  int       maxopen;            /* Maximum number of open files */
+  int       numopen;            /* Number of open files */
+  ArchiveFile **table;          /* Hash table of open files */
+  uint32_t  tablesize;          /* Number of hash table entries, a power of 2 */
+  ArchiveFile *head;            /* Most recently used file */
+  ArchiveFile *tail;            /* Least recently used file */
+  int64_t   errors;             /* Count of failed writes and closes */
+} Archive;
+
+extern Archive *ar_init (const char *format, int maxopen);
+extern int ar_write (Archive *ar, const char *record, int reclen);
+extern int ar_close (Archive **ar);
+
+#endif /* ARCHIVE_H */
@@ -5,7 +5,7 @@
  *
  * Written by Chad Trabant, IRIS Data Management Center
  *
- * modified 2015.148
+ * modified 2026.289
  ***************************************************************************/
 
 #include <stdio.h>
@@ -17,7 +17,16 @@
 
 #include <libmseed.h>
 
-#define VERSION "1.5"
+#include "readbuffer.h"
+#include "parsenum.h"
+#include "timeparse.h"
+#include "writebuffer.h"
+#include "archive.h"
+#include "taskpool.h"
+#include "segindex.h"
+#include "stats.h"
+
+#define VERSION "1.6dev"
 #define PACKAGE "ascii2mseed"
 
 struct listnode {
@@ -26,12 +35,70 @@ struct listnode {
   struct listnode *next;
 };
 
-static void packtraces (MSTraceGroup *mstg, flag flush);
+/* State for reading the samples of a TIMESERIES segment, allowing
+ * the samples to be read in multiple calls */
+typedef struct SampleReader_s {
+  ReadBuffer *rb;               /* Input buffer */
+  char      listtype;           /* Sample list type: 'S' (SLIST), 'T' (TSPAIR) or 'B' (BINARY) */
+  flag      swapflag;           /* Flag to swap byte order of BINARY samples */
+  char      datatype;           /* Sample type: 'i', 'f' or 'd' */
+  double    samprate;           /* Declared sample rate */
+  int64_t   samplecnt;          /* Declared sample count */
+  int64_t   samplesread;        /* Count of samples read */
+  char     *line;               /* Current, partially parsed SLIST line */
+  char     *lineend;            /* End of current SLIST line */
+  char     *cp;                 /* Next character to parse, NULL for new line */
+  int       linesamples;        /* Count of samples parsed from current line */
+  hptime_t  prevtime;           /* Time of previous TSPAIR sample */
+  TimeCache timecache;          /* TSPAIR time stamp parser state */
+  hptime_t  mindelta;           /* Shortest TSPAIR sample interval tolerated */
+  hptime_t  maxdelta;           /* Longest TSPAIR sample interval tolerated */
+  int64_t   tracesamples;       /* Count of TSPAIR samples read for current trace */
+  hptime_t  gaptime;            /* Time of first sample after a TSPAIR gap or HPTERROR */
+  Stats    *stats;              /* Statistics for stage times, NULL if not reporting */
+} SampleReader;
+
+/* Conversion state and results for an input file or a segment of a file */
+typedef struct PackJob_s {
+  char     *infile;             /* Input file name */
+  int64_t   offset;             /* Offset of segment in file */
+  int64_t   length;             /* Length of segment, 0 for the remainder of file */
+  int64_t   startline;          /* Line number of segment header */
+  int       filesegments;       /* Count of segment jobs for file, 0 for whole file */
+  int64_t   packedtraces;       /* Count of packed traces */
+  int64_t   packedsamples;      /* Count of packed samples */
+  int64_t   packedrecords;      /* Count of packed records */
+  flag      buffered;           /* Flag to buffer records instead of writing */
+  char     *recbuf;             /* Buffer of packed records */
+  size_t    recbuflength;       /* Length of records in buffer */
+  size_t    recbufsize;         /* Allocated size of buffer */
+  int       retval;             /* Return value of packascii() */
+  Stats     stats;              /* Statistics of conversion */
+  struct PackJob_s *next;       /* Next job in list */
+} PackJob;
+
+static PackJob *newjob (char *infile, flag buffered);
+static void finishjob (PackJob *job);
+static void finishgroup (PackJob *group);
+static void addfilestats (char *infile);
+static void runjob (void *task);
+static int packparallel (int threadcount);
+static int segmentjobs (char *infile, PackJob **joblist);
+static int64_t packtrace (PackJob *job, MSTrace *mst, flag flush);
+static void packtraces (PackJob *job, MSTraceGroup *mstg, flag flush);
+static int streamtrace (PackJob *job, SampleReader *sr, MSTrace **ppmst);
+static MSTrace *nexttrace (MSTrace *mst, hptime_t starttime);
+static void freetrace (MSTrace **mst);
 static void freetraces (MSTraceGroup *mstg);
-static int packascii (char *infile);
+static int packascii (PackJob *job);
 static int setheadervalues (char *flags, MSRecord *msr);
-static int readslist (FILE *ifp, void *data, char datatype, int32_t datacnt);
-static int readtspair (FILE *ifp, void *data, char datatype, int32_t datacnt, double samprate);
+static int readsamples (SampleReader *sr, void *data, int64_t count);
+static int readslist (SampleReader *sr, void *data, int64_t count);
+static int readtspair (SampleReader *sr, void *data, int64_t count);
+static int readbinary (SampleReader *sr, void *data, int64_t count);
+static void tspairdeltas (SampleReader *sr);
+static int parsesample (char **cp, char *end, void *data, char datatype, int64_t dataidx);
+static void badvalue (ReadBuffer *rb, char *line, char *lineend, char *cp, const char *message);
 static int parameter_proc (int argcount, char **argvec);
 static char *getoptval (int argcount, char **argvec, int argopt);
 static int readlistfile (char *listfile);
@@ -47,8 +114,16 @@ static int   packreclen  = -1;
 static int   encoding    = 11;
 static int   byteorder   = -1;
 static char  srateblkt   = 0;
+static int64_t chunksamples = 0;
+static int   threads     = 1;
 static char *outputfile  = 0;
-static FILE *ofp         = 0;
+static size_t outbufsize = 0;
+static int   outdirect   = 0;
+static WriteBuffer *ofb  = 0;
+static char *archiveformat = 0;
+static int   archivemaxopen = 0;
+static Archive *archive  = 0;
+static char *reportfile  = 0;
 
 /* A list of input files */
 struct listnode *filelist = 0;
@@ -57,40 +132,56 @@ static int64_t packedtraces  = 0;
 static int64_t packedsamples = 0;
 static int64_t packedrecords = 0;
 
+/* Statistics for each input file, when reporting */
+static Stats *filestats     = 0;
+static Stats *filestatstail = 0;
+
 int
 main (int argc, char **argv)
 {
   struct listnode *flp;
+  PackJob *job;
+  double starttime;
   
   /* Process given parameters (command line and parameter file) */
   if (parameter_proc (argc, argv) < 0)
     return -1;
   
+  starttime = st_now ();
+  
   /* Open the output file if specified */
   if ( outputfile )
     {
-      if ( strcmp (outputfile, "-") == 0 )
-        {
-          ofp = stdout;
-        }
-      else if ( (ofp = fopen (outputfile, "wb")) == NULL )
-        {
-          fprintf (stderr, "Cannot open output file: %s (%s)\n",
-                   outputfile, strerror(errno));
-          return -1;
-        }
+      if ( (ofb = wb_open (outputfile, outbufsize, ( outdirect ) ? WB_DIRECT : 0)) == NULL )
+        return -1;
+    }
+  
+  /* Initialize the output archive if specified */
+  if ( archiveformat )
+    {
+      if ( (archive = ar_init (archiveformat, archivemaxopen)) == NULL )
+        return -1;
     }
   
   /* Read and convert input files */
-  flp = filelist;
-  while ( flp != 0 )
+  if ( threads > 1 )
     {
-      if ( verbose )
-	fprintf (stderr, "Reading %s\n", flp->data);
-      
-      packascii (flp->data);
-      
-      flp = flp->next;
+      if ( packparallel (threads) )
+	return -1;
+    }
+  else
+    {
+      flp = filelist;
+      while ( flp != 0 )
+	{
+	  if ( (job = newjob (flp->data, 0)) == NULL )
+	    return -1;
+	  
+	  runjob (job);
+	  finishjob (job);
+	  
+	  flp = flp->next;
+	}
     }
   
   fprintf (stderr, "Packed %lld trace(s) of %lld samples into %lld records\n",
@@ -98,55 +189,761 @@ main (int argc, char **argv)
            (long long int)packedsamples,
            (long long int)packedrecords);
   
-  /* Make sure everything is cleaned up */
-  if ( ofp )
-    fclose (ofp);
+  /* Make sure everything is cleaned up, reporting any write errors */
+  if ( ofb && wb_close (&ofb) )
+    return -1;
+  
+  if ( archive && ar_close (&archive) )
+    return -1;
+  
+  /* Report statistics including the time to flush output */
+  if ( reportfile )
+    {
+      if ( st_report (reportfile, filestats, st_now () - starttime) )
+	return -1;
+      
+      st_free (&filestats);
+    }
   
   return 0;
 }  /* End of main() */
 
 
 /***************************************************************************
- * packtraces:
+ * newjob:
  *
- * Pack all traces in a group using per-MSTrace templates.
+ * Allocate and initialize a conversion job for an input file.  If
+ * buffered is true packed records are collected in the job instead
+ * of being written to the output file and archive.
  *
- * Returns 0 on success, and -1 on failure
+ * Returns a new PackJob on success and NULL on error.
+ ***************************************************************************/
+static PackJob *
+newjob (char *infile, flag buffered)
+{
+  PackJob *job;
+  
+  if ( ! (job = (PackJob *) calloc (1, sizeof(PackJob))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for job\n");
+      return NULL;
+    }
+  
+  job->infile = infile;
+  job->buffered = ( buffered && (ofb || archive) ) ? 1 : 0;
+  
+  return job;
+}  /* End of newjob() */
+
+
+/***************************************************************************
+ * finishjob:
+ *
+ * Write any buffered records of a job to the output file and archive,
+ * add the job counts to the totals and free the job.  When reporting,
+ * the job statistics are added to a new entry for a whole file or to
+ * the last entry, created by finishgroup(), for a segment job.
  ***************************************************************************/
 static void
-packtraces (MSTraceGroup *mstg, flag flush)
+finishjob (PackJob *job)
 {
-  MSTrace *mst;
-  int64_t trpackedsamples = 0;
-  int64_t trpackedrecords = 0;
+  size_t offset;
+  int reclen;
+  double start = 0.0;
+  
+  if ( ! job )
+    return;
+  
+  if ( reportfile )
+    start = st_now ();
+  
+  if ( job->recbuflength > 0 && ofb )
+    wb_write (ofb, job->recbuf, job->recbuflength);
+  
+  /* Route each buffered record to its archive file */
+  if ( archive )
+    {
+      for ( offset = 0; offset < job->recbuflength; offset += reclen )
+	{
+	  reclen = ms_detect (job->recbuf + offset, job->recbuflength - offset);
+	  
+	  if ( reclen <= 0 )
+	    {
+	      fprintf (stderr, "Cannot determine length of buffered record\n");
+	      break;
+	    }
+	  
+	  ar_write (archive, job->recbuf + offset, reclen);
+	}
+    }
+  
+  if ( reportfile )
+    {
+      if ( job->recbuflength > 0 )
+	job->stats.seconds[ST_WRITE] += st_now () - start;
+      
+      job->stats.traces = job->packedtraces;
+      job->stats.samples = job->packedsamples;
+      job->stats.records = job->packedrecords;
+      
+      if ( job->filesegments == 0 || ! filestatstail )
+	addfilestats (job->infile);
+      
+      st_merge (filestatstail, &job->stats);
+    }
+  
+  packedtraces += job->packedtraces;
+  packedsamples += job->packedsamples;
+  packedrecords += job->packedrecords;
+  
+  if ( job->recbuf )
+    free (job->recbuf);
+  
+  st_clear (&job->stats);
+  free (job);
+}  /* End of finishjob() */
 
-  mst = mstg->traces;
-  while ( mst )
+
+/***************************************************************************
+ * finishgroup:
+ *
+ * Finish a list of segment jobs for a single file.  To produce the
+ * same output as serial conversion, when records are packed after
+ * reading the entire file no segments are written if any segment
+ * failed, and when streaming the segments following a failure are
+ * discarded.
+ ***************************************************************************/
+static void
+finishgroup (PackJob *group)
+{
+  PackJob *job;
+  flag failed = 0;
+  
+  if ( reportfile && group )
+    addfilestats (group->infile);
+  
+  if ( chunksamples <= 0 )
     {
-      if ( mst->numsamples <= 0 )
+      for ( job = group; job; job = job->next )
+	if ( job->retval )
+	  failed = 1;
+    }
+  
+  while ( group )
+    {
+      job = group;
+      group = job->next;
+      
+      if ( failed )
 	{
-	  mst = mst->next;
+	  if ( job->recbuf )
+	    free (job->recbuf);
+	  st_clear (&job->stats);
+	  free (job);
 	  continue;
 	}
       
-      trpackedrecords = mst_pack (mst, &record_handler, 0, packreclen, encoding, byteorder,
-				  &trpackedsamples, flush, verbose-2, (MSRecord *) mst->prvtptr);
+      if ( job->retval )
+	failed = 1;
+      
+      finishjob (job);
+    }
+}  /* End of finishgroup() */
+
+
+/***************************************************************************
+ * addfilestats:
+ *
+ * Add an entry to the list of input file statistics, the entry is
+ * the tail of the list.  On allocation failure the previous tail is
+ * retained.
+ ***************************************************************************/
+static void
+addfilestats (char *infile)
+{
+  Stats *st;
+  
+  if ( (st = st_new (infile)) == NULL )
+    return;
+  
+  if ( filestatstail )
+    filestatstail->next = st;
+  else
+    filestats = st;
+  filestatstail = st;
+}  /* End of addfilestats() */
+
+
+/***************************************************************************
+ * runjob:
+ *
+ * Run a conversion job, called directly for serial conversion and by
+ * task pool worker threads.
+ ***************************************************************************/
+static void
+runjob (void *task)
+{
+  PackJob *job = (PackJob *) task;
+  double start = 0.0;
+  
+  if ( reportfile )
+    start = st_now ();
+  
+  /* A failure may already be set by record_handler() */
+  if ( packascii (job) )
+    job->retval = -1;
+  
+  if ( reportfile )
+    job->stats.elapsed = st_now () - start;
+}  /* End of runjob() */
+
+
+/***************************************************************************
+ * packparallel:
+ *
+ * Convert all input files using a pool of worker threads.  Files
+ * containing multiple TIMESERIES segments are split into a job per
+ * segment, submitted in the order that mst_groupsort() would arrange
+ * the traces (or input order when streaming).  Records are buffered
+ * by the workers and written in submission order, producing the same
+ * output as serial conversion.  The number of jobs in progress is
+ * limited to twice the thread count to bound memory usage, but all
+ * records of a job are held until it is written, also when streaming.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+packparallel (int threadcount)
+{
+  TaskPool *tp;
+  PackJob *job;
+  PackJob *joblist;
+  PackJob *group = 0;
+  PackJob *grouptail = 0;
+  int groupcount = 0;
+  struct listnode *flp;
+  int retval = 0;
+  
+  if ( (tp = tp_init (threadcount, runjob)) == NULL )
+    return -1;
+  
+  flp = filelist;
+  while ( flp != 0 && retval == 0 )
+    {
+      /* Locate segments, an unreadable file is skipped as in serial conversion */
+      joblist = 0;
+      if ( segmentjobs (flp->data, &joblist) < 0 )
+	{
+	  flp = flp->next;
+	  continue;
+	}
+      
+      /* Convert whole file when a single segment is present */
+      if ( ! joblist && (joblist = newjob (flp->data, 1)) == NULL )
+	{
+	  retval = -1;
+	  break;
+	}
+      
+      while ( joblist )
+	{
+	  /* Collect a completed job when the limit of jobs in progress is reached */
+	  while ( tp_pending (tp) >= 2 * threadcount )
+	    {
+	      job = (PackJob *) tp_collect (tp);
+	      
+	      if ( job->filesegments == 0 )
+		{
+		  finishjob (job);
+		  continue;
+		}
+	      
+	      /* Hold segment jobs until all segments of the file are complete */
+	      job->next = 0;
+	      if ( grouptail )
+		grouptail->next = job;
+	      else
+		group = job;
+	      grouptail = job;
+	      
+	      if ( ++groupcount == job->filesegments )
+		{
+		  finishgroup (group);
+		  group = grouptail = 0;
+		  groupcount = 0;
+		}
+	    }
+	  
+	  job = joblist;
+	  joblist = job->next;
+	  
+	  if ( tp_submit (tp, job) )
+	    {
+	      free (job);
+	      while ( joblist )
+		{
+		  job = joblist;
+		  joblist = job->next;
+		  free (job);
+		}
+	      retval = -1;
+	      break;
+	    }
+	}
+      
+      flp = flp->next;
+    }
+  
+  /* Write remaining jobs */
+  while ( (job = (PackJob *) tp_collect (tp)) )
+    {
+      if ( job->filesegments == 0 )
+	{
+	  finishjob (job);
+	  continue;
+	}
+      
+      job->next = 0;
+      if ( grouptail )
+	grouptail->next = job;
+      else
+	group = job;
+      grouptail = job;
+      
+      if ( ++groupcount == job->filesegments )
+	{
+	  finishgroup (group);
+	  group = grouptail = 0;
+	  groupcount = 0;
+	}
+    }
+  
+  /* Incomplete group after a submission failure */
+  if ( group )
+    finishgroup (group);
+  
+  tp_free (&tp);
+  
+  return retval;
+}  /* End of packparallel() */
+
+
+/***************************************************************************
+ * segmentjobs:
+ *
+ * Index the TIMESERIES segments of an input file and create a job for
+ * each segment, covering the header line up to the next header or the
+ * end of the file.  Unless streaming, the jobs are ordered as the
+ * traces would be sorted by mst_groupsort() so that records are
+ * written in the same order as serial conversion.
+ *
+ * If the file contains fewer than two segments, or unless streaming
+ * any TSPAIR segments, no jobs are created and the file should be
+ * converted as a whole.
+ *
+ * Returns the number of jobs on success, and -1 on failure
+ ***************************************************************************/
+static int
+segmentjobs (char *infile, PackJob **joblist)
+{
+  SegmentIndex *si;
+  SegmentEntry *entry;
+  MSTraceGroup *mstg = 0;
+  MSTrace *mst;
+  PackJob *job;
+  PackJob *head = 0;
+  PackJob *tail = 0;
+  hptime_t hpdelta;
+  int segments;
+  int retval = 0;
+  int idx;
+  
+  *joblist = 0;
+  
+  if ( verbose )
+    fprintf (stderr, "Reading %s\n", infile);
+  
+  if ( (si = si_build (infile)) == NULL )
+    return -1;
+  
+  if ( (segments = si->count) < 2 )
+    {
+      si_free (&si);
+      return 0;
+    }
+  
+  /* A TSPAIR segment split at a gap produces traces that are sorted
+   * among the other segments, convert the file as a whole */
+  if ( chunksamples <= 0 )
+    {
+      for ( idx = 0; idx < si->count; idx++ )
+	{
+	  if ( ! strncmp (si->entries[idx].hdr.listtype, "TSPAIR", 6) )
+	    {
+	      si_free (&si);
+	      return 0;
+	    }
+	}
+    }
+  
+  mstg = mst_initgroup (mstg);
+  
+  for ( idx = 0; idx < si->count; idx++ )
+    {
+      entry = &si->entries[idx];
+      
+      if ( (job = newjob (infile, 1)) == NULL )
+	{
+	  retval = -1;
+	  break;
+	}
+      
+      job->offset = entry->offset;
+      job->length = entry->length;
+      job->startline = entry->linenum;
+      job->filesegments = segments;
+      
+      if ( tail )
+	tail->next = job;
+      else
+	head = job;
+      tail = job;
+      
+      /* Records are written in input order when streaming */
+      if ( chunksamples > 0 )
+	continue;
+      
+      /* Create a trace with the sort values of the segment, the same
+       * values are set when the segment is converted */
+      if ( ! (mst = mst_init (NULL)) )
+	{
+	  fprintf (stderr, "Cannot initialize MSTrace strcture\n");
+	  retval = -1;
+	  break;
+	}
+      
+      mst_addtracetogroup (mstg, mst);
+      mst->prvtptr = job;
       
-      if ( trpackedrecords < 0 )
+      if ( ms_splitsrcname (entry->hdr.srcname, mst->network, mst->station, mst->location, mst->channel, &(mst->dataquality)) )
 	{
-	  fprintf (stderr, "Error packing data\n");
+	  fprintf (stderr, "Cannot parse channel source name: %s (improperly specified?)\n", entry->hdr.srcname);
+	  retval = -1;
+	  break;
+	}
+      
+      mst->samprate = entry->hdr.samplerate;
+      
+      if ( (mst->starttime = ms_timestr2hptime (entry->hdr.timestr)) == HPTERROR )
+	{
+	  fprintf (stderr, "Error converting start time: %s\n", entry->hdr.timestr);
+	  retval = -1;
+	  break;
+	}
+      
+      hpdelta = ( mst->samprate ) ? (hptime_t) (HPTMODULUS / mst->samprate) : 0;
+      mst->endtime = mst->starttime + (entry->hdr.samplecnt - 1) * hpdelta;
+    }
+  
+  si_free (&si);
+  
+  /* Order jobs as sorted traces */
+  if ( retval == 0 && chunksamples <= 0 )
+    {
+      if ( mst_groupsort (mstg, 1) )
+	{
+	  fprintf (stderr, "[%s] Error sorting traces\n", infile);
+	  retval = -1;
 	}
       else
 	{
-	  packedrecords += trpackedrecords;
-	  packedsamples += trpackedsamples;
+	  head = tail = 0;
+	  for ( mst = mstg->traces; mst; mst = mst->next )
+	    {
+	      job = (PackJob *) mst->prvtptr;
+	      job->next = 0;
+	      
+	      if ( tail )
+		tail->next = job;
+	      else
+		head = job;
+	      tail = job;
+	    }
+	}
+    }
+  
+  /* Jobs are not owned by the traces */
+  for ( mst = mstg->traces; mst; mst = mst->next )
+    mst->prvtptr = 0;
+  mst_freegroup (&mstg);
+  
+  if ( retval )
+    {
+      while ( head )
+	{
+	  job = head;
+	  head = job->next;
+	  free (job);
 	}
       
+      return -1;
+    }
+  
+  *joblist = head;
+  
+  return segments;
+}  /* End of segmentjobs() */
+
+
+/***************************************************************************
+ * packtrace:
+ *
+ * Pack a trace using the per-MSTrace template, which also holds the
+ * encoding format for the trace.  If flush is false
+ * only full records are packed and any remaining samples are left in
+ * the trace.
+ *
+ * Returns the number of samples packed on success, and -1 on failure
+ ***************************************************************************/
+static int64_t
+packtrace (PackJob *job, MSTrace *mst, flag flush)
+{
+  MSRecord *msr = (MSRecord *) mst->prvtptr;
+  ChannelStats *cs;
+  char srcname[50];
+  int64_t trpackedsamples = 0;
+  int64_t trpackedrecords = 0;
+  int64_t bytesout = job->stats.bytesout;
+  double writetime = job->stats.seconds[ST_WRITE];
+  double start = 0.0;
+  
+  if ( reportfile )
+    start = st_now ();
+  
+  trpackedrecords = mst_pack (mst, &record_handler, job, packreclen, msr->encoding, byteorder,
+			      &trpackedsamples, flush, verbose-2, msr);
+  
+  if ( trpackedrecords < 0 )
+    {
+      fprintf (stderr, "Error packing data\n");
+      return -1;
+    }
+  
+  /* Records were dropped if the job record buffer could not be grown */
+  if ( job->retval )
+    return -1;
+  
+  job->packedrecords += trpackedrecords;
+  job->packedsamples += trpackedsamples;
+  
+  /* Encoding time excludes the time in record_handler() */
+  if ( reportfile )
+    {
+      job->stats.seconds[ST_ENCODE] += st_now () - start -
+	(job->stats.seconds[ST_WRITE] - writetime);
+      
+      if ( (cs = st_channel (&job->stats, mst_srcname (mst, srcname, 0))) )
+	{
+	  cs->samples += trpackedsamples;
+	  cs->records += trpackedrecords;
+	  cs->bytesout += job->stats.bytesout - bytesout;
+	}
+    }
+  
+  return trpackedsamples;
+}  /* End of packtrace() */
+
+
+/***************************************************************************
+ * packtraces:
+ *
+ * Pack all traces in a group using per-MSTrace templates.
+ ***************************************************************************/
+static void
+packtraces (PackJob *job, MSTraceGroup *mstg, flag flush)
+{
+  MSTrace *mst;
+  
+  mst = mstg->traces;
+  while ( mst && ! job->retval )
+    {
+      if ( mst->numsamples > 0 )
+	packtrace (job, mst, flush);
+      
       mst = mst->next;
     }
 }  /* End of packtraces() */
 
 
+/***************************************************************************
+ * streamtrace:
+ *
+ * Read the samples of a segment in chunks of chunksamples, packing
+ * full records after each chunk is read and flushing the remaining
+ * samples at the end of the segment.  Only the current chunk and a
+ * partial record of samples are held in memory.
+ *
+ * Record start times are calculated relative to the segment start in
+ * the same way as when the entire segment is packed at once.
+ *
+ * At a TSPAIR gap the trace is flushed and replaced with a new trace
+ * starting at the gap, the trace at *ppmst is the last one read.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+streamtrace (PackJob *job, SampleReader *sr, MSTrace **ppmst)
+{
+  MSTrace *mst = *ppmst;
+  hptime_t segstarttime = mst->starttime;
+  int64_t segpackedsamples = 0;
+  int64_t trpackedsamples;
+  int64_t readcount;
+  int64_t samplesread;
+  int samplesize;
+  void *datasamples;
+  flag flush;
+  
+  samplesize = ms_samplesize (mst->sampletype);
+  mst->numsamples = 0;
+  mst->samplecnt = 0;
+  
+  while ( sr->samplesread < sr->samplecnt )
+    {
+      /* Start a new trace at a gap */
+      if ( sr->gaptime != HPTERROR )
+	{
+	  if ( ! (*ppmst = nexttrace (mst, sr->gaptime)) )
+	    {
+	      *ppmst = mst;
+	      return -1;
+	    }
+	  
+	  freetrace (&mst);
+	  mst = *ppmst;
+	  mst->numsamples = 0;
+	  mst->samplecnt = 0;
+	  segstarttime = mst->starttime;
+	  segpackedsamples = 0;
+	  sr->gaptime = HPTERROR;
+	  job->packedtraces++;
+	}
+      
+      readcount = sr->samplecnt - sr->samplesread;
+      if ( readcount > chunksamples )
+	readcount = chunksamples;
+      
+      /* Grow data buffer for chunk, unpacked samples remain at the front */
+      datasamples = realloc (mst->datasamples, (size_t)((mst->numsamples + readcount) * samplesize));
+      if ( ! datasamples )
+	{
+	  fprintf (stderr, "Cannot allocate memory for data samples\n");
+	  return -1;
+	}
+      mst->datasamples = datasamples;
+      
+      samplesread = sr->samplesread;
+      
+      if ( readsamples (sr, (char *)mst->datasamples + mst->numsamples * samplesize, readcount) )
+	{
+	  fprintf (stderr, "Error reading samples from file\n");
+	  return -1;
+	}
+      
+      /* Fewer samples are read when stopping at a gap */
+      mst->numsamples += sr->samplesread - samplesread;
+      mst->samplecnt = mst->numsamples;
+      
+      flush = ( sr->samplesread >= sr->samplecnt || sr->gaptime != HPTERROR );
+      
+      if ( (trpackedsamples = packtrace (job, mst, flush)) < 0 )
+	return -1;
+      
+      /* Set start time of remaining samples relative to segment start */
+      if ( trpackedsamples > 0 && mst->samprate > 0.0 )
+	{
+	  segpackedsamples += trpackedsamples;
+	  mst->starttime = segstarttime +
+	    (hptime_t) (segpackedsamples / mst->samprate * HPTMODULUS + 0.5);
+	}
+    }
+  
+  return 0;
+}  /* End of streamtrace() */
+
+
+/***************************************************************************
+ * nexttrace:
+ *
+ * Create a new, empty trace for the samples following a gap in a
+ * segment.  The identifiers, sample rate and type are copied from the
+ * specified trace and it receives a copy of the template MSRecord as
+ * it was before packing, so that the records are the same as for a
+ * separate segment starting at the gap.
+ *
+ * Returns the new MSTrace on success, and NULL on failure
+ ***************************************************************************/
+static MSTrace *
+nexttrace (MSTrace *mst, hptime_t starttime)
+{
+  MSTrace *newmst;
+  MSRecord *msr;
+  
+  if ( ! (newmst = mst_init (NULL)) )
+    {
+      fprintf (stderr, "Cannot initialize MSTrace strcture\n");
+      return NULL;
+    }
+  
+  strcpy (newmst->network, mst->network);
+  strcpy (newmst->station, mst->station);
+  strcpy (newmst->location, mst->location);
+  strcpy (newmst->channel, mst->channel);
+  newmst->dataquality = mst->dataquality;
+  newmst->type = mst->type;
+  newmst->samprate = mst->samprate;
+  newmst->sampletype = mst->sampletype;
+  newmst->starttime = starttime;
+  newmst->endtime = starttime;
+  
+  if ( ! (msr = msr_duplicate ((MSRecord *) mst->prvtptr, 0)) )
+    {
+      fprintf (stderr, "Cannot duplicate MSRecord template\n");
+      mst_free (&newmst);
+      return NULL;
+    }
+  
+  msr->sequence_number = 0;
+  newmst->prvtptr = msr;
+  
+  return newmst;
+}  /* End of nexttrace() */
+
+
+/***************************************************************************
+ * freetrace:
+ *
+ * Free a trace including the per-MSTrace template.
+ ***************************************************************************/
+static void
+freetrace (MSTrace **mst)
+{
+  MSRecord *msr;
+  
+  if ( ! mst || ! *mst )
+    return;
+  
+  if ( (*mst)->prvtptr )
+    {
+      msr = (MSRecord *)(*mst)->prvtptr;
+      msr_free (&msr);
+      (*mst)->prvtptr = 0;
+    }
+  
+  mst_free (mst);
+}  /* End of freetrace() */
+
+
 /***************************************************************************
  * freetraces:
  *
@@ -186,165 +983,181 @@ freetraces (MSTraceGroup *mstg)
  * Returns 0 on success, and -1 on failure
  ***************************************************************************/
 static int
-packascii (char *infile)
+packascii (PackJob *job)
 {
-  FILE *ifp = 0;
+  char *infile = job->infile;
+  ReadBuffer *rb = 0;
   MSRecord *msr = 0;
   MSTrace *mst = 0;
   MSTraceGroup *mstg = 0;
   struct blkt_1000_s Blkt1000;
   struct blkt_1001_s Blkt1001;
   struct blkt_100_s Blkt100;
-  int fields;
-  
-  char *cp;
-  char rdline[350];
+  SampleReader sr;
+  SegmentHeader hdr;
+  ChannelStats *cs = 0;
   char srcname[50];
-  char timestr[50];
-  char listtype[20];
-  char sampletype[20];
-  char unitstr[20];
-  char flagstr[100];
-  double samplerate;
+  int64_t startoffset;
+  int64_t segoffset = 0;
+  double start = 0.0;
+  int retval = -1;
+  
+  char *line;
+  char *lineend;
   int samplecnt;
+  int trencoding = encoding;
+  int samplesize;
+  int64_t remaining;
+  void *datasamples;
   hptime_t hpdelta;
   
+  if ( verbose && job->filesegments == 0 )
+    fprintf (stderr, "Reading %s\n", infile);
+  
   /* Init MSTraceGroup */
   mstg = mst_initgroup (mstg);
   
   /* Open input file */
-  if ( (ifp = fopen (infile, "rb")) == NULL )
+  if ( (rb = rb_open (infile, 0)) == NULL )
     {
-      fprintf (stderr, "Cannot open input file: %s (%s)\n",
-	       infile, strerror(errno));
-      return -1;
+      goto cleanup;
     }
   
-  while ( fgets (rdline, sizeof(rdline), ifp) )
+  /* Limit reading to the segment range, keeping line numbers relative to the file */
+  if ( job->filesegments > 0 )
     {
-      // TIMESERIES TA_J15A__BHZ_R, 635 samples, 40 sps, 2008-01-15T00:00:00.025000, SLIST, INTEGER[, Counts[, Flags]]
-      // TIMESERIES TA_J15A__BHZ_R, 635 samples, 40 sps, 2008-01-15T00:00:00.025000, TSPAIR, INTEGER[, Counts[, Flags]]
-      
-      /* Terminate input string at first newline or carriage return */
-      cp = rdline;
-      while ( *cp && *cp != '\r' && *cp != '\n' ) cp++;
-      *cp = '\0';
-      
-      unitstr[0] = '\0';
-      flagstr[0] = '\0';
-      fields = sscanf (rdline, "TIMESERIES %[^,], %d samples, %lf sps, %[^,], %[^,], %[^,], %[^,], %s",
-		       srcname, &samplecnt, &samplerate, timestr, listtype, sampletype, unitstr, flagstr);
+      if ( rb_setrange (rb, job->offset, job->length) )
+	{
+	  goto cleanup;
+	}
       
-      //fprintf (stderr, "TIMESERIES (%d), unitstr: '%s', flagstr: '%s'\n", fields, unitstr, flagstr);
+      rb->linenum = job->startline - 1;
+    }
+  
+  rb->timing = ( reportfile ) ? 1 : 0;
+  startoffset = rb_tell (rb);
+  
+  while ( rb_findline (rb, "TIMESERIES", &line, &lineend) > 0 )
+    {
+      /* Input from the previous header to this one is counted for its channel */
+      if ( cs )
+	cs->bytesin += (rb->bufoffset + (line - rb->buffer)) - segoffset;
+      cs = 0;
       
-      if ( fields >= 6 )
+      if ( si_parseheader (line, lineend, &hdr) >= 6 )
 	{
+	  samplecnt = hdr.samplecnt;
+	  
+	  if ( samplecnt <= 0 )
+	    {
+	      fprintf (stderr, "[%s] Invalid sample count for %s: %d\n", infile, hdr.srcname, samplecnt);
+	      goto cleanup;
+	    }
+	  
 	  /* Initialize new MSTrace holder */
 	  if ( ! (mst = mst_init(NULL)) )
 	    {
 	      fprintf (stderr, "Cannot initialize MSTrace strcture\n");
-	      return -1;
+	      goto cleanup;
 	    }
           
 	  /* Split source name into separate quantities for the MSTrace */
-	  if ( ms_splitsrcname (srcname, mst->network, mst->station, mst->location, mst->channel, &(mst->dataquality)) )
+	  if ( ms_splitsrcname (hdr.srcname, mst->network, mst->station, mst->location, mst->channel, &(mst->dataquality)) )
 	    {
-	      fprintf (stderr, "Cannot parse channel source name: %s (improperly specified?)\n", srcname);
-	      return -1;
+	      fprintf (stderr, "Cannot parse channel source name: %s (improperly specified?)\n", hdr.srcname);
+	      goto cleanup;
 	    }
 	  
           mst->samplecnt = samplecnt;
 	  mst->numsamples = samplecnt;
-	  mst->samprate = samplerate;
+	  mst->samprate = hdr.samplerate;
 
 	  /* Convert time string to a high-precision time value */
-	  mst->starttime = ms_timestr2hptime (timestr);
+	  mst->starttime = ms_timestr2hptime (hdr.timestr);
 	  if ( mst->starttime == HPTERROR )
 	    {
-	      fprintf (stderr, "Error converting start time: %s\n", timestr);
-	      return -1;
+	      fprintf (stderr, "Error converting start time: %s\n", hdr.timestr);
+	      goto cleanup;
 	    }
           
           hpdelta = ( mst->samprate ) ? (hptime_t) (HPTMODULUS / mst->samprate) : 0;
           mst->endtime = mst->starttime + (samplecnt - 1) * hpdelta;
 	  
 	  /* Determine sample type */
-	  if ( ! strncasecmp (sampletype, "INTEGER", 7) )
+	  if ( ! strncasecmp (hdr.sampletype, "INTEGER", 7) )
 	    {
 	      mst->sampletype = 'i';
+	      trencoding = encoding;
 	    }
-	  else if ( ! strncasecmp (sampletype, "FLOAT64", 7) )
+	  else if ( ! strncasecmp (hdr.sampletype, "FLOAT64", 7) )
 	    {
 	      mst->sampletype = 'd';
-	      encoding = 5;
+	      trencoding = 5;
 	    }
-	  else if ( ! strncasecmp (sampletype, "FLOAT", 5) )
+	  else if ( ! strncasecmp (hdr.sampletype, "FLOAT", 5) )
 	    {
 	      mst->sampletype = 'f';
-	      encoding = 4;
+	      trencoding = 4;
 	    }
 	  else
 	    {
-	      fprintf (stderr, "Unrecognized data sample type: '%s'\n", sampletype);
-	      return -1;
+	      fprintf (stderr, "Unrecognized data sample type: '%s'\n", hdr.sampletype);
+	      goto cleanup;
 	    }
 	  
-	  /* Allocate memory for the data samples */
-	  if ( ! (mst->datasamples = calloc (mst->numsamples, ms_samplesize(mst->sampletype))) )
-	    {
-	      fprintf (stderr, "Cannot allocate memory for data samples\n");
-	      return -1;
-	    }
+	  /* Initialize sample reader for this segment */
+	  memset (&sr, 0, sizeof(SampleReader));
+	  sr.rb = rb;
+	  sr.datatype = mst->sampletype;
+	  sr.samprate = mst->samprate;
+	  sr.samplecnt = samplecnt;
+	  sr.prevtime = HPTERROR;
+	  sr.gaptime = HPTERROR;
+	  ts_init (&sr.timecache);
+	  tspairdeltas (&sr);
 	  
-	  if ( ! strncmp (listtype, "SLIST", 5) )
+	  if ( reportfile )
 	    {
-	      if ( readslist (ifp, mst->datasamples, mst->sampletype, mst->numsamples) )
-		{
-		  fprintf (stderr, "Error reading samples from file\n");
-		  return -1;
-		}
+	      sr.stats = &job->stats;
+	      
+	      if ( (cs = st_channel (&job->stats, mst_srcname (mst, srcname, 0))) )
+		segoffset = rb->bufoffset + (line - rb->buffer);
 	    }
-	  else if ( ! strncmp (listtype, "TSPAIR", 6) )
+	  
+	  if ( ! strncmp (hdr.listtype, "SLIST", 5) )
 	    {
-	      if ( readtspair (ifp, mst->datasamples, mst->sampletype, mst->numsamples, mst->samprate) )
-		{
-		  fprintf (stderr, "Error reading samples from file\n");
-		  return -1;
-		}
+	      sr.listtype = 'S';
 	    }
-	  else
+	  else if ( ! strncmp (hdr.listtype, "TSPAIR", 6) )
 	    {
-	      fprintf (stderr, "Unrecognized sample list type: '%s'\n", listtype);
-	      return -1;
+	      sr.listtype = 'T';
 	    }
-          
-	  if ( verbose >= 1 )
+	  else if ( si_binarylength (&hdr) > 0 )
 	    {
-	      fprintf (stderr, "[%s] %lld samps @ %.6f Hz for N: '%s', S: '%s', L: '%s', C: '%s'\n",
-		       infile, (long long int)mst->numsamples, mst->samprate,
-		       mst->network, mst->station,  mst->location, mst->channel);
+	      sr.listtype = 'B';
+	      sr.swapflag = ( (hdr.listtype[7] == 'B') != (ms_bigendianhost () != 0) );
 	    }
-	  
-          if ( ! mst_addtracetogroup (mstg, mst) )
+	  else
 	    {
-	      fprintf (stderr, "[%s] Error adding trace to MSTraceGroup\n", infile);
-              return -1;
+	      fprintf (stderr, "Unrecognized sample list type: '%s'\n", hdr.listtype);
+	      goto cleanup;
 	    }
 	  
 	  /* Create an MSRecord template for the MSTrace */
           if ( ! (msr = msr_init(NULL)) )
             {
               fprintf (stderr, "[%s] Cannot initialize MSRecord strcture\n", infile);
-              return -1;
+              goto cleanup;
             }
           
           mst->prvtptr = msr;
+          msr->encoding = trencoding;
           
 	  /* Split source name into separate quantities for the template MSRecord */
-	  if ( ms_splitsrcname (srcname, msr->network, msr->station, msr->location, msr->channel, &(msr->dataquality)) )
+	  if ( ms_splitsrcname (hdr.srcname, msr->network, msr->station, msr->location, msr->channel, &(msr->dataquality)) )
             {
-              fprintf (stderr, "Cannot parse channel source name: %s (improperly specified?)\n", srcname);
-              return -1;
+              fprintf (stderr, "Cannot parse channel source name: %s (improperly specified?)\n", hdr.srcname);
+              goto cleanup;
             }
           
           /* Add blockettes 1000 & 1001 to template */
@@ -365,34 +1178,134 @@ packascii (char *infile)
             }
           
           /* Set flags in header if present in TIMESERIES declaration */
-          if ( flagstr[0] )
+          if ( hdr.flagstr[0] )
             {
-              if ( setheadervalues (flagstr, msr) )
+              if ( setheadervalues (hdr.flagstr, msr) )
                 {
-                  return -1;
+                  goto cleanup;
                 }
             }
+	  
+	  if ( verbose >= 1 )
+	    {
+	      fprintf (stderr, "[%s] %lld samps @ %.6f Hz for N: '%s', S: '%s', L: '%s', C: '%s'\n",
+		       infile, (long long int)mst->samplecnt, mst->samprate,
+		       mst->network, mst->station,  mst->location, mst->channel);
+	    }
+	  
+	  /* Read and pack samples in chunks, records are created in input order */
+	  if ( chunksamples > 0 )
+	    {
+	      if ( streamtrace (job, &sr, &mst) )
+		goto cleanup;
+	      
+	      job->packedtraces++;
+	      freetrace (&mst);
+	      continue;
+	    }
+	  
+	  /* Allocate memory for the data samples */
+	  samplesize = ms_samplesize (mst->sampletype);
+	  if ( ! (mst->datasamples = calloc (mst->numsamples, samplesize)) )
+	    {
+	      fprintf (stderr, "Cannot allocate memory for data samples\n");
+	      goto cleanup;
+	    }
+	  
+	  if ( readsamples (&sr, mst->datasamples, mst->numsamples) )
+	    {
+	      fprintf (stderr, "Error reading samples from file\n");
+	      goto cleanup;
+	    }
+	  
+	  /* Close the trace at each gap and read the remainder into a new trace */
+	  while ( sr.gaptime != HPTERROR )
+	    {
+	      remaining = sr.samplecnt - sr.samplesread;
+	      
+	      mst->numsamples -= remaining;
+	      mst->samplecnt = mst->numsamples;
+	      mst->endtime = mst->starttime + (mst->numsamples - 1) * hpdelta;
+	      
+	      if ( ! (datasamples = realloc (mst->datasamples, (size_t)(mst->numsamples * samplesize))) )
+		{
+		  fprintf (stderr, "Cannot allocate memory for data samples\n");
+		  goto cleanup;
+		}
+	      mst->datasamples = datasamples;
+	      
+	      if ( ! mst_addtracetogroup (mstg, mst) )
+		{
+		  fprintf (stderr, "[%s] Error adding trace to MSTraceGroup\n", infile);
+		  goto cleanup;
+		}
+	      
+	      if ( ! (mst = nexttrace (mst, sr.gaptime)) )
+		goto cleanup;
+	      
+	      mst->samplecnt = remaining;
+	      mst->numsamples = remaining;
+	      mst->endtime = mst->starttime + (remaining - 1) * hpdelta;
+	      sr.gaptime = HPTERROR;
+	      
+	      if ( ! (mst->datasamples = calloc (remaining, samplesize)) )
+		{
+		  fprintf (stderr, "Cannot allocate memory for data samples\n");
+		  goto cleanup;
+		}
+	      
+	      if ( readsamples (&sr, mst->datasamples, remaining) )
+		{
+		  fprintf (stderr, "Error reading samples from file\n");
+		  goto cleanup;
+		}
+	    }
+	  
+          if ( ! mst_addtracetogroup (mstg, mst) )
+	    {
+	      fprintf (stderr, "[%s] Error adding trace to MSTraceGroup\n", infile);
+              goto cleanup;
+	    }
+	  
+	  /* The trace is now owned by the group */
+	  mst = 0;
         } /* End of TIMESERIES line detection loop */
     } /* End of reading lines from input file */
   
+  if ( cs )
+    cs->bytesin += rb_tell (rb) - segoffset;
+  
+  job->stats.bytesin = rb_tell (rb) - startoffset;
+  job->stats.seconds[ST_READ] += rb->readtime;
+  
   /* Sort MSTraceGroup before packing */
+  if ( reportfile )
+    start = st_now ();
+  
   if ( mst_groupsort (mstg, 1) )
     {
       fprintf (stderr, "[%s] Error sorting traces\n", infile);
-      return -1;
+      goto cleanup;
     }
   
+  if ( reportfile )
+    job->stats.seconds[ST_SORT] += st_now () - start;
+  
   /* Pack MSTraceGroup into miniSEED */
-  packtraces (mstg, 1);
+  packtraces (job, mstg, 1);
+  
+  job->packedtraces += mstg->numtraces;
   
-  packedtraces += mstg->numtraces;
+  retval = 0;
   
-  fclose (ifp);
+ cleanup:
+  rb_close (&rb);
+  freetrace (&mst);
   
   if ( mstg )
     freetraces (mstg);
   
-  return 0;
+  return retval;
 }  /* End of packascii() */
 
 
@@ -514,65 +1427,142 @@ setheadervalues (char *flags, MSRecord *msr)
 }  /* End of setheadervalues() */
 
 
+/***************************************************************************
+ * readsamples:
+ *
+ * Read the next count samples of a segment into the data array, which
+ * must already be allocated for count samples of the segment type.
+ *
+ * Reading of TSPAIR samples stops early at a gap, indicated by
+ * sr->gaptime, and continues with the sample after the gap on the
+ * next call.
+ *
+ * Returns 0 on sucess or a positive number indicating line number of
+ * parsing failure.
+ ***************************************************************************/
+static int
+readsamples (SampleReader *sr, void *data, int64_t count)
+{
+  double start = 0.0;
+  double readtime = 0.0;
+  double timetime = 0.0;
+  int rv;
+  
+  if ( ! sr || ! data || ! count )
+    return -1;
+  
+  if ( count > (sr->samplecnt - sr->samplesread) )
+    {
+      fprintf (stderr, "[%s] Cannot read %lld samples, only %lld remain in segment\n",
+	       sr->rb->path, (long long int)count,
+	       (long long int)(sr->samplecnt - sr->samplesread));
+      return -1;
+    }
+  
+  if ( sr->stats )
+    {
+      start = st_now ();
+      readtime = sr->rb->readtime;
+      timetime = sr->stats->seconds[ST_TIME];
+    }
+  
+  if ( sr->listtype == 'S' )
+    rv = readslist (sr, data, count);
+  else if ( sr->listtype == 'T' )
+    rv = readtspair (sr, data, count);
+  else if ( sr->listtype == 'B' )
+    rv = readbinary (sr, data, count);
+  else
+    rv = -1;
+  
+  /* Parsing time excludes reading input and converting time stamps */
+  if ( sr->stats )
+    sr->stats->seconds[ST_PARSE] += st_now () - start -
+      (sr->rb->readtime - readtime) - (sr->stats->seconds[ST_TIME] - timetime);
+  
+  return rv;
+}  /* End of readsamples() */
+
+
 /***************************************************************************
  * readslist:
  *
  * Read a alphanumeric data from a file and add to an array, the array
- * must already be allocated with datacnt floats.
+ * must already be allocated with count samples.
+ *
+ * The data may be organized in any number of columns.  32-bit
+ * integers, floats and 64-bit doubles are parsed according to the
+ * sample type of the reader ('i', 'f' or 'd').
  *
- * The data must be organized in 1-8 columns.  32-bit integers, floats
- * and 64-bit doubles are parsed according to the 'datatype' argument
- * ('i', 'f' or 'd').
+ * Reading may stop in the middle of a line, the next call continues
+ * with the following sample.
  *
  * Returns 0 on sucess or a positive number indicating line number of
  * parsing failure.
  ***************************************************************************/
 static int
-readslist (FILE *ifp, void *data, char datatype, int32_t datacnt)
+readslist (SampleReader *sr, void *data, int64_t count)
 {
-  char line[1025];
-  int linecnt = 1;
-  int samplesread = 0;
-  int count = 0;
-  int dataidx = 0;
+  ReadBuffer *rb = sr->rb;
+  int64_t dataidx = 0;
+  int rv;
   
-  if ( ! ifp || ! data || ! datacnt )
-    return -1;
+  while ( dataidx < count )
+    {
+      /* Read next line if needed */
+      if ( ! sr->cp )
+	{
+	  if ( (rv = rb_getline (rb, &sr->line, &sr->lineend)) <= 0 )
+	    {
+	      if ( rv == 0 )
+		fprintf (stderr, "[%s] Unexpected end of input after %lld of %lld samples\n",
+			 rb->path, (long long int)sr->samplesread, (long long int)sr->samplecnt);
+	      return (int) rb->linenum + 1;
+	    }
+	  
+	  sr->cp = sr->line;
+	  sr->linesamples = 0;
+	}
+      
+      while ( sr->cp < sr->lineend && PN_ISSPACE (*sr->cp) )
+	sr->cp++;
+      
+      if ( sr->cp >= sr->lineend )
+	{
+	  if ( sr->linesamples == 0 )
+	    {
+	      badvalue (rb, sr->line, sr->lineend, sr->line, "No sample values");
+	      return (int) rb->linenum;
+	    }
+	  
+	  sr->cp = NULL;
+	  continue;
+	}
+      
+      if ( parsesample (&sr->cp, sr->lineend, data, sr->datatype, dataidx) )
+	{
+	  badvalue (rb, sr->line, sr->lineend, sr->cp, "Cannot parse sample value");
+	  return (int) rb->linenum;
+	}
+      
+      dataidx++;
+      sr->samplesread++;
+      sr->linesamples++;
+    }
   
-  /* Each data line should contain 1-8 samples */
-  for (;;)
-    {
-      if ( ! fgets(line, sizeof(line), ifp) )
-	return linecnt;
-      
-      if ( datatype == 'i' )
-	count = sscanf (line, " %d %d %d %d %d %d %d %d ", (int32_t *) data + dataidx,
-			(int32_t *) data + dataidx + 1, (int32_t *) data + dataidx + 2,
-			(int32_t *) data + dataidx + 3, (int32_t *) data + dataidx + 4,
-			(int32_t *) data + dataidx + 5, (int32_t *) data + dataidx + 6,
-			(int32_t *) data + dataidx + 7);
-      else if ( datatype == 'f' )
-	count = sscanf (line, " %f %f %f %f %f %f %f %f ", (float *) data + dataidx,
-			(float *) data + dataidx + 1, (float *) data + dataidx + 2,
-			(float *) data + dataidx + 3, (float *) data + dataidx + 4,
-			(float *) data + dataidx + 5, (float *) data + dataidx + 6,
-			(float *) data + dataidx + 7);
-      else if ( datatype == 'd' )
-	count = sscanf (line, " %lf %lf %lf %lf %lf %lf %lf %lf ", (double *) data + dataidx,
-			(double *) data + dataidx + 1, (double *) data + dataidx + 2,
-			(double *) data + dataidx + 3, (double *) data + dataidx + 4,
-			(double *) data + dataidx + 5, (double *) data + dataidx + 6,
-			(double *) data + dataidx + 7);
-      
-      samplesread += count;
-      
-      if ( samplesread >= datacnt )
-	break;
-      else if ( count < 1 || count > 8 )
-	return linecnt;
-      
-      dataidx += count;
-      linecnt++;
+  /* Check remainder of final line for extra values */
+  if ( sr->samplesread >= sr->samplecnt && sr->cp )
+    {
+      while ( sr->cp < sr->lineend && PN_ISSPACE (*sr->cp) )
+	sr->cp++;
+      
+      if ( sr->cp < sr->lineend )
+	{
+	  badvalue (rb, sr->line, sr->lineend, sr->cp, "More samples than declared in header");
+	  return (int) rb->linenum;
+	}
+      
+      sr->cp = NULL;
     }
   
   return 0;
@@ -583,91 +1573,300 @@ readslist (FILE *ifp, void *data, char datatype, int32_t datacnt)
  * readtspair:
  *
  * Read a alphanumeric data from a file and add to an array, the array
- * must already be allocated with datacnt floats.
+ * must already be allocated with count samples.
  *
  * The data must be organized in 2 column, time-sample pairs.  32-bit
  * integers, floats and 64-bit doubles are parsed according to the
- * 'datatype' argument ('i', 'f' or 'd').
+ * sample type of the reader ('i', 'f' or 'd').
  *
  * Example data line:
  * "2008-01-15T00:00:08.975000  678.145"
  *
- * The data is checked to be evenly spaced and to match the supplied
- * sample rate.
+ * The data is checked to be evenly spaced and to match the declared
+ * sample rate.  The first interval of each trace must match the
+ * sample rate, after that a sample at a different interval is treated
+ * as the start of a new trace following a gap or overlap.  Reading
+ * stops before the sample and sr->gaptime is set to its time, the
+ * line is kept and read again by the next call.
  *
  * Returns 0 on sucess or a positive number indicating line number of
  * parsing failure.
  ***************************************************************************/
 static int
-readtspair (FILE *ifp, void *data, char datatype, int32_t datacnt, double samprate)
+readtspair (SampleReader *sr, void *data, int64_t count)
 {
+  ReadBuffer *rb = sr->rb;
   hptime_t samptime = HPTERROR;
-  hptime_t prevtime = HPTERROR;
-  char line[1025];
-  char stime[50];
-  int linecnt = 1;
-  int samplesread = 0;
-  int count = 0;
-  int dataidx = 0;
-  
-  if ( ! ifp || ! data || ! datacnt )
-    return -1;
+  char *line;
+  char *lineend;
+  char *cp;
+  char *timestr;
+  char *timeend;
+  int64_t dataidx = 0;
+  double start = 0.0;
+  int rv;
   
   /* Each data line should contain a time-sample pair */
-  for (;;)
+  while ( dataidx < count )
     {
-      if ( ! fgets(line, sizeof(line), ifp) )
-	return linecnt;
+      /* Line of first sample after a gap */
+      if ( sr->cp )
+	{
+	  line = sr->line;
+	  lineend = sr->lineend;
+	  sr->cp = NULL;
+	}
+      else if ( (rv = rb_getline (rb, &line, &lineend)) <= 0 )
+	{
+	  if ( rv == 0 )
+	    fprintf (stderr, "[%s] Unexpected end of input after %lld of %lld samples\n",
+		     rb->path, (long long int)sr->samplesread, (long long int)sr->samplecnt);
+	  return (int) rb->linenum + 1;
+	}
       
-      if ( datatype == 'i' )
-	count = sscanf (line, " %s %d ", stime, (int32_t *) data + dataidx);
-      else if ( datatype == 'f' )
-	count = sscanf (line, " %s %f ", stime, (float *) data + dataidx);
-      else if ( datatype == 'd' )
-	count = sscanf (line, " %s %lf ", stime, (double *) data + dataidx);
+      cp = line;
+      while ( cp < lineend && PN_ISSPACE (*cp) )
+	cp++;
       
-      if ( count == 2 )
+      /* Find end of time stamp */
+      timestr = cp;
+      timeend = cp;
+      while ( timeend < lineend && ! PN_ISSPACE (*timeend) )
+	timeend++;
+      
+      if ( timeend == cp || (timeend - cp) > TS_MAXLENGTH )
 	{
-	  /* Convert sample time to high-precision time value */
-	  if ( (samptime = ms_timestr2hptime (stime)) == HPTERROR )
-	    {
-	      fprintf (stderr, "Error converting sample time stamp: '%s'\n", stime);
-	      return linecnt;
-	    }
+	  badvalue (rb, line, lineend, cp, "Cannot parse time stamp");
+	  return (int) rb->linenum;
+	}
+      
+      cp = timeend;
+      while ( cp < lineend && PN_ISSPACE (*cp) )
+	cp++;
+      
+      if ( cp >= lineend || parsesample (&cp, lineend, data, sr->datatype, dataidx) )
+	{
+	  badvalue (rb, line, lineend, cp, "Cannot parse sample value");
+	  return (int) rb->linenum;
+	}
+      
+      while ( cp < lineend && PN_ISSPACE (*cp) )
+	cp++;
+      
+      if ( cp < lineend )
+	{
+	  badvalue (rb, line, lineend, cp, "Unexpected value after time-sample pair");
+	  return (int) rb->linenum;
+	}
+      
+      /* Convert sample time to high-precision time value */
+      if ( sr->stats )
+	start = st_now ();
+      
+      samptime = ts_timestr2hptime (&sr->timecache, timestr, timeend);
+      
+      if ( sr->stats )
+	sr->stats->seconds[ST_TIME] += st_now () - start;
+      
+      if ( samptime == HPTERROR )
+	{
+	  fprintf (stderr, "Error converting sample time stamp: '%.*s'\n",
+		   (int)(timeend - timestr), timestr);
+	  return (int) rb->linenum;
+	}
+      
+      /* Check sample spacing, intervals within the tolerated range
+       * are known to pass the rate check */
+      if ( sr->prevtime != HPTERROR &&
+	   ( (samptime - sr->prevtime) < sr->mindelta ||
+	     (samptime - sr->prevtime) > sr->maxdelta ) )
+	{
+	  double srate = (double) HPTMODULUS / (samptime - sr->prevtime);
 	  
-	  /* Check sample spacing */
-	  if ( prevtime != HPTERROR )
+	  if ( ! MS_ISRATETOLERABLE (sr->samprate, srate) )
 	    {
-	      double srate = (double) HPTMODULUS / (samptime - prevtime);
-	      
-	      if ( ! MS_ISRATETOLERABLE (samprate, srate) )
+	      /* The first interval of a trace must match the declared rate */
+	      if ( sr->tracesamples < 2 )
 		{
-		  fprintf (stderr, "Data samples are not evenly sampled starting at sample %d (%g versus %g)\n",
-                           linecnt, samprate, srate);
-		  return linecnt;
+		  fprintf (stderr, "Data samples are not evenly sampled starting at sample %lld (%g versus %g)\n",
+			   (long long int)sr->samplesread + 1, sr->samprate, srate);
+		  return (int) rb->linenum;
 		}
+	      
+	      if ( verbose >= 1 )
+		fprintf (stderr, "[%s] Time tear at line %lld (%g versus %g), starting new trace\n",
+			 rb->path, (long long int)rb->linenum, sr->samprate, srate);
+	      
+	      /* Keep line for the next call */
+	      sr->line = line;
+	      sr->lineend = lineend;
+	      sr->cp = line;
+	      sr->gaptime = samptime;
+	      sr->prevtime = HPTERROR;
+	      sr->tracesamples = 0;
+	      return 0;
 	    }
-	  
-	  prevtime = samptime;
-	  
-	  samplesread += 1;
-	  
-	  if ( samplesread >= datacnt )
-	    break;
-	}
-      else
-	{
-	  return linecnt;
 	}
       
-      dataidx += 1;
-      linecnt++;
+      sr->prevtime = samptime;
+      sr->tracesamples++;
+      sr->samplesread++;
+      dataidx++;
     }
   
   return 0;
 }  /* End of readtspair() */
 
 
+/***************************************************************************
+ * readbinary:
+ *
+ * Read binary samples from a file into an array, the array must
+ * already be allocated with count samples.
+ *
+ * The samples are 32-bit integers, floats or 64-bit doubles according
+ * to the sample type of the reader ('i', 'f' or 'd') and are read
+ * directly into the array, swapping the byte order if it differs
+ * from the host byte order.
+ *
+ * Returns 0 on sucess or a positive number indicating line number of
+ * parsing failure.
+ ***************************************************************************/
+static int
+readbinary (SampleReader *sr, void *data, int64_t count)
+{
+  ReadBuffer *rb = sr->rb;
+  int samplesize = ms_samplesize (sr->datatype);
+  int64_t length = count * samplesize;
+  int64_t nread;
+  int64_t idx;
+  
+  if ( (nread = rb_read (rb, data, (size_t)length)) < length )
+    {
+      if ( nread >= 0 )
+	fprintf (stderr, "[%s] Unexpected end of input after %lld of %lld samples\n",
+		 rb->path, (long long int)(sr->samplesread + nread / samplesize),
+		 (long long int)sr->samplecnt);
+      return (int) rb->linenum + 1;
+    }
+  
+  if ( sr->swapflag )
+    {
+      if ( samplesize == 8 )
+	for ( idx = 0; idx < count; idx++ )
+	  ms_gswap8a ((double *)data + idx);
+      else
+	for ( idx = 0; idx < count; idx++ )
+	  ms_gswap4a ((int32_t *)data + idx);
+    }
+  
+  sr->samplesread += count;
+  
+  return 0;
+}  /* End of readbinary() */
+
+
+/***************************************************************************
+ * tspairdeltas:
+ *
+ * Determine the range of TSPAIR sample intervals that pass the
+ * MS_ISRATETOLERABLE() test against the declared sample rate.  The
+ * test is monotonic in the interval, so the bounds are found by
+ * bisection using the test itself and intervals within them need not
+ * be tested again for each sample.
+ *
+ * If no interval near the nominal one is tolerated the range is left
+ * empty and every interval is tested.
+ ***************************************************************************/
+static void
+tspairdeltas (SampleReader *sr)
+{
+  hptime_t nominal;
+  hptime_t low, high, mid;
+  
+  sr->mindelta = 1;
+  sr->maxdelta = 0;
+  
+  if ( ! (sr->samprate > 0.0) || sr->samprate > HPTMODULUS )
+    return;
+  
+  nominal = (hptime_t) ((double) HPTMODULUS / sr->samprate + 0.5);
+  
+  if ( ! MS_ISRATETOLERABLE (sr->samprate, (double) HPTMODULUS / nominal) )
+    return;
+  
+  /* Shortest tolerated interval, in the range (low, high] */
+  low = 0;
+  high = nominal;
+  while ( high - low > 1 )
+    {
+      mid = low + (high - low) / 2;
+      
+      if ( MS_ISRATETOLERABLE (sr->samprate, (double) HPTMODULUS / mid) )
+	high = mid;
+      else
+	low = mid;
+    }
+  sr->mindelta = high;
+  
+  /* Longest tolerated interval, in the range [low, high) */
+  low = nominal;
+  high = nominal * 2;
+  while ( high - low > 1 )
+    {
+      mid = low + (high - low) / 2;
+      
+      if ( MS_ISRATETOLERABLE (sr->samprate, (double) HPTMODULUS / mid) )
+	low = mid;
+      else
+	high = mid;
+    }
+  sr->maxdelta = low;
+}  /* End of tspairdeltas() */
+
+
+/***************************************************************************
+ * parsesample:
+ *
+ * Parse a single sample value starting at *cp into the data array at
+ * index dataidx according to the 'datatype' argument ('i', 'f' or 'd').
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+parsesample (char **cp, char *end, void *data, char datatype, int64_t dataidx)
+{
+  if ( datatype == 'i' )
+    return pn_int32 (cp, end, (int32_t *) data + dataidx);
+  else if ( datatype == 'f' )
+    return pn_float (cp, end, (float *) data + dataidx);
+  else if ( datatype == 'd' )
+    return pn_double (cp, end, (double *) data + dataidx);
+  
+  return -1;
+}  /* End of parsesample() */
+
+
+/***************************************************************************
+ * badvalue:
+ *
+ * Print an error message identifying the input, line and column of a
+ * value that could not be parsed.
+ ***************************************************************************/
+static void
+badvalue (ReadBuffer *rb, char *line, char *lineend, char *cp, const char *message)
+{
+  char *tokenend = cp;
+  
+  while ( tokenend < lineend && ! PN_ISSPACE (*tokenend) && (tokenend - cp) < 40 )
+    tokenend++;
+  
+  fprintf (stderr, "[%s] %s at line %lld, column %d: '%.*s'\n",
+	   rb->path, message, (long long int) rb->linenum, (int)(cp - line) + 1,
+	   (int)(tokenend - cp), cp);
+}  /* End of badvalue() */
+
+
 /***************************************************************************
  * parameter_proc:
  * Process the command line parameters.
@@ -712,10 +1911,50 @@ parameter_proc (int argcount, char **argvec)
 	{
 	  byteorder = strtoul (getoptval(argcount, argvec, optind++), NULL, 10);
 	}
+      else if (strcmp (argvec[optind], "-j") == 0)
+	{
+	  threads = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-C") == 0)
+	{
+	  chunksamples = strtoll (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
       else if (strcmp (argvec[optind], "-o") == 0)
 	{
 	  outputfile = getoptval(argcount, argvec, optind++);
 	}
+      else if (strcmp (argvec[optind], "-B") == 0)
+	{
+	  outbufsize = strtoul (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-D") == 0)
+	{
+	  outdirect = 1;
+	}
+      else if (strcmp (argvec[optind], "-A") == 0)
+	{
+	  archiveformat = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-SDS") == 0)
+	{
+	  char *sdsdir = getoptval(argcount, argvec, optind++);
+	  
+	  if ( ! (archiveformat = (char *) malloc (strlen (sdsdir) + strlen (AR_SDSLAYOUT) + 2)) )
+	    {
+	      fprintf (stderr, "Cannot allocate memory for archive format\n");
+	      exit (1);
+	    }
+	  
+	  sprintf (archiveformat, "%s/%s", sdsdir, AR_SDSLAYOUT);
+	}
+      else if (strcmp (argvec[optind], "-F") == 0)
+	{
+	  archivemaxopen = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-R") == 0)
+	{
+	  reportfile = getoptval(argcount, argvec, optind++);
+	}
       else if (strncmp (argvec[optind], "-", 1) == 0 &&
 	       strlen (argvec[optind]) > 1 )
 	{
@@ -737,12 +1976,20 @@ parameter_proc (int argcount, char **argvec)
       exit (1);
     }
 
+  /* The report cannot share stdout with miniSEED output */
+  if ( reportfile && outputfile &&
+       ! strcmp (reportfile, "-") && ! strcmp (outputfile, "-") )
+    {
+      fprintf (stderr, "Cannot write both the report (-R) and output (-o) to stdout\n");
+      exit (1);
+    }
+  
   /* Report the program version */
   if ( verbose )
     fprintf (stderr, "%s version: %s\n", PACKAGE, VERSION);
   
-  /* Check for an output file */
-  if ( ! outputfile )
+  /* Check for an output file or archive */
+  if ( ! outputfile && ! archiveformat )
     fprintf (stderr, "WARNING: no output file specified\n");    
   
   /* Check the input files for any list files, if any are found
@@ -812,8 +2059,9 @@ getoptval (int argcount, char **argvec, int argopt)
     return 0;
   }
   
-  /* Special case of '-o -' usage */
-  if ( (argopt+1) < argcount && strcmp (argvec[argopt], "-o") == 0 )
+  /* Special case of '-o -' and '-R -' usage */
+  if ( (argopt+1) < argcount && (strcmp (argvec[argopt], "-o") == 0 ||
+				 strcmp (argvec[argopt], "-R") == 0) )
     if ( strcmp (argvec[argopt+1], "-") == 0 )
       return argvec[argopt+1];
   
@@ -970,17 +2218,60 @@ addnode (struct listnode **listroot, char *key, char *data)
 
 /***************************************************************************
  * record_handler:
- * Saves passed records to the output file.
+ * Saves passed records to the output file and archive or the job
+ * record buffer.  If the buffer cannot be grown the job is marked as
+ * failed.
  ***************************************************************************/
 static void
 record_handler (char *record, int reclen, void *handlerdata)
 {
-  if ( ofp )
+  PackJob *job = (PackJob *) handlerdata;
+  char *newbuf;
+  size_t newsize;
+  double start = 0.0;
+  
+  if ( reportfile )
+    start = st_now ();
+  
+  if ( job && job->buffered )
     {
-      if ( fwrite(record, reclen, 1, ofp) != 1 )
+      /* Records following a buffer allocation failure are dropped */
+      if ( job->retval )
+	return;
+      
+      if ( job->recbuflength + reclen > job->recbufsize )
 	{
-	  fprintf (stderr, "Error writing to output file\n");
+	  newsize = ( job->recbufsize ) ? job->recbufsize * 2 : 1048576;
+	  while ( newsize < job->recbuflength + reclen )
+	    newsize *= 2;
+	  
+	  if ( ! (newbuf = (char *) realloc (job->recbuf, newsize)) )
+	    {
+	      fprintf (stderr, "[%s] Cannot allocate memory for record buffer\n", job->infile);
+	      job->retval = -1;
+	      return;
+	    }
+	  
+	  job->recbuf = newbuf;
+	  job->recbufsize = newsize;
 	}
+      
+      memcpy (job->recbuf + job->recbuflength, record, reclen);
+      job->recbuflength += reclen;
+    }
+  else
+    {
+      if ( ofb )
+	wb_write (ofb, record, reclen);
+      
+      if ( archive )
+	ar_write (archive, record, reclen);
+    }
+  
+  if ( job && reportfile )
+    {
+      job->stats.seconds[ST_WRITE] += st_now () - start;
+      job->stats.bytesout += reclen;
     }
 }  /* End of record_handler() */
 
@@ -1004,7 +2295,15 @@ usage (void)
 	   " -r bytes       Specify record length in bytes for packing, default: 4096\n"
 	   " -e encoding    Specify SEED encoding format for packing, default: 11 (Steim2)\n"
 	   " -b byteorder   Specify byte order for packing, MSBF: 1 (default), LSBF: 0\n"
+	   " -C samples     Stream samples in chunks, packing records as data are read\n"
+	   " -j threads     Convert input files and segments in parallel using threads\n"
 	   " -o outfile     Specify the output file, default is <inputfile>.mseed\n"
+	   " -B bytes       Specify output buffer size in bytes, default: 1048576\n"
+	   " -D             Write output file with direct I/O where supported\n"
+	   " -A format      Write records to an archive with paths created from format\n"
+	   " -SDS dir       Write records to an SDS archive below dir\n"
+	   " -F files       Maximum number of archive files kept open, default: 100\n"
+	   " -R file        Write a JSON report of conversion statistics, '-' for stdout\n"
 	   "\n"
 	   " file(s)        File(s) of ASCII input data\n"
 	   "                  If a file is prefixed with an '@' it is assumed to contain\n"
@@ -1016,5 +2315,10 @@ usage (void)
            " 5  : 64-bit floats, required for double (FLOAT64) input samples\n"
            " 10 : Steim 1 compression of 32-bit integers\n"
            " 11 : Steim 2 compression of 32-bit integers\n"
-	   "\n");
+	   "\n"
+	   "Archive format flags:\n"
+	   " %%n : network, %%s : station, %%l : location, %%c : channel, %%q : quality\n"
+	   " %%Y : year, %%j : day of year, %%H : hour, %%M : minute, %%S : second\n"
+	   " SDS layout: <dir>/%s\n"
+	   "\n", AR_SDSLAYOUT);
 }  /* End of usage() */
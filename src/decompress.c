@@ -0,0 +1,599 @@
+/***************************************************************************
+ * decompress.c
+ *
+ * Decompression of gzip, zstd and xz compressed input in a background
+ * thread.  The thread decompresses the input into a ring of blocks
+ * that are consumed by dc_read(), so that decompression overlaps the
+ * parsing of the input.
+ *
+ * Support for each format is included when building with the
+ * corresponding library:
+ *   WITH_ZLIB : gzip, using zlib
+ *   WITH_ZSTD : zstd, using libzstd
+ *   WITH_LZMA : xz, using liblzma
+ *
+ * Compressed formats are always detected, input in a format that is
+ * not supported by the build is reported as an error.  Threads are
+ * not supported on Windows, where compressed input is not supported.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libmseed.h>
+
+#include "decompress.h"
+
+#if defined(WITH_ZLIB)
+  #include <zlib.h>
+#endif
+#if defined(WITH_ZSTD)
+  #include <zstd.h>
+#endif
+#if defined(WITH_LZMA)
+  #include <lzma.h>
+#endif
+
+static const char *formatnames[] = { "uncompressed", "gzip", "zstd", "xz" };
+
+
+/***************************************************************************
+ * dc_detect:
+ *
+ * Detect the compression format of input from its first bytes.
+ *
+ * Returns the format, DC_NONE if the input is not compressed.
+ ***************************************************************************/
+int
+dc_detect (const unsigned char *magic, size_t length)
+{
+  if ( length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b )
+    return DC_GZIP;
+
+  if ( length >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+       magic[2] == 0x2f && magic[3] == 0xfd )
+    return DC_ZSTD;
+
+  if ( length >= 6 && ! memcmp (magic, "\xfd" "7zXZ\0", 6) )
+    return DC_XZ;
+
+  return DC_NONE;
+}  /* End of dc_detect() */
+
+
+#if defined(LMP_WIN) || ! (defined(WITH_ZLIB) || defined(WITH_ZSTD) || defined(WITH_LZMA))
+
+Decompressor *
+dc_open (FILE *fp, int format, const char *path,
+         const unsigned char *magic, size_t magiclen)
+{
+  (void) fp;
+  (void) magic;
+  (void) magiclen;
+
+  fprintf (stderr, "Cannot read %s, %s compressed input is not supported by this build\n",
+           path, formatnames[format]);
+  return NULL;
+}
+
+int64_t
+dc_read (Decompressor *dc, void *dest, size_t length)
+{
+  (void) dc;
+  (void) dest;
+  (void) length;
+
+  return -1;
+}
+
+void
+dc_close (Decompressor **dc)
+{
+  (void) dc;
+}
+
+#else
+
+#include <pthread.h>
+
+/* Size and number of blocks of decompressed data */
+#define DC_BLOCKSIZE 1048576
+#define DC_BLOCKS 4
+
+/* Size of compressed input buffer */
+#define DC_INPUTSIZE 262144
+
+struct Decompressor_s {
+  FILE           *fp;           /* Compressed input stream */
+  char           *path;         /* Name of input, used in diagnostics */
+  int             format;       /* Compression format */
+  pthread_t       thread;       /* Decompression thread */
+  pthread_mutex_t lock;
+  pthread_cond_t  fullcond;     /* Signaled when a block is filled or on completion */
+  pthread_cond_t  freecond;     /* Signaled when a block is consumed or on stop */
+  char           *blocks[DC_BLOCKS]; /* Ring of decompressed data blocks */
+  size_t          blocklen[DC_BLOCKS]; /* Length of data in each block */
+  int             head;         /* Next block to consume */
+  int             count;        /* Count of filled blocks */
+  size_t          readpos;      /* Read position in head block */
+  int             done;         /* Flag indicating decompression is complete */
+  int             error;        /* Flag indicating decompression failed */
+  int             stop;         /* Flag requesting the thread to stop */
+  int             started;      /* Flag indicating the thread was started */
+
+  /* Decompression state, only used by the thread */
+  unsigned char  *input;        /* Compressed input buffer */
+  size_t          inputlen;     /* Length of data in input buffer */
+  size_t          inputpos;     /* Position of next input byte */
+  int             inputend;     /* Flag indicating end of compressed input */
+  int             finished;     /* Flag indicating end of decompressed data */
+  int             memberend;    /* Flag indicating end of a gzip member */
+#if defined(WITH_ZLIB)
+  z_stream        zs;
+#endif
+#if defined(WITH_ZSTD)
+  ZSTD_DStream   *zds;
+  size_t          zdsresult;    /* Last result, 0 at the end of a frame */
+#endif
+#if defined(WITH_LZMA)
+  lzma_stream     ls;
+#endif
+};
+
+static void *dc_worker (void *arg);
+static int64_t dc_decode (Decompressor *dc, char *output, size_t size);
+static int dc_step (Decompressor *dc, char *output, size_t size, size_t *produced);
+
+
+/***************************************************************************
+ * dc_open:
+ *
+ * Start decompressing the input stream, which is in the specified
+ * format, in a background thread.  The magic bytes already read from
+ * the stream to detect the format are decompressed first.
+ *
+ * Returns a new Decompressor on success and NULL on error.
+ ***************************************************************************/
+Decompressor *
+dc_open (FILE *fp, int format, const char *path,
+         const unsigned char *magic, size_t magiclen)
+{
+  Decompressor *dc;
+  int idx;
+  int rv = -1;
+
+  if ( ! fp || ! path || magiclen > DC_INPUTSIZE )
+    return NULL;
+
+  if ( ! (dc = (Decompressor *) calloc (1, sizeof (Decompressor))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for decompression\n");
+      return NULL;
+    }
+
+  dc->fp = fp;
+  dc->format = format;
+  dc->path = strdup (path);
+  dc->input = (unsigned char *) malloc (DC_INPUTSIZE);
+
+  for ( idx = 0; idx < DC_BLOCKS; idx++ )
+    {
+      if ( ! (dc->blocks[idx] = (char *) malloc (DC_BLOCKSIZE)) )
+        break;
+    }
+
+  if ( ! dc->path || ! dc->input || idx < DC_BLOCKS )
+    {
+      fprintf (stderr, "Cannot allocate memory for decompression\n");
+      dc_close (&dc);
+      return NULL;
+    }
+
+  memcpy (dc->input, magic, magiclen);
+  dc->inputlen = magiclen;
+
+  switch ( format )
+    {
+#if defined(WITH_ZLIB)
+    case DC_GZIP:
+      rv = ( inflateInit2 (&dc->zs, 15 + 16) == Z_OK ) ? 0 : -1;
+      break;
+#endif
+#if defined(WITH_ZSTD)
+    case DC_ZSTD:
+      rv = ( (dc->zds = ZSTD_createDStream ()) &&
+             ! ZSTD_isError (ZSTD_initDStream (dc->zds)) ) ? 0 : -1;
+      dc->zdsresult = 1;
+      break;
+#endif
+#if defined(WITH_LZMA)
+    case DC_XZ:
+      {
+        lzma_stream init = LZMA_STREAM_INIT;
+        dc->ls = init;
+        rv = ( lzma_stream_decoder (&dc->ls, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK ) ? 0 : -1;
+      }
+      break;
+#endif
+    default:
+      fprintf (stderr, "Cannot read %s, %s compressed input is not supported by this build\n",
+               path, formatnames[format]);
+      dc->format = DC_NONE;
+      dc_close (&dc);
+      return NULL;
+    }
+
+  if ( rv )
+    {
+      fprintf (stderr, "Cannot initialize %s decompression for %s\n",
+               formatnames[format], path);
+      dc_close (&dc);
+      return NULL;
+    }
+
+  pthread_mutex_init (&dc->lock, NULL);
+  pthread_cond_init (&dc->fullcond, NULL);
+  pthread_cond_init (&dc->freecond, NULL);
+
+  if ( pthread_create (&dc->thread, NULL, dc_worker, dc) )
+    {
+      fprintf (stderr, "Cannot create decompression thread\n");
+      pthread_mutex_destroy (&dc->lock);
+      pthread_cond_destroy (&dc->fullcond);
+      pthread_cond_destroy (&dc->freecond);
+      dc_close (&dc);
+      return NULL;
+    }
+
+  dc->started = 1;
+
+  return dc;
+}  /* End of dc_open() */
+
+
+/***************************************************************************
+ * dc_read:
+ *
+ * Read up to length bytes of decompressed data into dest, waiting for
+ * the thread to decompress more data as needed.
+ *
+ * Returns the number of bytes read, which is less than length only at
+ * the end of the data, or -1 on error.
+ ***************************************************************************/
+int64_t
+dc_read (Decompressor *dc, void *dest, size_t length)
+{
+  size_t total = 0;
+  size_t count;
+  char *block;
+
+  if ( ! dc || ! dest )
+    return -1;
+
+  while ( total < length )
+    {
+      pthread_mutex_lock (&dc->lock);
+
+      while ( dc->count == 0 && ! dc->done )
+        pthread_cond_wait (&dc->fullcond, &dc->lock);
+
+      if ( dc->count == 0 )
+        {
+          pthread_mutex_unlock (&dc->lock);
+          return ( dc->error ) ? -1 : (int64_t) total;
+        }
+
+      block = dc->blocks[dc->head];
+      count = dc->blocklen[dc->head] - dc->readpos;
+      pthread_mutex_unlock (&dc->lock);
+
+      /* The head block is not modified by the thread until released */
+      if ( count > length - total )
+        count = length - total;
+
+      memcpy ((char *) dest + total, block + dc->readpos, count);
+      dc->readpos += count;
+      total += count;
+
+      if ( dc->readpos == dc->blocklen[dc->head] )
+        {
+          pthread_mutex_lock (&dc->lock);
+          dc->head = (dc->head + 1) % DC_BLOCKS;
+          dc->count--;
+          dc->readpos = 0;
+          pthread_cond_signal (&dc->freecond);
+          pthread_mutex_unlock (&dc->lock);
+        }
+    }
+
+  return (int64_t) total;
+}  /* End of dc_read() */
+
+
+/***************************************************************************
+ * dc_close:
+ *
+ * Stop the decompression thread and free all memory associated with a
+ * Decompressor.  The input stream is not closed.
+ ***************************************************************************/
+void
+dc_close (Decompressor **dc)
+{
+  int idx;
+
+  if ( ! dc || ! *dc )
+    return;
+
+  if ( (*dc)->started )
+    {
+      pthread_mutex_lock (&(*dc)->lock);
+      (*dc)->stop = 1;
+      pthread_cond_signal (&(*dc)->freecond);
+      pthread_mutex_unlock (&(*dc)->lock);
+
+      pthread_join ((*dc)->thread, NULL);
+
+      pthread_mutex_destroy (&(*dc)->lock);
+      pthread_cond_destroy (&(*dc)->fullcond);
+      pthread_cond_destroy (&(*dc)->freecond);
+    }
+
+  switch ( (*dc)->format )
+    {
+#if defined(WITH_ZLIB)
+    case DC_GZIP:
+      inflateEnd (&(*dc)->zs);
+      break;
+#endif
+#if defined(WITH_ZSTD)
+    case DC_ZSTD:
+      ZSTD_freeDStream ((*dc)->zds);
+      break;
+#endif
+#if defined(WITH_LZMA)
+    case DC_XZ:
+      lzma_end (&(*dc)->ls);
+      break;
+#endif
+    default:
+      break;
+    }
+
+  for ( idx = 0; idx < DC_BLOCKS; idx++ )
+    if ( (*dc)->blocks[idx] )
+      free ((*dc)->blocks[idx]);
+
+  if ( (*dc)->input )
+    free ((*dc)->input);
+
+  if ( (*dc)->path )
+    free ((*dc)->path);
+
+  free (*dc);
+  *dc = NULL;
+}  /* End of dc_close() */
+
+
+/***************************************************************************
+ * dc_worker:
+ *
+ * Decompression thread, fills free blocks with decompressed data until
+ * the end of the data, an error or a stop request.
+ ***************************************************************************/
+static void *
+dc_worker (void *arg)
+{
+  Decompressor *dc = (Decompressor *) arg;
+  int64_t length;
+  int idx;
+
+  for (;;)
+    {
+      pthread_mutex_lock (&dc->lock);
+
+      while ( dc->count == DC_BLOCKS && ! dc->stop )
+        pthread_cond_wait (&dc->freecond, &dc->lock);
+
+      idx = (dc->head + dc->count) % DC_BLOCKS;
+
+      if ( dc->stop )
+        {
+          pthread_mutex_unlock (&dc->lock);
+          break;
+        }
+
+      pthread_mutex_unlock (&dc->lock);
+
+      length = dc_decode (dc, dc->blocks[idx], DC_BLOCKSIZE);
+
+      pthread_mutex_lock (&dc->lock);
+
+      if ( length > 0 )
+        {
+          dc->blocklen[idx] = (size_t) length;
+          dc->count++;
+        }
+
+      if ( length < 0 )
+        dc->error = 1;
+
+      if ( length <= 0 || dc->finished )
+        dc->done = 1;
+
+      pthread_cond_signal (&dc->fullcond);
+      pthread_mutex_unlock (&dc->lock);
+
+      if ( dc->done )
+        break;
+    }
+
+  return NULL;
+}  /* End of dc_worker() */
+
+
+/***************************************************************************
+ * dc_decode:
+ *
+ * Decompress up to size bytes into output, reading compressed input
+ * as needed.
+ *
+ * Returns the number of bytes decompressed, which is less than size
+ * only at the end of the data, or -1 on error.
+ ***************************************************************************/
+static int64_t
+dc_decode (Decompressor *dc, char *output, size_t size)
+{
+  size_t produced = 0;
+  size_t nread;
+
+  while ( produced < size && ! dc->finished )
+    {
+      if ( dc->inputpos == dc->inputlen && ! dc->inputend )
+        {
+          nread = fread (dc->input, 1, DC_INPUTSIZE, dc->fp);
+
+          if ( nread == 0 && ferror (dc->fp) )
+            {
+              fprintf (stderr, "Error reading input file: %s (%s)\n",
+                       dc->path, strerror(errno));
+              return -1;
+            }
+
+          dc->inputlen = nread;
+          dc->inputpos = 0;
+          dc->inputend = ( nread == 0 );
+        }
+
+      if ( dc_step (dc, output + produced, size - produced, &produced) )
+        return -1;
+    }
+
+  return (int64_t) produced;
+}  /* End of dc_decode() */
+
+
+/***************************************************************************
+ * dc_step:
+ *
+ * Run the decoder once on the available input, adding the number of
+ * bytes written to output to produced.  Sets dc->finished at the end
+ * of the compressed data.
+ *
+ * Returns 0 on success and -1 on error, including truncated input.
+ ***************************************************************************/
+static int
+dc_step (Decompressor *dc, char *output, size_t size, size_t *produced)
+{
+  size_t available = dc->inputlen - dc->inputpos;
+  const char *error = NULL;
+
+  switch ( dc->format )
+    {
+#if defined(WITH_ZLIB)
+    case DC_GZIP:
+      {
+        int rv;
+
+        /* Concatenated gzip members are decompressed in sequence */
+        if ( dc->memberend )
+          {
+            if ( available == 0 )
+              {
+                dc->finished = 1;
+                return 0;
+              }
+
+            inflateReset (&dc->zs);
+            dc->memberend = 0;
+          }
+
+        dc->zs.next_in = dc->input + dc->inputpos;
+        dc->zs.avail_in = (uInt) available;
+        dc->zs.next_out = (Bytef *) output;
+        dc->zs.avail_out = (uInt) size;
+
+        rv = inflate (&dc->zs, Z_NO_FLUSH);
+
+        dc->inputpos += available - dc->zs.avail_in;
+        *produced += size - dc->zs.avail_out;
+
+        if ( rv == Z_STREAM_END )
+          dc->memberend = 1;
+        else if ( rv == Z_BUF_ERROR && dc->inputend )
+          error = "unexpected end of input";
+        else if ( rv != Z_OK && rv != Z_BUF_ERROR )
+          error = ( dc->zs.msg ) ? dc->zs.msg : "decompression failed";
+      }
+      break;
+#endif
+#if defined(WITH_ZSTD)
+    case DC_ZSTD:
+      {
+        ZSTD_inBuffer in = { dc->input, dc->inputlen, dc->inputpos };
+        ZSTD_outBuffer out = { output, size, 0 };
+        size_t rv;
+
+        /* Concatenated frames are decompressed in sequence, the input
+         * must end at the end of a frame */
+        if ( available == 0 && dc->zdsresult == 0 )
+          {
+            dc->finished = 1;
+            return 0;
+          }
+
+        rv = ZSTD_decompressStream (dc->zds, &out, &in);
+
+        dc->inputpos = in.pos;
+        *produced += out.pos;
+
+        if ( ZSTD_isError (rv) )
+          error = ZSTD_getErrorName (rv);
+        else if ( dc->inputend && out.pos < out.size && rv != 0 )
+          error = "unexpected end of input";
+        else
+          dc->zdsresult = rv;
+      }
+      break;
+#endif
+#if defined(WITH_LZMA)
+    case DC_XZ:
+      {
+        lzma_ret rv;
+
+        dc->ls.next_in = dc->input + dc->inputpos;
+        dc->ls.avail_in = available;
+        dc->ls.next_out = (uint8_t *) output;
+        dc->ls.avail_out = size;
+
+        rv = lzma_code (&dc->ls, ( dc->inputend ) ? LZMA_FINISH : LZMA_RUN);
+
+        dc->inputpos += available - dc->ls.avail_in;
+        *produced += size - dc->ls.avail_out;
+
+        if ( rv == LZMA_STREAM_END )
+          dc->finished = 1;
+        else if ( rv == LZMA_BUF_ERROR && dc->inputend )
+          error = "unexpected end of input";
+        else if ( rv != LZMA_OK && rv != LZMA_BUF_ERROR )
+          error = "decompression failed";
+      }
+      break;
+#endif
+    default:
+      error = "unsupported format";
+      break;
+    }
+
+  if ( error )
+    {
+      fprintf (stderr, "Error decompressing %s input %s: %s\n",
+               formatnames[dc->format], dc->path, error);
+      return -1;
+    }
+
+  return 0;
+}  /* End of dc_step() */
+
+#endif
@@ -0,0 +1,31 @@
+/***************************************************************************
+ * decompress.h
+ *
+ * Declarations for the background decompression of compressed input
+ * used by ascii2mseed.
+ ***************************************************************************/
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H 1
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Compression formats of input */
+#define DC_NONE 0
+#define DC_GZIP 1
+#define DC_ZSTD 2
+#define DC_XZ   3
+
+/* Number of bytes needed to detect a compression format */
+#define DC_MAGICLEN 6
+
+typedef struct Decompressor_s Decompressor;
+
+extern int dc_detect (const unsigned char *magic, size_t length);
+extern Decompressor *dc_open (FILE *fp, int format, const char *path,
+                              const unsigned char *magic, size_t magiclen);
+extern int64_t dc_read (Decompressor *dc, void *dest, size_t length);
+extern void dc_close (Decompressor **dc);
+
+#endif /* DECOMPRESS_H */
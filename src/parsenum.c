@@ -0,0 +1,332 @@
+/***************************************************************************
+ * parsenum.c
+ *
+ * Parsers for ASCII sample values that operate directly on a bounded
+ * character range (no terminating NULL required).
+ *
+ * Integers are always parsed directly.  Floating point values that
+ * can be exactly represented by an integer mantissa and a small power
+ * of ten are converted with a single, correctly rounded IEEE
+ * operation, producing the same result as strtof()/strtod().  All
+ * other values (long mantissas, large exponents, NaN, Inf, hex
+ * notation) fall back to strtof()/strtod().
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "parsenum.h"
+
+/* The fast path requires that float and double expressions are
+ * evaluated in their own precision (e.g. not x87 extended) */
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define PN_FASTPATH 1
+#else
+#define PN_FASTPATH 0
+#endif
+
+/* Maximum length of a token handled by the strtod() fallback */
+#define PN_MAXTOKEN 128
+
+static int pn_scandecimal (char *cp, char *end, uint64_t *mantissa,
+                           int *exponent, int *negative, char **tokenend);
+static int pn_fallback (char **cp, char *end, char type, void *value);
+
+static const double pow10d[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const float pow10f[] = {
+  1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+
+/***************************************************************************
+ * pn_int32:
+ *
+ * Parse a 32-bit integer starting at *cp, the value must be followed
+ * by white space or the end of the range.  An optional leading sign
+ * is accepted.
+ *
+ * On success *cp is advanced past the value.
+ *
+ * Returns 0 on success and -1 on error (*cp unchanged).
+ ***************************************************************************/
+int
+pn_int32 (char **cp, char *end, int32_t *value)
+{
+  char *p = *cp;
+  uint32_t limit = 2147483647u;
+  uint32_t accum = 0;
+  uint32_t digit;
+  int negative = 0;
+
+  if ( p < end && (*p == '-' || *p == '+') )
+    {
+      if ( *p == '-' )
+        {
+          negative = 1;
+          limit = 2147483648u;
+        }
+      p++;
+    }
+
+  if ( p >= end || (uint8_t)(*p - '0') > 9 )
+    return -1;
+
+  while ( p < end && (digit = (uint8_t)(*p - '0')) <= 9 )
+    {
+      if ( accum > (limit - digit) / 10 )
+        return -1;
+
+      accum = accum * 10 + digit;
+      p++;
+    }
+
+  if ( p < end && ! PN_ISSPACE (*p) )
+    return -1;
+
+  *value = ( negative ) ? (int32_t)(0u - accum) : (int32_t)accum;
+  *cp = p;
+
+  return 0;
+}  /* End of pn_int32() */
+
+
+/***************************************************************************
+ * pn_float:
+ *
+ * Parse a 32-bit float starting at *cp, the value must be followed by
+ * white space or the end of the range.
+ *
+ * On success *cp is advanced past the value.
+ *
+ * Returns 0 on success and -1 on error (*cp unchanged).
+ ***************************************************************************/
+int
+pn_float (char **cp, char *end, float *value)
+{
+  uint64_t mantissa;
+  int exponent;
+  int negative;
+  char *tokenend;
+  float fvalue;
+
+  if ( PN_FASTPATH &&
+       pn_scandecimal (*cp, end, &mantissa, &exponent, &negative, &tokenend) &&
+       mantissa <= (UINT64_C(1) << 24) && exponent >= -10 && exponent <= 10 )
+    {
+      fvalue = (float) mantissa;
+
+      if ( exponent < 0 )
+        fvalue = fvalue / pow10f[-exponent];
+      else if ( exponent > 0 )
+        fvalue = fvalue * pow10f[exponent];
+
+      *value = ( negative ) ? -fvalue : fvalue;
+      *cp = tokenend;
+
+      return 0;
+    }
+
+  return pn_fallback (cp, end, 'f', value);
+}  /* End of pn_float() */
+
+
+/***************************************************************************
+ * pn_double:
+ *
+ * Parse a 64-bit double starting at *cp, the value must be followed
+ * by white space or the end of the range.
+ *
+ * On success *cp is advanced past the value.
+ *
+ * Returns 0 on success and -1 on error (*cp unchanged).
+ ***************************************************************************/
+int
+pn_double (char **cp, char *end, double *value)
+{
+  uint64_t mantissa;
+  int exponent;
+  int negative;
+  char *tokenend;
+  double dvalue;
+
+  if ( PN_FASTPATH &&
+       pn_scandecimal (*cp, end, &mantissa, &exponent, &negative, &tokenend) &&
+       mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22 )
+    {
+      dvalue = (double) mantissa;
+
+      if ( exponent < 0 )
+        dvalue = dvalue / pow10d[-exponent];
+      else if ( exponent > 0 )
+        dvalue = dvalue * pow10d[exponent];
+
+      *value = ( negative ) ? -dvalue : dvalue;
+      *cp = tokenend;
+
+      return 0;
+    }
+
+  return pn_fallback (cp, end, 'd', value);
+}  /* End of pn_double() */
+
+
+/***************************************************************************
+ * pn_scandecimal:
+ *
+ * Scan a decimal number of the form [+-]digits[.digits][(e|E)[+-]digits]
+ * into an integer mantissa and a power of ten exponent.  Leading
+ * zeros are not significant, at most 19 significant digits are
+ * accepted.
+ *
+ * Returns 1 if the token was completely scanned and 0 if the token
+ * must be handled by the general parser.
+ ***************************************************************************/
+static int
+pn_scandecimal (char *cp, char *end, uint64_t *mantissa,
+                int *exponent, int *negative, char **tokenend)
+{
+  char *p = cp;
+  uint64_t mant = 0;
+  uint32_t digit;
+  int sigdigits = 0;
+  int sawdigit = 0;
+  int exp = 0;
+  int expvalue = 0;
+  int expnegative = 0;
+
+  *negative = 0;
+
+  if ( p < end && (*p == '-' || *p == '+') )
+    {
+      *negative = ( *p == '-' );
+      p++;
+    }
+
+  /* Integer part */
+  while ( p < end && (digit = (uint8_t)(*p - '0')) <= 9 )
+    {
+      sawdigit = 1;
+
+      if ( mant || digit )
+        {
+          if ( sigdigits >= 19 )
+            return 0;
+
+          mant = mant * 10 + digit;
+          sigdigits++;
+        }
+      p++;
+    }
+
+  /* Fractional part */
+  if ( p < end && *p == '.' )
+    {
+      p++;
+
+      while ( p < end && (digit = (uint8_t)(*p - '0')) <= 9 )
+        {
+          sawdigit = 1;
+
+          if ( mant || digit )
+            {
+              if ( sigdigits >= 19 )
+                return 0;
+
+              mant = mant * 10 + digit;
+              sigdigits++;
+            }
+          exp--;
+          p++;
+        }
+    }
+
+  if ( ! sawdigit )
+    return 0;
+
+  /* Exponent */
+  if ( p < end && (*p == 'e' || *p == 'E') )
+    {
+      p++;
+
+      if ( p < end && (*p == '-' || *p == '+') )
+        {
+          expnegative = ( *p == '-' );
+          p++;
+        }
+
+      if ( p >= end || (uint8_t)(*p - '0') > 9 )
+        return 0;
+
+      while ( p < end && (digit = (uint8_t)(*p - '0')) <= 9 )
+        {
+          if ( expvalue > 10000 )
+            return 0;
+
+          expvalue = expvalue * 10 + digit;
+          p++;
+        }
+
+      exp += ( expnegative ) ? -expvalue : expvalue;
+    }
+
+  if ( p < end && ! PN_ISSPACE (*p) )
+    return 0;
+
+  /* Zero is exact regardless of exponent */
+  if ( mant == 0 )
+    exp = 0;
+
+  *mantissa = mant;
+  *exponent = exp;
+  *tokenend = p;
+
+  return 1;
+}  /* End of pn_scandecimal() */
+
+
+/***************************************************************************
+ * pn_fallback:
+ *
+ * Parse a floating point token with strtof() or strtod() after copying
+ * it to a terminated buffer.  The entire token, up to white space or
+ * the end of the range, must be consumed by the conversion.
+ *
+ * Returns 0 on success and -1 on error (*cp unchanged).
+ ***************************************************************************/
+static int
+pn_fallback (char **cp, char *end, char type, void *value)
+{
+  char token[PN_MAXTOKEN];
+  char *tokenend = *cp;
+  char *convend;
+  size_t length;
+
+  while ( tokenend < end && ! PN_ISSPACE (*tokenend) )
+    tokenend++;
+
+  length = tokenend - *cp;
+
+  if ( length == 0 || length >= sizeof (token) )
+    return -1;
+
+  memcpy (token, *cp, length);
+  token[length] = '\0';
+
+  if ( type == 'f' )
+    *(float *)value = strtof (token, &convend);
+  else
+    *(double *)value = strtod (token, &convend);
+
+  if ( convend != token + length )
+    return -1;
+
+  *cp = tokenend;
+
+  return 0;
+}  /* End of pn_fallback() */
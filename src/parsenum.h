@@ -0,0 +1,21 @@
+/***************************************************************************
+ * parsenum.h
+ *
+ * Declarations for the locale-independent sample value parsers used
+ * by ascii2mseed.
+ ***************************************************************************/
+
+#ifndef PARSENUM_H
+#define PARSENUM_H 1
+
+#include <stdint.h>
+
+/* Test for white space characters that separate sample values */
+#define PN_ISSPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || \
+                       (c) == '\n' || (c) == '\v' || (c) == '\f')
+
+extern int pn_int32 (char **cp, char *end, int32_t *value);
+extern int pn_float (char **cp, char *end, float *value);
+extern int pn_double (char **cp, char *end, double *value);
+
+#endif /* PARSENUM_H */
@@ -0,0 +1,636 @@
+/***************************************************************************
+ * readbuffer.c
+ *
+ * A simple buffered line reader.  Input is read in large blocks and
+ * lines are returned as pointers into the buffer, avoiding the per-line
+ * copying and size limits of fgets().
+ *
+ * Regular files are memory mapped when supported, in which case lines
+ * are returned directly from the mapping without any copying.
+ *
+ * Compressed input is detected and decompressed in a background
+ * thread, see decompress.c.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libmseed.h>
+
+#if !defined(LMP_WIN)
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <sys/mman.h>
+#endif
+
+#include "readbuffer.h"
+#include "stats.h"
+
+static int rb_map (ReadBuffer *rb);
+static int rb_fill (ReadBuffer *rb);
+static int64_t rb_input (ReadBuffer *rb, void *dest, size_t length);
+static int64_t rb_countlines (const char *start, const char *end);
+
+
+/***************************************************************************
+ * rb_open:
+ *
+ * Open the specified file for reading.  Regular files are memory
+ * mapped if possible, otherwise a buffer of bufsize bytes is
+ * allocated, if bufsize is 0 a default size is used.  Compressed
+ * input is detected from its first bytes and decompressed.
+ *
+ * Returns a new ReadBuffer on success and NULL on error.
+ ***************************************************************************/
+ReadBuffer *
+rb_open (const char *path, size_t bufsize)
+{
+  ReadBuffer *rb;
+  unsigned char magic[DC_MAGICLEN];
+  size_t magiclen;
+  int format;
+
+  if ( ! path )
+    return NULL;
+
+  if ( bufsize == 0 )
+    bufsize = READBUFFER_SIZE;
+
+  if ( ! (rb = (ReadBuffer *) calloc (1, sizeof (ReadBuffer))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for read buffer\n");
+      return NULL;
+    }
+
+  if ( (rb->fp = fopen (path, "rb")) == NULL )
+    {
+      fprintf (stderr, "Cannot open input file: %s (%s)\n",
+               path, strerror(errno));
+      free (rb);
+      return NULL;
+    }
+
+  rb->endoffset = -1;
+
+  if ( ! (rb->path = strdup (path)) )
+    {
+      fprintf (stderr, "Cannot allocate memory for read buffer\n");
+      rb_close (&rb);
+      return NULL;
+    }
+
+  magiclen = fread (magic, 1, sizeof (magic), rb->fp);
+  format = dc_detect (magic, magiclen);
+
+  if ( format != DC_NONE )
+    {
+      if ( ! (rb->dc = dc_open (rb->fp, format, path, magic, magiclen)) )
+        {
+          rb_close (&rb);
+          return NULL;
+        }
+    }
+  else if ( lmp_fseeko (rb->fp, 0, SEEK_SET) == 0 )
+    {
+      if ( rb_map (rb) == 0 )
+        return rb;
+
+      magiclen = 0;
+    }
+
+  rb->bufsize = ( bufsize < DC_MAGICLEN ) ? DC_MAGICLEN : bufsize;
+
+  if ( ! (rb->buffer = (char *) malloc (rb->bufsize)) )
+    {
+      fprintf (stderr, "Cannot allocate memory for read buffer\n");
+      rb_close (&rb);
+      return NULL;
+    }
+
+  rb->cur = rb->end = rb->buffer;
+
+  /* Magic bytes read from uncompressed, unseekable input */
+  if ( ! rb->dc && magiclen > 0 )
+    {
+      memcpy (rb->buffer, magic, magiclen);
+      rb->end += magiclen;
+    }
+
+  return rb;
+}  /* End of rb_open() */
+
+
+/***************************************************************************
+ * rb_setrange:
+ *
+ * Restrict reading to length bytes starting at offset in the input,
+ * if length is 0 reading continues to the end of the input.  Any
+ * buffered data is discarded.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+rb_setrange (ReadBuffer *rb, int64_t offset, int64_t length)
+{
+  if ( ! rb || offset < 0 || length < 0 )
+    return -1;
+
+  /* Mapped input, the range is set directly in the mapping */
+  if ( rb->mapped )
+    {
+      if ( (uint64_t)offset > rb->bufsize )
+        return -1;
+
+      rb->cur = rb->buffer + offset;
+      rb->end = rb->buffer + rb->bufsize;
+
+      if ( length > 0 && (uint64_t)length < rb->bufsize - (uint64_t)offset )
+        rb->end = rb->cur + length;
+
+      return 0;
+    }
+
+  if ( rb->dc )
+    {
+      fprintf (stderr, "Cannot seek in compressed input file: %s\n", rb->path);
+      return -1;
+    }
+
+  if ( lmp_fseeko (rb->fp, (off_t) offset, SEEK_SET) )
+    {
+      fprintf (stderr, "Cannot seek in input file: %s (%s)\n",
+               rb->path, strerror(errno));
+      return -1;
+    }
+
+  rb->cur = rb->end = rb->buffer;
+  rb->bufoffset = offset;
+  rb->endoffset = ( length > 0 ) ? offset + length : -1;
+  rb->eof = 0;
+
+  return 0;
+}  /* End of rb_setrange() */
+
+
+/***************************************************************************
+ * rb_close:
+ *
+ * Close the input and free all memory associated with a ReadBuffer.
+ ***************************************************************************/
+void
+rb_close (ReadBuffer **rb)
+{
+  if ( ! rb || ! *rb )
+    return;
+
+  if ( (*rb)->dc )
+    dc_close (&(*rb)->dc);
+
+  if ( (*rb)->fp )
+    fclose ((*rb)->fp);
+
+  if ( (*rb)->buffer )
+    {
+#if !defined(LMP_WIN)
+      if ( (*rb)->mapped )
+        munmap ((*rb)->buffer, (*rb)->bufsize);
+      else
+#endif
+        free ((*rb)->buffer);
+    }
+
+  if ( (*rb)->path )
+    free ((*rb)->path);
+
+  free (*rb);
+  *rb = NULL;
+}  /* End of rb_close() */
+
+
+/***************************************************************************
+ * rb_getline:
+ *
+ * Return the next line of input.  On success the line pointer is set
+ * to the first character of the line and the lineend pointer is set
+ * to the character following the line content, which excludes any
+ * trailing newline and carriage return.  The line is NOT terminated
+ * and is only valid until the next call.
+ *
+ * Returns 1 when a line was returned, 0 at end of input and -1 on
+ * error.
+ ***************************************************************************/
+int
+rb_getline (ReadBuffer *rb, char **line, char **lineend)
+{
+  char *nl;
+  size_t scanned = 0;
+
+  if ( ! rb || ! line || ! lineend )
+    return -1;
+
+  for (;;)
+    {
+      if ( (nl = memchr (rb->cur + scanned, '\n', rb->end - rb->cur - scanned)) )
+        break;
+
+      if ( rb->eof )
+        {
+          /* Final line without a newline */
+          if ( rb->cur == rb->end )
+            return 0;
+
+          nl = rb->end;
+          break;
+        }
+
+      /* Do not rescan partial line content after filling */
+      scanned = rb->end - rb->cur;
+
+      if ( rb_fill (rb) < 0 )
+        return -1;
+    }
+
+  *line = rb->cur;
+  rb->cur = ( nl < rb->end ) ? nl + 1 : nl;
+
+  if ( nl > *line && *(nl - 1) == '\r' )
+    nl--;
+
+  *lineend = nl;
+  rb->linenum++;
+
+  return 1;
+}  /* End of rb_getline() */
+
+
+/***************************************************************************
+ * rb_findline:
+ *
+ * Return the next line of input that begins with prefix, skipping
+ * other lines.  Candidate lines are located by searching for the
+ * first character of the prefix, avoiding a search for the end of
+ * every skipped line.  Line numbering is maintained.
+ *
+ * Lines are returned as described for rb_getline().
+ *
+ * Returns 1 when a line was returned, 0 at end of input and -1 on
+ * error.
+ ***************************************************************************/
+int
+rb_findline (ReadBuffer *rb, const char *prefix, char **line, char **lineend)
+{
+  size_t prefixlen;
+  char *search;
+  char *found;
+  char *lastnl;
+
+  if ( ! rb || ! prefix || ! line || ! lineend )
+    return -1;
+
+  if ( (prefixlen = strlen (prefix)) == 0 )
+    return rb_getline (rb, line, lineend);
+
+  for (;;)
+    {
+      search = rb->cur;
+      found = NULL;
+
+      /* Search for the first prefix character at the start of a line,
+       * rb->cur is always at the start of a line */
+      while ( (found = memchr (search, *prefix, rb->end - search)) )
+        {
+          if ( found == rb->cur || *(found - 1) == '\n' )
+            {
+              /* Candidate line extends beyond the buffer, read more */
+              if ( (size_t)(rb->end - found) < prefixlen &&
+                   ! rb->eof && ! memchr (found, '\n', rb->end - found) )
+                break;
+
+              if ( (size_t)(rb->end - found) >= prefixlen &&
+                   ! memcmp (found, prefix, prefixlen) )
+                {
+                  rb->linenum += rb_countlines (rb->cur, found);
+                  rb->cur = found;
+
+                  return rb_getline (rb, line, lineend);
+                }
+            }
+
+          search = found + 1;
+        }
+
+      if ( rb->eof )
+        {
+          rb->linenum += rb_countlines (rb->cur, rb->end);
+          if ( rb->end > rb->cur && *(rb->end - 1) != '\n' )
+            rb->linenum++;
+
+          rb->cur = rb->end;
+          return 0;
+        }
+
+      /* Skip complete lines, keeping any partial line for the next search */
+      lastnl = NULL;
+      for ( search = rb->end; search > rb->cur; search-- )
+        {
+          if ( *(search - 1) == '\n' )
+            {
+              lastnl = search - 1;
+              break;
+            }
+        }
+
+      if ( lastnl )
+        {
+          rb->linenum += rb_countlines (rb->cur, lastnl + 1);
+          rb->cur = lastnl + 1;
+        }
+
+      if ( rb_fill (rb) < 0 )
+        return -1;
+    }
+}  /* End of rb_findline() */
+
+
+/***************************************************************************
+ * rb_read:
+ *
+ * Read length bytes of input into dest, for binary data following a
+ * line.  Buffered data is copied and, when not mapped, any remainder
+ * is read directly into dest without passing through the buffer.
+ * Line numbering is not changed by the data read.
+ *
+ * Returns the number of bytes read, which is less than length only at
+ * end of input, or -1 on error.
+ ***************************************************************************/
+int64_t
+rb_read (ReadBuffer *rb, void *dest, size_t length)
+{
+  size_t count;
+  int64_t nread;
+  int64_t remaining;
+
+  if ( ! rb || ! dest )
+    return -1;
+
+  count = rb->end - rb->cur;
+  if ( count > length )
+    count = length;
+
+  memcpy (dest, rb->cur, count);
+  rb->cur += count;
+
+  if ( count == length || rb->eof )
+    return (int64_t) count;
+
+  /* Buffer is empty, read the remainder directly */
+  rb->bufoffset += rb->end - rb->buffer;
+  rb->cur = rb->end = rb->buffer;
+
+  nread = length - count;
+
+  if ( rb->endoffset >= 0 )
+    {
+      remaining = rb->endoffset - rb->bufoffset;
+
+      if ( remaining < nread )
+        nread = ( remaining > 0 ) ? remaining : 0;
+    }
+
+  if ( (nread = rb_input (rb, (char *) dest + count, (size_t) nread)) < 0 )
+    return -1;
+
+  rb->bufoffset += nread;
+
+  if ( count + nread < length )
+    rb->eof = 1;
+
+  return (int64_t) (count + nread);
+}  /* End of rb_read() */
+
+
+/***************************************************************************
+ * rb_skip:
+ *
+ * Skip length bytes of input, for binary data following a line.  Line
+ * numbering is not changed by the data skipped.
+ *
+ * Returns the number of bytes skipped, which is less than length only
+ * at end of input, or -1 on error.
+ ***************************************************************************/
+int64_t
+rb_skip (ReadBuffer *rb, int64_t length)
+{
+  int64_t skipped = 0;
+  size_t count;
+
+  if ( ! rb || length < 0 )
+    return -1;
+
+  for (;;)
+    {
+      count = rb->end - rb->cur;
+      if ( (int64_t)count > length - skipped )
+        count = (size_t) (length - skipped);
+
+      rb->cur += count;
+      skipped += count;
+
+      if ( skipped == length || rb->eof )
+        break;
+
+      if ( rb_fill (rb) < 0 )
+        return -1;
+    }
+
+  return skipped;
+}  /* End of rb_skip() */
+
+
+/***************************************************************************
+ * rb_tell:
+ *
+ * Returns the input offset of the next unread byte.
+ ***************************************************************************/
+int64_t
+rb_tell (ReadBuffer *rb)
+{
+  if ( ! rb )
+    return -1;
+
+  return rb->bufoffset + (rb->cur - rb->buffer);
+}  /* End of rb_tell() */
+
+
+/***************************************************************************
+ * rb_map:
+ *
+ * Memory map the input if it is a non-empty regular file and mapping
+ * is supported on this platform.  On success the input stream is
+ * closed and the buffer covers the entire file.
+ *
+ * Returns 0 on success and -1 if the input cannot be mapped.
+ ***************************************************************************/
+static int
+rb_map (ReadBuffer *rb)
+{
+#if defined(LMP_WIN)
+  return -1;
+#else
+  struct stat st;
+  void *map;
+
+  if ( fstat (fileno (rb->fp), &st) || ! S_ISREG (st.st_mode) ||
+       st.st_size <= 0 || (uint64_t)st.st_size > (uint64_t)SIZE_MAX )
+    return -1;
+
+  map = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+              fileno (rb->fp), 0);
+
+  if ( map == MAP_FAILED )
+    return -1;
+
+#if defined(MADV_SEQUENTIAL)
+  madvise (map, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+
+  fclose (rb->fp);
+  rb->fp = NULL;
+
+  rb->buffer = (char *) map;
+  rb->bufsize = (size_t) st.st_size;
+  rb->mapped = 1;
+  rb->cur = rb->buffer;
+  rb->end = rb->buffer + rb->bufsize;
+  rb->eof = 1;
+
+  return 0;
+#endif
+}  /* End of rb_map() */
+
+
+/***************************************************************************
+ * rb_fill:
+ *
+ * Shift any unread data to the beginning of the buffer and read more
+ * input into the remainder.  If the buffer is full of unread data
+ * (a very long line) the buffer is grown.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+rb_fill (ReadBuffer *rb)
+{
+  size_t unread;
+  size_t readsize;
+  int64_t nread;
+  int64_t remaining;
+  char *newbuffer;
+
+  unread = rb->end - rb->cur;
+
+  if ( rb->cur != rb->buffer )
+    {
+      if ( unread > 0 )
+        memmove (rb->buffer, rb->cur, unread);
+
+      rb->bufoffset += rb->cur - rb->buffer;
+      rb->cur = rb->buffer;
+      rb->end = rb->buffer + unread;
+    }
+
+  if ( unread == rb->bufsize )
+    {
+      if ( ! (newbuffer = (char *) realloc (rb->buffer, rb->bufsize * 2)) )
+        {
+          fprintf (stderr, "Cannot allocate memory for read buffer\n");
+          return -1;
+        }
+
+      rb->buffer = newbuffer;
+      rb->bufsize *= 2;
+      rb->cur = rb->buffer;
+      rb->end = rb->buffer + unread;
+    }
+
+  readsize = rb->bufsize - unread;
+
+  /* Limit reading to the end of the range */
+  if ( rb->endoffset >= 0 )
+    {
+      remaining = rb->endoffset - (rb->bufoffset + (int64_t)unread);
+
+      if ( remaining < (int64_t)readsize )
+        readsize = ( remaining > 0 ) ? (size_t)remaining : 0;
+    }
+
+  if ( (nread = rb_input (rb, rb->end, readsize)) < 0 )
+    return -1;
+
+  if ( nread == 0 )
+    rb->eof = 1;
+
+  rb->end += nread;
+
+  return 0;
+}  /* End of rb_fill() */
+
+
+/***************************************************************************
+ * rb_input:
+ *
+ * Read up to length bytes from the input stream or decompressor into
+ * dest.  If timing is enabled the time spent is added to readtime,
+ * mapped input is not read here and is not included.
+ *
+ * Returns the number of bytes read, 0 at end of input, or -1 on error.
+ ***************************************************************************/
+static int64_t
+rb_input (ReadBuffer *rb, void *dest, size_t length)
+{
+  double start = 0.0;
+  int64_t nread;
+
+  if ( length == 0 )
+    return 0;
+
+  if ( rb->timing )
+    start = st_now ();
+
+  /* Decompression errors are reported by the decompressor */
+  if ( rb->dc )
+    nread = dc_read (rb->dc, dest, length);
+  else
+    nread = (int64_t) fread (dest, 1, length, rb->fp);
+
+  if ( rb->timing )
+    rb->readtime += st_now () - start;
+
+  if ( ! rb->dc && nread == 0 && ferror (rb->fp) )
+    {
+      fprintf (stderr, "Error reading input file: %s (%s)\n",
+               rb->path, strerror(errno));
+      return -1;
+    }
+
+  return nread;
+}  /* End of rb_input() */
+
+
+/***************************************************************************
+ * rb_countlines:
+ *
+ * Returns the number of newline characters between start and end.
+ ***************************************************************************/
+static int64_t
+rb_countlines (const char *start, const char *end)
+{
+  int64_t count = 0;
+
+  while ( start < end )
+    count += ( *start++ == '\n' );
+
+  return count;
+}  /* End of rb_countlines() */
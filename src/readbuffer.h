@@ -0,0 +1,51 @@
+/***************************************************************************
+ * readbuffer.h
+ *
+ * Declarations for the buffered line reader used by ascii2mseed.
+ ***************************************************************************/
+
+#ifndef READBUFFER_H
+#define READBUFFER_H 1
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "decompress.h"
+
+/* Default size of input buffer, grown as needed for long lines */
+#define READBUFFER_SIZE 1048576
+
+/* Buffered line reader, lines are returned as pointers into the
+ * buffer and are only valid until the next call to rb_getline().
+ * When the input is memory mapped the buffer is the entire file and
+ * lines remain valid until the reader is closed.  Compressed input is
+ * decompressed by a Decompressor and cannot be mapped or restricted
+ * to a range. */
+typedef struct ReadBuffer_s {
+  char    *path;                /* Name of input, used in diagnostics */
+  FILE    *fp;                  /* Input stream, NULL when mapped */
+  Decompressor *dc;             /* Decompressor for compressed input, or NULL */
+  char    *buffer;              /* Buffer for input data or file mapping */
+  size_t   bufsize;             /* Allocated size of buffer or size of mapping */
+  int      mapped;              /* Flag indicating buffer is a file mapping */
+  char    *cur;                 /* Next unread byte in buffer */
+  char    *end;                 /* End of valid data in buffer */
+  int64_t  bufoffset;           /* Input offset of buffer start */
+  int64_t  endoffset;           /* Input offset to stop reading, -1 for none */
+  int64_t  linenum;             /* Line number of last returned line */
+  int      eof;                 /* Flag indicating end of input reached */
+  int      timing;              /* Flag to accumulate time reading input */
+  double   readtime;            /* Seconds reading input, when timing */
+} ReadBuffer;
+
+extern ReadBuffer *rb_open (const char *path, size_t bufsize);
+extern int rb_setrange (ReadBuffer *rb, int64_t offset, int64_t length);
+extern void rb_close (ReadBuffer **rb);
+extern int rb_getline (ReadBuffer *rb, char **line, char **lineend);
+extern int rb_findline (ReadBuffer *rb, const char *prefix,
+                        char **line, char **lineend);
+extern int64_t rb_read (ReadBuffer *rb, void *dest, size_t length);
+extern int64_t rb_skip (ReadBuffer *rb, int64_t length);
+extern int64_t rb_tell (ReadBuffer *rb);
+
+#endif /* READBUFFER_H */
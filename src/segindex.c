@@ -0,0 +1,209 @@
+/***************************************************************************
+ * segindex.c
+ *
+ * Parsing of TIMESERIES header lines and an index of the segments in
+ * an input file.  The index is built by scanning directly for header
+ * lines, the sample lines of each segment are not parsed and binary
+ * samples are skipped.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#include "readbuffer.h"
+#include "segindex.h"
+
+
+/***************************************************************************
+ * si_parseheader:
+ *
+ * Parse a TIMESERIES header line of the form:
+ *
+ * TIMESERIES TA_J15A__BHZ_R, 635 samples, 40 sps, 2008-01-15T00:00:00.025000, SLIST, INTEGER[, Counts[, Flags]]
+ * TIMESERIES TA_J15A__BHZ_R, 635 samples, 40 sps, 2008-01-15T00:00:00.025000, TSPAIR, INTEGER[, Counts[, Flags]]
+ * TIMESERIES TA_J15A__BHZ_R, 635 samples, 40 sps, 2008-01-15T00:00:00.025000, BINARY-LE, INTEGER[, Counts[, Flags]]
+ *
+ * Returns the number of fields parsed, a line with at least 6 fields
+ * is a header, or 0 if the line cannot be a header.
+ ***************************************************************************/
+int
+si_parseheader (char *line, char *lineend, SegmentHeader *hdr)
+{
+  char rdline[350];
+  int fields;
+
+  /* Skip lines that cannot be a TIMESERIES header */
+  if ( lineend - line < 10 || *line != 'T' )
+    return 0;
+
+  /* Copy header line to a terminated string */
+  if ( (size_t)(lineend - line) >= sizeof(rdline) )
+    lineend = line + sizeof(rdline) - 1;
+  memcpy (rdline, line, lineend - line);
+  rdline[lineend - line] = '\0';
+
+  hdr->unitstr[0] = '\0';
+  hdr->flagstr[0] = '\0';
+  fields = sscanf (rdline, "TIMESERIES %[^,], %d samples, %lf sps, %[^,], %[^,], %[^,], %[^,], %s",
+                   hdr->srcname, &hdr->samplecnt, &hdr->samplerate, hdr->timestr,
+                   hdr->listtype, hdr->sampletype, hdr->unitstr, hdr->flagstr);
+
+  return ( fields > 0 ) ? fields : 0;
+}  /* End of si_parseheader() */
+
+
+/***************************************************************************
+ * si_binarylength:
+ *
+ * Determine the length of the binary samples following a header line
+ * with a BINARY-LE or BINARY-BE list type, the samples are 32-bit
+ * integers (INTEGER), 32-bit floats (FLOAT) or 64-bit floats
+ * (FLOAT64) in little or big endian byte order.
+ *
+ * Returns the length in bytes, 0 if the list type is not binary or -1
+ * if the sample type or count is invalid.
+ ***************************************************************************/
+int64_t
+si_binarylength (SegmentHeader *hdr)
+{
+  int samplesize;
+
+  if ( strncmp (hdr->listtype, "BINARY-LE", 9) &&
+       strncmp (hdr->listtype, "BINARY-BE", 9) )
+    return 0;
+
+  if ( ! strncasecmp (hdr->sampletype, "INTEGER", 7) )
+    samplesize = 4;
+  else if ( ! strncasecmp (hdr->sampletype, "FLOAT64", 7) )
+    samplesize = 8;
+  else if ( ! strncasecmp (hdr->sampletype, "FLOAT", 5) )
+    samplesize = 4;
+  else
+    return -1;
+
+  if ( hdr->samplecnt <= 0 )
+    return -1;
+
+  return (int64_t) hdr->samplecnt * samplesize;
+}  /* End of si_binarylength() */
+
+
+/***************************************************************************
+ * si_build:
+ *
+ * Scan the specified file for TIMESERIES header lines and build an
+ * index of the segments.  Each segment extends from its header line
+ * to the next header line or the end of the file.  The binary samples
+ * following a BINARY header line are skipped.
+ *
+ * Segments of compressed input cannot be read independently, an empty
+ * index is returned for such input without scanning it.
+ *
+ * Returns a new SegmentIndex on success and NULL on error.
+ ***************************************************************************/
+SegmentIndex *
+si_build (const char *path)
+{
+  ReadBuffer *rb;
+  SegmentIndex *si;
+  SegmentEntry *entry;
+  SegmentEntry *newentries;
+  SegmentHeader hdr;
+  char *line;
+  char *lineend;
+  int64_t offset;
+  int64_t binarylength;
+  int rv;
+
+  if ( ! (si = (SegmentIndex *) calloc (1, sizeof (SegmentIndex))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for segment index\n");
+      return NULL;
+    }
+
+  if ( (rb = rb_open (path, 0)) == NULL )
+    {
+      si_free (&si);
+      return NULL;
+    }
+
+  if ( rb->dc )
+    {
+      rb_close (&rb);
+      return si;
+    }
+
+  while ( (rv = rb_findline (rb, "TIMESERIES", &line, &lineend)) > 0 )
+    {
+      if ( si_parseheader (line, lineend, &hdr) < 6 )
+        continue;
+
+      if ( si->count == si->size )
+        {
+          si->size = ( si->size ) ? si->size * 2 : 64;
+
+          if ( ! (newentries = (SegmentEntry *) realloc (si->entries, si->size * sizeof (SegmentEntry))) )
+            {
+              fprintf (stderr, "Cannot allocate memory for segment index\n");
+              rv = -1;
+              break;
+            }
+
+          si->entries = newentries;
+        }
+
+      offset = rb->bufoffset + (line - rb->buffer);
+
+      if ( si->count > 0 )
+        si->entries[si->count - 1].length = offset - si->entries[si->count - 1].offset;
+
+      entry = &si->entries[si->count++];
+      entry->offset = offset;
+      entry->linenum = rb->linenum;
+      entry->hdr = hdr;
+
+      /* Skip binary samples, which may contain anything */
+      if ( (binarylength = si_binarylength (&hdr)) > 0 &&
+           rb_skip (rb, binarylength) < 0 )
+        {
+          rv = -1;
+          break;
+        }
+    }
+
+  /* Final segment extends to the end of the file */
+  if ( rv == 0 && si->count > 0 )
+    {
+      entry = &si->entries[si->count - 1];
+      entry->length = rb->bufoffset + (rb->end - rb->buffer) - entry->offset;
+    }
+
+  rb_close (&rb);
+
+  if ( rv < 0 )
+    si_free (&si);
+
+  return si;
+}  /* End of si_build() */
+
+
+/***************************************************************************
+ * si_free:
+ *
+ * Free all memory associated with a SegmentIndex.
+ ***************************************************************************/
+void
+si_free (SegmentIndex **si)
+{
+  if ( ! si || ! *si )
+    return;
+
+  if ( (*si)->entries )
+    free ((*si)->entries);
+
+  free (*si);
+  *si = NULL;
+}  /* End of si_free() */
@@ -0,0 +1,45 @@
+/***************************************************************************
+ * segindex.h
+ *
+ * Declarations for parsing TIMESERIES header lines and indexing the
+ * segments of an input file.
+ ***************************************************************************/
+
+#ifndef SEGINDEX_H
+#define SEGINDEX_H 1
+
+#include <stdint.h>
+
+/* Values parsed from a TIMESERIES header line */
+typedef struct SegmentHeader_s {
+  char      srcname[50];
+  int       samplecnt;
+  double    samplerate;
+  char      timestr[50];
+  char      listtype[20];
+  char      sampletype[20];
+  char      unitstr[20];
+  char      flagstr[100];
+} SegmentHeader;
+
+/* Location and header of a segment in an input file */
+typedef struct SegmentEntry_s {
+  int64_t   offset;             /* Offset of header line in file */
+  int64_t   length;             /* Length of segment including header line */
+  int64_t   linenum;            /* Line number of header line */
+  SegmentHeader hdr;            /* Parsed header values */
+} SegmentEntry;
+
+/* Index of the segments in an input file, in file order */
+typedef struct SegmentIndex_s {
+  SegmentEntry *entries;        /* Array of segment entries */
+  int       count;              /* Number of entries */
+  int       size;               /* Allocated number of entries */
+} SegmentIndex;
+
+extern int si_parseheader (char *line, char *lineend, SegmentHeader *hdr);
+extern int64_t si_binarylength (SegmentHeader *hdr);
+extern SegmentIndex *si_build (const char *path);
+extern void si_free (SegmentIndex **si);
+
+#endif /* SEGINDEX_H */
@@ -0,0 +1,361 @@
+/***************************************************************************
+ * stats.c
+ *
+ * Conversion statistics: counts of samples, records and bytes and the
+ * time spent in each conversion stage, collected per job and combined
+ * for each input file and channel.  The statistics are reported as a
+ * JSON document.
+ *
+ * Stage times of jobs run in parallel are summed, the elapsed time of
+ * all input is the wall clock time of the conversion.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <libmseed.h>
+
+#if defined(LMP_WIN)
+  #include <windows.h>
+#endif
+
+#include "stats.h"
+
+static const char *stagenames[ST_STAGES] =
+  { "read", "parse", "time", "sort", "encode", "write" };
+
+static void st_writecounts (FILE *ofp, Stats *st, const char *indent);
+static void st_writestring (FILE *ofp, const char *string);
+
+
+/***************************************************************************
+ * st_now:
+ *
+ * Returns the current value of a monotonic clock in seconds.
+ ***************************************************************************/
+double
+st_now (void)
+{
+#if defined(LMP_WIN)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+
+  QueryPerformanceFrequency (&frequency);
+  QueryPerformanceCounter (&counter);
+
+  return (double) counter.QuadPart / frequency.QuadPart;
+#else
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}  /* End of st_now() */
+
+
+/***************************************************************************
+ * st_new:
+ *
+ * Allocate statistics for an input file.
+ *
+ * Returns new Stats on success and NULL on error.
+ ***************************************************************************/
+Stats *
+st_new (const char *name)
+{
+  Stats *st;
+
+  if ( ! (st = (Stats *) calloc (1, sizeof (Stats))) ||
+       (name && ! (st->name = strdup (name))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for statistics\n");
+      free (st);
+      return NULL;
+    }
+
+  return st;
+}  /* End of st_new() */
+
+
+/***************************************************************************
+ * st_channel:
+ *
+ * Find the counts for a channel, adding them if not present.
+ *
+ * Returns the ChannelStats on success and NULL on error.
+ ***************************************************************************/
+ChannelStats *
+st_channel (Stats *st, const char *srcname)
+{
+  ChannelStats *cs;
+  ChannelStats **last;
+
+  if ( ! st || ! srcname )
+    return NULL;
+
+  for ( last = &st->channels; *last; last = &(*last)->next )
+    {
+      if ( ! strcmp ((*last)->srcname, srcname) )
+        return *last;
+    }
+
+  if ( ! (cs = (ChannelStats *) calloc (1, sizeof (ChannelStats))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for statistics\n");
+      return NULL;
+    }
+
+  strncpy (cs->srcname, srcname, sizeof (cs->srcname) - 1);
+  *last = cs;
+
+  return cs;
+}  /* End of st_channel() */
+
+
+/***************************************************************************
+ * st_merge:
+ *
+ * Add the counts, times and channel counts of src to dest.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+st_merge (Stats *dest, Stats *src)
+{
+  ChannelStats *srccs;
+  ChannelStats *destcs;
+  int stage;
+
+  if ( ! dest || ! src )
+    return -1;
+
+  dest->traces += src->traces;
+  dest->samples += src->samples;
+  dest->records += src->records;
+  dest->bytesin += src->bytesin;
+  dest->bytesout += src->bytesout;
+  dest->elapsed += src->elapsed;
+
+  for ( stage = 0; stage < ST_STAGES; stage++ )
+    dest->seconds[stage] += src->seconds[stage];
+
+  for ( srccs = src->channels; srccs; srccs = srccs->next )
+    {
+      if ( ! (destcs = st_channel (dest, srccs->srcname)) )
+        return -1;
+
+      destcs->samples += srccs->samples;
+      destcs->records += srccs->records;
+      destcs->bytesin += srccs->bytesin;
+      destcs->bytesout += srccs->bytesout;
+    }
+
+  return 0;
+}  /* End of st_merge() */
+
+
+/***************************************************************************
+ * st_clear:
+ *
+ * Free the channel counts and name of statistics and reset them.
+ ***************************************************************************/
+void
+st_clear (Stats *st)
+{
+  ChannelStats *cs;
+
+  if ( ! st )
+    return;
+
+  while ( (cs = st->channels) )
+    {
+      st->channels = cs->next;
+      free (cs);
+    }
+
+  if ( st->name )
+    free (st->name);
+
+  memset (st, 0, sizeof (Stats));
+}  /* End of st_clear() */
+
+
+/***************************************************************************
+ * st_free:
+ *
+ * Free a list of statistics.
+ ***************************************************************************/
+void
+st_free (Stats **st)
+{
+  Stats *next;
+
+  if ( ! st )
+    return;
+
+  while ( *st )
+    {
+      next = (*st)->next;
+      st_clear (*st);
+      free (*st);
+      *st = next;
+    }
+}  /* End of st_free() */
+
+
+/***************************************************************************
+ * st_report:
+ *
+ * Write a JSON report of the statistics for a list of input files,
+ * the totals for all files and the counts for each channel of all
+ * files.  If path is "-" the report is written to standard output.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+st_report (const char *path, Stats *files, double elapsed)
+{
+  FILE *ofp;
+  Stats total;
+  Stats *st;
+  ChannelStats *cs;
+  int rv = 0;
+
+  if ( ! path )
+    return -1;
+
+  memset (&total, 0, sizeof (Stats));
+
+  for ( st = files; st; st = st->next )
+    {
+      if ( st_merge (&total, st) )
+        {
+          st_clear (&total);
+          return -1;
+        }
+    }
+
+  total.elapsed = elapsed;
+
+  if ( ! strcmp (path, "-") )
+    ofp = stdout;
+  else if ( (ofp = fopen (path, "w")) == NULL )
+    {
+      fprintf (stderr, "Cannot open report file: %s (%s)\n", path, strerror(errno));
+      st_clear (&total);
+      return -1;
+    }
+
+  fprintf (ofp, "{\n  \"files\": [");
+
+  for ( st = files; st; st = st->next )
+    {
+      fprintf (ofp, "%s\n    {\n      \"file\": ", ( st == files ) ? "" : ",");
+      st_writestring (ofp, st->name);
+      fprintf (ofp, ",\n");
+      st_writecounts (ofp, st, "      ");
+      fprintf (ofp, "\n    }");
+    }
+
+  fprintf (ofp, "\n  ],\n  \"channels\": [");
+
+  for ( cs = total.channels; cs; cs = cs->next )
+    {
+      fprintf (ofp, "%s\n    {\n      \"channel\": ", ( cs == total.channels ) ? "" : ",");
+      st_writestring (ofp, cs->srcname);
+      fprintf (ofp, ",\n      \"samples\": %lld,\n      \"records\": %lld,\n"
+               "      \"bytes_in\": %lld,\n      \"bytes_out\": %lld,\n"
+               "      \"compression_ratio\": %.3f\n    }",
+               (long long int) cs->samples, (long long int) cs->records,
+               (long long int) cs->bytesin, (long long int) cs->bytesout,
+               ( cs->bytesout > 0 ) ? (double) cs->bytesin / cs->bytesout : 0.0);
+    }
+
+  fprintf (ofp, "\n  ],\n  \"total\": {\n");
+  st_writecounts (ofp, &total, "    ");
+  fprintf (ofp, "\n  }\n}\n");
+
+  if ( ferror (ofp) )
+    {
+      fprintf (stderr, "Error writing report file: %s\n", path);
+      rv = -1;
+    }
+
+  if ( ofp != stdout && fclose (ofp) )
+    {
+      fprintf (stderr, "Error writing report file: %s (%s)\n", path, strerror(errno));
+      rv = -1;
+    }
+
+  st_clear (&total);
+
+  return rv;
+}  /* End of st_report() */
+
+
+/***************************************************************************
+ * st_writecounts:
+ *
+ * Write the counts, stage times and rates of statistics as JSON object
+ * members, each line prefixed with indent.
+ ***************************************************************************/
+static void
+st_writecounts (FILE *ofp, Stats *st, const char *indent)
+{
+  int stage;
+
+  fprintf (ofp, "%s\"traces\": %lld,\n%s\"samples\": %lld,\n%s\"records\": %lld,\n"
+           "%s\"bytes_in\": %lld,\n%s\"bytes_out\": %lld,\n%s\"compression_ratio\": %.3f,\n",
+           indent, (long long int) st->traces, indent, (long long int) st->samples,
+           indent, (long long int) st->records, indent, (long long int) st->bytesin,
+           indent, (long long int) st->bytesout, indent,
+           ( st->bytesout > 0 ) ? (double) st->bytesin / st->bytesout : 0.0);
+
+  fprintf (ofp, "%s\"seconds\": {", indent);
+  for ( stage = 0; stage < ST_STAGES; stage++ )
+    fprintf (ofp, "%s\"%s\": %.6f", ( stage ) ? ", " : " ",
+             stagenames[stage], st->seconds[stage]);
+  fprintf (ofp, " },\n");
+
+  fprintf (ofp, "%s\"elapsed\": %.6f,\n%s\"samples_per_sec\": %.0f,\n%s\"records_per_sec\": %.0f",
+           indent, st->elapsed,
+           indent, ( st->elapsed > 0.0 ) ? st->samples / st->elapsed : 0.0,
+           indent, ( st->elapsed > 0.0 ) ? st->records / st->elapsed : 0.0);
+}  /* End of st_writecounts() */
+
+
+/***************************************************************************
+ * st_writestring:
+ *
+ * Write a string as a JSON string, escaping special characters, or
+ * null if the string is NULL.
+ ***************************************************************************/
+static void
+st_writestring (FILE *ofp, const char *string)
+{
+  const unsigned char *cp;
+
+  if ( ! string )
+    {
+      fputs ("null", ofp);
+      return;
+    }
+
+  fputc ('"', ofp);
+
+  for ( cp = (const unsigned char *) string; *cp; cp++ )
+    {
+      if ( *cp == '"' || *cp == '\\' )
+        fprintf (ofp, "\\%c", *cp);
+      else if ( *cp < 0x20 )
+        fprintf (ofp, "\\u%04x", *cp);
+      else
+        fputc (*cp, ofp);
+    }
+
+  fputc ('"', ofp);
+}  /* End of st_writestring() */
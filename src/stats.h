@@ -0,0 +1,53 @@
+/***************************************************************************
+ * stats.h
+ *
+ * Declarations for the conversion statistics reported by ascii2mseed.
+ ***************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H 1
+
+#include <stdint.h>
+
+/* Conversion stages with accumulated times */
+#define ST_READ   0             /* Reading input, not including mapped input */
+#define ST_PARSE  1             /* Parsing sample values */
+#define ST_TIME   2             /* Converting TSPAIR time stamps */
+#define ST_SORT   3             /* Sorting traces */
+#define ST_ENCODE 4             /* Packing records, not including writing */
+#define ST_WRITE  5             /* Writing or buffering records */
+#define ST_STAGES 6
+
+/* Counts for a channel */
+typedef struct ChannelStats_s {
+  char      srcname[50];        /* Source name of channel */
+  int64_t   samples;            /* Count of packed samples */
+  int64_t   records;            /* Count of packed records */
+  int64_t   bytesin;            /* Bytes of input segments */
+  int64_t   bytesout;           /* Bytes of packed records */
+  struct ChannelStats_s *next;
+} ChannelStats;
+
+/* Counts and stage times for a job, an input file or all input */
+typedef struct Stats_s {
+  char     *name;               /* Input file name, NULL for none */
+  int64_t   traces;             /* Count of packed traces */
+  int64_t   samples;            /* Count of packed samples */
+  int64_t   records;            /* Count of packed records */
+  int64_t   bytesin;            /* Bytes of input read */
+  int64_t   bytesout;           /* Bytes of packed records */
+  double    seconds[ST_STAGES]; /* Time of each stage in seconds */
+  double    elapsed;            /* Elapsed time in seconds */
+  ChannelStats *channels;       /* Counts for each channel */
+  struct Stats_s *next;         /* Next in list of input files */
+} Stats;
+
+extern double st_now (void);
+extern Stats *st_new (const char *name);
+extern ChannelStats *st_channel (Stats *st, const char *srcname);
+extern int st_merge (Stats *dest, Stats *src);
+extern void st_clear (Stats *st);
+extern void st_free (Stats **st);
+extern int st_report (const char *path, Stats *files, double elapsed);
+
+#endif /* STATS_H */
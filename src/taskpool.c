@@ -0,0 +1,296 @@
+/***************************************************************************
+ * taskpool.c
+ *
+ * A pool of worker threads running tasks in parallel.  Tasks are
+ * started in the order submitted and completed tasks are collected
+ * in the same order, allowing parallel processing with deterministic
+ * output ordering.
+ *
+ * Threads are not supported on Windows, tp_init() always fails there.
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libmseed.h>
+
+#include "taskpool.h"
+
+#if defined(LMP_WIN)
+
+TaskPool *
+tp_init (int threadcount, void (*runtask) (void *task))
+{
+  fprintf (stderr, "Parallel processing is not supported on this platform\n");
+  return NULL;
+}
+
+int tp_submit (TaskPool *tp, void *task) { return -1; }
+void *tp_collect (TaskPool *tp) { return NULL; }
+int tp_pending (TaskPool *tp) { return 0; }
+void tp_free (TaskPool **tp) { }
+
+#else
+
+#include <pthread.h>
+
+/* Entry for a submitted task */
+typedef struct TaskEntry_s {
+  void   *task;                 /* Task data passed to runtask() */
+  int     done;                 /* Flag indicating task is complete */
+  struct TaskEntry_s *next;     /* Next entry in submission order */
+} TaskEntry;
+
+struct TaskPool_s {
+  pthread_mutex_t lock;
+  pthread_cond_t  workcond;     /* Signaled when work is queued or on shutdown */
+  pthread_cond_t  donecond;     /* Signaled when a task is completed */
+  pthread_t      *threads;      /* Worker threads */
+  int             threadcount;  /* Number of worker threads */
+  void          (*runtask) (void *task);
+  TaskEntry      *head;         /* Oldest uncollected task */
+  TaskEntry      *tail;         /* Newest task */
+  TaskEntry      *queued;       /* Oldest task not yet started */
+  int             pending;      /* Count of uncollected tasks */
+  int             shutdown;     /* Flag indicating workers should exit */
+};
+
+static void *tp_worker (void *arg);
+
+
+/***************************************************************************
+ * tp_init:
+ *
+ * Create a pool of threadcount worker threads that will process
+ * submitted tasks by calling runtask().
+ *
+ * Returns a new TaskPool on success and NULL on error.
+ ***************************************************************************/
+TaskPool *
+tp_init (int threadcount, void (*runtask) (void *task))
+{
+  TaskPool *tp;
+  int idx;
+
+  if ( threadcount < 1 || ! runtask )
+    return NULL;
+
+  if ( ! (tp = (TaskPool *) calloc (1, sizeof (TaskPool))) ||
+       ! (tp->threads = (pthread_t *) calloc (threadcount, sizeof (pthread_t))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for task pool\n");
+      if ( tp )
+        free (tp);
+      return NULL;
+    }
+
+  pthread_mutex_init (&tp->lock, NULL);
+  pthread_cond_init (&tp->workcond, NULL);
+  pthread_cond_init (&tp->donecond, NULL);
+  tp->runtask = runtask;
+
+  for ( idx = 0; idx < threadcount; idx++ )
+    {
+      if ( pthread_create (&tp->threads[idx], NULL, tp_worker, tp) )
+        {
+          fprintf (stderr, "Cannot create worker thread\n");
+          tp_free (&tp);
+          return NULL;
+        }
+
+      tp->threadcount++;
+    }
+
+  return tp;
+}  /* End of tp_init() */
+
+
+/***************************************************************************
+ * tp_submit:
+ *
+ * Queue a task for processing, this routine does not block.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+tp_submit (TaskPool *tp, void *task)
+{
+  TaskEntry *entry;
+
+  if ( ! tp )
+    return -1;
+
+  if ( ! (entry = (TaskEntry *) calloc (1, sizeof (TaskEntry))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for task\n");
+      return -1;
+    }
+
+  entry->task = task;
+
+  pthread_mutex_lock (&tp->lock);
+
+  if ( tp->tail )
+    tp->tail->next = entry;
+  else
+    tp->head = entry;
+  tp->tail = entry;
+
+  if ( ! tp->queued )
+    tp->queued = entry;
+
+  tp->pending++;
+
+  pthread_cond_signal (&tp->workcond);
+  pthread_mutex_unlock (&tp->lock);
+
+  return 0;
+}  /* End of tp_submit() */
+
+
+/***************************************************************************
+ * tp_collect:
+ *
+ * Wait for the oldest uncollected task to complete and remove it
+ * from the pool.
+ *
+ * Returns the task or NULL if no tasks are pending.
+ ***************************************************************************/
+void *
+tp_collect (TaskPool *tp)
+{
+  TaskEntry *entry;
+  void *task;
+
+  if ( ! tp )
+    return NULL;
+
+  pthread_mutex_lock (&tp->lock);
+
+  if ( ! tp->head )
+    {
+      pthread_mutex_unlock (&tp->lock);
+      return NULL;
+    }
+
+  while ( ! tp->head->done )
+    pthread_cond_wait (&tp->donecond, &tp->lock);
+
+  entry = tp->head;
+  tp->head = entry->next;
+  if ( ! tp->head )
+    tp->tail = NULL;
+  tp->pending--;
+
+  pthread_mutex_unlock (&tp->lock);
+
+  task = entry->task;
+  free (entry);
+
+  return task;
+}  /* End of tp_collect() */
+
+
+/***************************************************************************
+ * tp_pending:
+ *
+ * Returns the number of submitted tasks that have not been collected.
+ ***************************************************************************/
+int
+tp_pending (TaskPool *tp)
+{
+  int pending;
+
+  if ( ! tp )
+    return 0;
+
+  pthread_mutex_lock (&tp->lock);
+  pending = tp->pending;
+  pthread_mutex_unlock (&tp->lock);
+
+  return pending;
+}  /* End of tp_pending() */
+
+
+/***************************************************************************
+ * tp_free:
+ *
+ * Stop all worker threads and free the pool.  Tasks that were not
+ * collected are discarded, callers should collect all tasks first.
+ ***************************************************************************/
+void
+tp_free (TaskPool **tp)
+{
+  TaskEntry *entry;
+  TaskEntry *next;
+  int idx;
+
+  if ( ! tp || ! *tp )
+    return;
+
+  pthread_mutex_lock (&(*tp)->lock);
+  (*tp)->shutdown = 1;
+  (*tp)->queued = NULL;
+  pthread_cond_broadcast (&(*tp)->workcond);
+  pthread_mutex_unlock (&(*tp)->lock);
+
+  for ( idx = 0; idx < (*tp)->threadcount; idx++ )
+    pthread_join ((*tp)->threads[idx], NULL);
+
+  entry = (*tp)->head;
+  while ( entry )
+    {
+      next = entry->next;
+      free (entry);
+      entry = next;
+    }
+
+  pthread_mutex_destroy (&(*tp)->lock);
+  pthread_cond_destroy (&(*tp)->workcond);
+  pthread_cond_destroy (&(*tp)->donecond);
+
+  free ((*tp)->threads);
+  free (*tp);
+  *tp = NULL;
+}  /* End of tp_free() */
+
+
+/***************************************************************************
+ * tp_worker:
+ *
+ * Worker thread, run queued tasks in order until shutdown.
+ ***************************************************************************/
+static void *
+tp_worker (void *arg)
+{
+  TaskPool *tp = (TaskPool *) arg;
+  TaskEntry *entry;
+
+  pthread_mutex_lock (&tp->lock);
+
+  for (;;)
+    {
+      while ( ! tp->queued && ! tp->shutdown )
+        pthread_cond_wait (&tp->workcond, &tp->lock);
+
+      if ( ! tp->queued )
+        break;
+
+      entry = tp->queued;
+      tp->queued = entry->next;
+
+      pthread_mutex_unlock (&tp->lock);
+      tp->runtask (entry->task);
+      pthread_mutex_lock (&tp->lock);
+
+      entry->done = 1;
+      pthread_cond_broadcast (&tp->donecond);
+    }
+
+  pthread_mutex_unlock (&tp->lock);
+
+  return NULL;
+}  /* End of tp_worker() */
+
+#endif /* LMP_WIN */
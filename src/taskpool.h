@@ -0,0 +1,19 @@
+/***************************************************************************
+ * taskpool.h
+ *
+ * Declarations for a pool of worker threads that run tasks and return
+ * them to a consumer in submission order.
+ ***************************************************************************/
+
+#ifndef TASKPOOL_H
+#define TASKPOOL_H 1
+
+typedef struct TaskPool_s TaskPool;
+
+extern TaskPool *tp_init (int threadcount, void (*runtask) (void *task));
+extern int tp_submit (TaskPool *tp, void *task);
+extern void *tp_collect (TaskPool *tp);
+extern int tp_pending (TaskPool *tp);
+extern void tp_free (TaskPool **tp);
+
+#endif /* TASKPOOL_H */
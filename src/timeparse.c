@@ -0,0 +1,170 @@
+/***************************************************************************
+ * timeparse.c
+ *
+ * Conversion of TSPAIR time stamps to high precision time values.
+ *
+ * Consecutive samples nearly always share the date, hour and minute
+ * of their time stamps.  For time stamps in the fixed format
+ * "YYYY-MM-DDTHH:MM:SS[.ffffff]" the time of the minute is cached and
+ * only the seconds and fractional seconds are converted when the
+ * prefix matches the previous one.  All other time stamps, and the
+ * first of each minute, are converted with ms_timestr2hptime(), which
+ * also performs the range checking of the date and time fields.
+ *
+ * The results are identical to ms_timestr2hptime(): up to 6 digits
+ * of fractional seconds are converted exactly, which is the same
+ * value the general parser arrives at by rounding.  Longer fractions
+ * are always left to the general parser.
+ ***************************************************************************/
+
+#include <string.h>
+
+#include "timeparse.h"
+
+#define TS_ISDIGIT(c) ((c) >= '0' && (c) <= '9')
+
+static int ts_isprefix (const char *cp);
+static int ts_parsesec (char *cp, char *end, int *sec, int *usec);
+
+
+/***************************************************************************
+ * ts_init:
+ *
+ * Initialize a time stamp parser with no cached minute.
+ ***************************************************************************/
+void
+ts_init (TimeCache *tc)
+{
+  memset (tc->prefix, 0, sizeof(tc->prefix));
+  tc->base = HPTERROR;
+}  /* End of ts_init() */
+
+
+/***************************************************************************
+ * ts_timestr2hptime:
+ *
+ * Convert the time stamp in the range timestr to end, which does not
+ * need to be terminated, to a high precision time value.  Time stamps
+ * longer than TS_MAXLENGTH characters are not converted.
+ *
+ * Returns the time value on success and HPTERROR on error.
+ ***************************************************************************/
+hptime_t
+ts_timestr2hptime (TimeCache *tc, char *timestr, char *end)
+{
+  char stime[TS_MAXLENGTH + 1];
+  hptime_t hptime;
+  size_t length = end - timestr;
+  int sec;
+  int usec;
+  int fixed;
+  
+  fixed = ( length > TS_PREFIXLEN &&
+	    ts_parsesec (timestr + TS_PREFIXLEN, end, &sec, &usec) == 0 );
+  
+  /* Same minute as cached time */
+  if ( fixed && tc->base != HPTERROR &&
+       ! memcmp (timestr, tc->prefix, TS_PREFIXLEN) )
+    {
+      return tc->base + (hptime_t)sec * HPTMODULUS +
+	(hptime_t)usec * (HPTMODULUS / 1000000);
+    }
+  
+  if ( length >= sizeof(stime) )
+    return HPTERROR;
+  
+  memcpy (stime, timestr, length);
+  stime[length] = '\0';
+  
+  if ( (hptime = ms_timestr2hptime (stime)) == HPTERROR )
+    return HPTERROR;
+  
+  /* Cache the minute of a fixed format time stamp */
+  if ( fixed && ts_isprefix (timestr) )
+    {
+      memcpy (tc->prefix, timestr, TS_PREFIXLEN);
+      tc->base = hptime - (hptime_t)sec * HPTMODULUS -
+	(hptime_t)usec * (HPTMODULUS / 1000000);
+    }
+  
+  return hptime;
+}  /* End of ts_timestr2hptime() */
+
+
+/***************************************************************************
+ * ts_isprefix:
+ *
+ * Check for a "YYYY-MM-DDTHH:MM:" prefix, the values of the fields
+ * are not checked.
+ *
+ * Returns 1 if the prefix matches and 0 otherwise.
+ ***************************************************************************/
+static int
+ts_isprefix (const char *cp)
+{
+  static const char layout[TS_PREFIXLEN + 1] = "DDDD-DD-DDTDD:DD:";
+  int idx;
+  
+  for ( idx = 0; idx < TS_PREFIXLEN; idx++ )
+    {
+      if ( layout[idx] == 'D' )
+	{
+	  if ( ! TS_ISDIGIT (cp[idx]) )
+	    return 0;
+	}
+      else if ( cp[idx] != layout[idx] )
+	{
+	  return 0;
+	}
+    }
+  
+  return 1;
+}  /* End of ts_isprefix() */
+
+
+/***************************************************************************
+ * ts_parsesec:
+ *
+ * Parse "SS[.f]" seconds with 1 to 6 digits of fractional seconds
+ * from the range cp to end, the range must contain nothing else.
+ * Seconds are limited to 0-60 as accepted by ms_timestr2hptime().
+ *
+ * Returns 0 on success and -1 if the range is not in this format.
+ ***************************************************************************/
+static int
+ts_parsesec (char *cp, char *end, int *sec, int *usec)
+{
+  int digits;
+  
+  if ( end - cp < 2 || ! TS_ISDIGIT (cp[0]) || ! TS_ISDIGIT (cp[1]) )
+    return -1;
+  
+  *sec = (cp[0] - '0') * 10 + (cp[1] - '0');
+  *usec = 0;
+  cp += 2;
+  
+  if ( *sec > 60 )
+    return -1;
+  
+  if ( cp == end )
+    return 0;
+  
+  if ( *cp++ != '.' )
+    return -1;
+  
+  for ( digits = 0; cp < end && TS_ISDIGIT (*cp); digits++, cp++ )
+    {
+      if ( digits >= 6 )
+	return -1;
+      
+      *usec = *usec * 10 + (*cp - '0');
+    }
+  
+  if ( digits == 0 || cp != end )
+    return -1;
+  
+  for ( ; digits < 6; digits++ )
+    *usec *= 10;
+  
+  return 0;
+}  /* End of ts_parsesec() */
@@ -0,0 +1,29 @@
+/***************************************************************************
+ * timeparse.h
+ *
+ * Declarations for the TSPAIR time stamp parser used by ascii2mseed.
+ ***************************************************************************/
+
+#ifndef TIMEPARSE_H
+#define TIMEPARSE_H 1
+
+#include <libmseed.h>
+
+/* Maximum length of a time stamp */
+#define TS_MAXLENGTH 49
+
+/* Length of the "YYYY-MM-DDTHH:MM:" prefix of a time stamp */
+#define TS_PREFIXLEN 17
+
+/* Time stamp parser state, the prefix and time of the most recent
+ * minute are retained to convert following time stamps within the
+ * same minute without the general parser */
+typedef struct TimeCache_s {
+  char      prefix[TS_PREFIXLEN]; /* Date, hour and minute of cached time */
+  hptime_t  base;               /* Time of cached minute, HPTERROR if none */
+} TimeCache;
+
+extern void ts_init (TimeCache *tc);
+extern hptime_t ts_timestr2hptime (TimeCache *tc, char *timestr, char *end);
+
+#endif /* TIMEPARSE_H */
@@ -0,0 +1,307 @@
+/***************************************************************************
+ * writebuffer.c
+ *
+ * A simple buffered output writer.  Output is collected in a large,
+ * aligned buffer and written with write() in buffer sized blocks,
+ * avoiding the per-record overhead of small writes.
+ *
+ * Direct I/O (O_DIRECT) may be requested where supported, full
+ * buffers are then written without passing through the page cache.
+ * The final, partial block is written after turning direct I/O off as
+ * its length is not aligned.
+ ***************************************************************************/
+
+#if !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <libmseed.h>
+
+#if defined(LMP_WIN)
+  #include <io.h>
+  #define open _open
+  #define write _write
+  #define close _close
+#endif
+
+#if !defined(O_BINARY)
+  #define O_BINARY 0
+#endif
+
+#include "writebuffer.h"
+
+static int wb_output (WriteBuffer *wb, const char *data, size_t length);
+
+
+/***************************************************************************
+ * wb_open:
+ *
+ * Open the specified file for writing, truncating any existing file,
+ * or standard output if the path is "-".  A buffer of bufsize bytes
+ * rounded up to WRITEBUFFER_ALIGN is allocated, if bufsize is 0 a
+ * default size is used.
+ *
+ * Options are a combination of the following flags:
+ *   WB_DIRECT : Open the file for direct I/O.  If direct I/O is not
+ *               supported for the file a warning is printed and the
+ *               file is written normally.
+ *   WB_APPEND : Append to an existing file instead of truncating it.
+ *
+ * Returns a new WriteBuffer on success and NULL on error.
+ ***************************************************************************/
+WriteBuffer *
+wb_open (const char *path, size_t bufsize, int options)
+{
+  WriteBuffer *wb;
+  int flags = O_WRONLY | O_CREAT | O_BINARY;
+
+  flags |= ( options & WB_APPEND ) ? O_APPEND : O_TRUNC;
+
+  if ( ! path )
+    return NULL;
+
+  if ( bufsize == 0 )
+    bufsize = WRITEBUFFER_SIZE;
+
+  bufsize = (bufsize + WRITEBUFFER_ALIGN - 1) / WRITEBUFFER_ALIGN * WRITEBUFFER_ALIGN;
+
+  if ( ! (wb = (WriteBuffer *) calloc (1, sizeof (WriteBuffer))) )
+    {
+      fprintf (stderr, "Cannot allocate memory for write buffer\n");
+      return NULL;
+    }
+
+  wb->fd = -1;
+
+  if ( ! (wb->path = strdup (path)) )
+    {
+      fprintf (stderr, "Cannot allocate memory for write buffer\n");
+      wb_close (&wb);
+      return NULL;
+    }
+
+  if ( strcmp (path, "-") == 0 )
+    {
+#if defined(LMP_WIN)
+      _setmode (1, O_BINARY);
+#endif
+      wb->fd = 1;
+    }
+  else
+    {
+#if defined(O_DIRECT)
+      if ( options & WB_DIRECT )
+        {
+          if ( (wb->fd = open (path, flags | O_DIRECT, 0666)) >= 0 )
+            wb->direct = 1;
+          else if ( errno == EINVAL )
+            fprintf (stderr, "WARNING: direct I/O not supported for %s\n", path);
+        }
+#else
+      if ( options & WB_DIRECT )
+        fprintf (stderr, "WARNING: direct I/O not supported on this platform\n");
+#endif
+
+      if ( wb->fd < 0 && (wb->fd = open (path, flags, 0666)) < 0 )
+        {
+          fprintf (stderr, "Cannot open output file: %s (%s)\n",
+                   path, strerror(errno));
+          wb_close (&wb);
+          return NULL;
+        }
+
+      wb->ownfd = 1;
+    }
+
+  wb->bufsize = bufsize;
+
+#if defined(LMP_WIN)
+  wb->buffer = (char *) malloc (wb->bufsize);
+#else
+  if ( posix_memalign ((void **) &wb->buffer, WRITEBUFFER_ALIGN, wb->bufsize) )
+    wb->buffer = NULL;
+#endif
+
+  if ( ! wb->buffer )
+    {
+      fprintf (stderr, "Cannot allocate memory for write buffer\n");
+      wb_close (&wb);
+      return NULL;
+    }
+
+  return wb;
+}  /* End of wb_open() */
+
+
+/***************************************************************************
+ * wb_write:
+ *
+ * Add length bytes of data to the output, writing the buffer each
+ * time it is filled.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+wb_write (WriteBuffer *wb, const char *data, size_t length)
+{
+  size_t count;
+  int rv = 0;
+
+  if ( ! wb || ! data )
+    return -1;
+
+  while ( length > 0 )
+    {
+      count = wb->bufsize - wb->length;
+      if ( count > length )
+        count = length;
+
+      memcpy (wb->buffer + wb->length, data, count);
+      wb->length += count;
+      data += count;
+      length -= count;
+
+      if ( wb->length == wb->bufsize )
+        {
+          if ( wb_output (wb, wb->buffer, wb->length) )
+            rv = -1;
+
+          wb->length = 0;
+        }
+    }
+
+  return rv;
+}  /* End of wb_write() */
+
+
+/***************************************************************************
+ * wb_flush:
+ *
+ * Write any buffered data to the output.  When direct I/O is in use
+ * and the buffered length is not aligned, direct I/O is turned off
+ * for this and all following writes.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+wb_flush (WriteBuffer *wb)
+{
+  int rv;
+
+  if ( ! wb )
+    return -1;
+
+  if ( wb->length == 0 )
+    return 0;
+
+#if defined(O_DIRECT)
+  if ( wb->direct && (wb->length % WRITEBUFFER_ALIGN) )
+    {
+      int flags = fcntl (wb->fd, F_GETFL);
+
+      if ( flags == -1 || fcntl (wb->fd, F_SETFL, flags & ~O_DIRECT) == -1 )
+        {
+          wb->errors++;
+          wb->lasterror = errno;
+          wb->length = 0;
+          return -1;
+        }
+
+      wb->direct = 0;
+    }
+#endif
+
+  rv = wb_output (wb, wb->buffer, wb->length);
+  wb->length = 0;
+
+  return rv;
+}  /* End of wb_flush() */
+
+
+/***************************************************************************
+ * wb_close:
+ *
+ * Flush buffered data, close the output and free all memory
+ * associated with a WriteBuffer.  An error message is printed if any
+ * write failed.
+ *
+ * Returns 0 on success and -1 if any write or closing the output
+ * failed.
+ ***************************************************************************/
+int
+wb_close (WriteBuffer **wb)
+{
+  int rv = 0;
+
+  if ( ! wb || ! *wb )
+    return -1;
+
+  if ( (*wb)->fd >= 0 && (*wb)->buffer )
+    wb_flush (*wb);
+
+  if ( (*wb)->ownfd && close ((*wb)->fd) )
+    {
+      (*wb)->errors++;
+      (*wb)->lasterror = errno;
+    }
+
+  if ( (*wb)->errors )
+    {
+      fprintf (stderr, "Error writing to output file: %s (%s), %lld write(s) failed\n",
+               (*wb)->path, strerror((*wb)->lasterror), (long long int)(*wb)->errors);
+      rv = -1;
+    }
+
+  if ( (*wb)->buffer )
+    free ((*wb)->buffer);
+
+  if ( (*wb)->path )
+    free ((*wb)->path);
+
+  free (*wb);
+  *wb = NULL;
+
+  return rv;
+}  /* End of wb_close() */
+
+
+/***************************************************************************
+ * wb_output:
+ *
+ * Write data to the output, repeating partial and interrupted writes.
+ * Failures are recorded in the WriteBuffer.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+wb_output (WriteBuffer *wb, const char *data, size_t length)
+{
+  long long int count;
+
+  while ( length > 0 )
+    {
+      count = write (wb->fd, data, length);
+
+      if ( count < 0 && errno == EINTR )
+        continue;
+
+      if ( count <= 0 )
+        {
+          wb->errors++;
+          wb->lasterror = ( count < 0 ) ? errno : EIO;
+          return -1;
+        }
+
+      data += count;
+      length -= (size_t) count;
+      wb->written += count;
+    }
+
+  return 0;
+}  /* End of wb_output() */
@@ -0,0 +1,43 @@
+/***************************************************************************
+ * writebuffer.h
+ *
+ * Declarations for the buffered output writer used by ascii2mseed.
+ ***************************************************************************/
+
+#ifndef WRITEBUFFER_H
+#define WRITEBUFFER_H 1
+
+#include <stdint.h>
+
+/* Default size of output buffer */
+#define WRITEBUFFER_SIZE 1048576
+
+/* Alignment of the output buffer and of its size, suitable for direct I/O */
+#define WRITEBUFFER_ALIGN 4096
+
+/* Options for wb_open() */
+#define WB_DIRECT 0x1           /* Use direct I/O where supported */
+#define WB_APPEND 0x2           /* Append to an existing file instead of truncating */
+
+/* Buffered output writer, data are collected in an aligned buffer and
+ * written with write() when the buffer is full.  Write errors are
+ * recorded and reported by wb_close(). */
+typedef struct WriteBuffer_s {
+  char    *path;                /* Name of output, used in diagnostics */
+  int      fd;                  /* Output file descriptor */
+  int      ownfd;               /* Flag indicating descriptor is closed by wb_close() */
+  int      direct;              /* Flag indicating direct I/O is in use */
+  char    *buffer;              /* Aligned output buffer */
+  size_t   bufsize;             /* Size of buffer */
+  size_t   length;              /* Length of data in buffer */
+  int64_t  written;             /* Count of bytes written to output */
+  int64_t  errors;              /* Count of failed writes */
+  int      lasterror;           /* Error number of last failed write */
+} WriteBuffer;
+
+extern WriteBuffer *wb_open (const char *path, size_t bufsize, int options);
+extern int wb_write (WriteBuffer *wb, const char *data, size_t length);
+extern int wb_flush (WriteBuffer *wb);
+extern int wb_close (WriteBuffer **wb);
+
+#endif /* WRITEBUFFER_H */